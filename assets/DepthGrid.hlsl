@@ -1,5 +1,35 @@
+#ifndef SKY_STREAMING
+#   define SKY_STREAMING 0
+#endif
+
+#if SKY_STREAMING
+// Virtual-texture sky: tiles of the equirect image live in a fixed-size cache
+// texture and are located through a page table (see SkyTileStreamer).
+#define SKY_MAX_MIPS 16
+
+Texture2D    g_SkyCache;
+SamplerState g_SkyCache_sampler;
+
+StructuredBuffer<uint>   g_SkyPageTable; // 0 - not resident, otherwise cache slot + 1
+RWStructuredBuffer<uint> g_SkyFeedback;  // feedback stamp of the last frame that wanted the tile
+
+cbuffer SkyStreamingCB
+{
+    float2 g_VirtualSize;    // mip 0 size in texels
+    float2 g_CacheSize;      // cache texture size in texels
+    float  g_TileSize;       // texels per tile, excluding the border
+    float  g_TileBorder;
+    uint   g_SlotsPerRow;
+    uint   g_NumMips;
+    uint   g_FeedbackStamp;
+    uint   g_FeedbackMask;   // only pixels with ((x | y) & mask) == 0 write feedback
+    uint2  g_Padding;
+    uint4  g_MipFirstTile[SKY_MAX_MIPS]; // x - page table index of the first tile of the mip
+};
+#else
 Texture2D g_SkyTex;
 SamplerState g_SkyTex_sampler;
+#endif
 
 cbuffer CB
 {
@@ -26,11 +56,92 @@ VSOut VSMain(uint vId : SV_VertexID)
     return outp; // passthrough to PS
 }
 
+#if SKY_STREAMING
+// Returns the page table index of the tile covering uv at the given mip and
+// the texel position of uv relative to that tile's origin.
+uint GetSkyPage(float2 uv, uint Mip, out float2 InTile)
+{
+    float2 MipSize = max(floor(g_VirtualSize / float(1u << Mip)), float2(1.0, 1.0));
+    float2 Texel   = uv * MipSize;
+    uint2  Tiles   = uint2(ceil(MipSize / g_TileSize));
+    uint2  Tile    = min(uint2(Texel / g_TileSize), Tiles - uint2(1, 1));
+    InTile         = Texel - float2(Tile) * g_TileSize;
+    return g_MipFirstTile[Mip].x + Tile.y * Tiles.x + Tile.x;
+}
+
+float4 SampleSkyStreaming(float2 uv, float2 PixelPos)
+{
+    // Mip from the texel footprint. The u derivative is wrapped so that the
+    // atan2 seam does not select the coarsest mip along a vertical line.
+    float2 dUVdx = ddx(uv);
+    float2 dUVdy = ddy(uv);
+    dUVdx.x -= round(dUVdx.x);
+    dUVdy.x -= round(dUVdy.x);
+    float2 dx  = dUVdx * g_VirtualSize;
+    float2 dy  = dUVdy * g_VirtualSize;
+    float  Lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+    uint   Mip = uint(clamp(Lod, 0.0, float(g_NumMips - 1)));
+
+    // Record the tile we would like to have; a sparse subset of pixels is enough
+    float2 InTile;
+    uint   Page = GetSkyPage(uv, Mip, InTile);
+    uint2  Pix  = uint2(PixelPos);
+    if (((Pix.x | Pix.y) & g_FeedbackMask) == 0)
+        g_SkyFeedback[Page] = g_FeedbackStamp;
+
+    // Fall back to coarser mips until a resident tile is found. The coarsest
+    // mip is pinned in the cache, so the loop always terminates with a hit.
+    uint Entry = g_SkyPageTable[Page];
+    while (Entry == 0 && Mip + 1 < g_NumMips)
+    {
+        ++Mip;
+        Entry = g_SkyPageTable[GetSkyPage(uv, Mip, InTile)];
+    }
+
+    uint   Slot       = max(Entry, 1u) - 1;
+    float  Padded     = g_TileSize + 2.0 * g_TileBorder;
+    float2 SlotOrigin = float2(Slot % g_SlotsPerRow, Slot / g_SlotsPerRow) * Padded + g_TileBorder;
+    return g_SkyCache.SampleLevel(g_SkyCache_sampler, (SlotOrigin + InTile) / g_CacheSize, 0.0);
+}
+#endif
+
 float4 PSMain(VSOut i) : SV_Target
 {
     // view‑direction → equirectangular lookup -----------------------------
     float2 uv;
     uv.x = 0.5 + atan2(i.Dir.z, i.Dir.x) / (2 * 3.14159265);
     uv.y = 0.5 - asin(i.Dir.y) / 3.14159265;
+#if SKY_STREAMING
+    return SampleSkyStreaming(uv, i.Pos.xy);
+#else
     return g_SkyTex.Sample(g_SkyTex_sampler, uv);
+#endif
+}
+
+// --- Reduced-resolution sky composite ---------------------------------------
+Texture2D    g_SkyLowRes;
+SamplerState g_SkyLowRes_sampler;
+
+struct UpsampleVSOut
+{
+    float2 UV  : TEXCOORD0;
+    float4 Pos : SV_Position;
+};
+
+UpsampleVSOut UpsampleVS(uint vId : SV_VertexID)
+{
+    // Same full-screen triangle as VSMain; uv (0,0) is the top-left corner
+    float2 uv = float2((vId << 1) & 2, vId & 2);
+
+    UpsampleVSOut outp;
+    outp.UV  = uv;
+    outp.Pos = float4(uv * float2(2, -2) + float2(-1, 1), 0, 1);
+    return outp;
+}
+
+float4 UpsamplePS(UpsampleVSOut i) : SV_Target
+{
+    // The sky is drawn before any geometry, so there are no depth edges to
+    // preserve and bilinear filtering is all the reconstruction it needs
+    return g_SkyLowRes.Sample(g_SkyLowRes_sampler, i.UV);
 }
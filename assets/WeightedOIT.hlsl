@@ -0,0 +1,40 @@
+// Composite pass of weighted blended order-independent transparency.
+// cube.psh (WING_ALPHA_MODE 2) accumulates premultiplied, depth-weighted colour
+// into g_OITAccum with additive blending and multiplies (1 - alpha) into
+// g_OITReveal. This pass normalizes the accumulated colour and blends it over
+// the opaque scene with SRC_ALPHA / INV_SRC_ALPHA, so no sorting is required.
+
+Texture2D g_OITAccum;
+Texture2D g_OITReveal;
+
+struct CompositeVSOut
+{
+    float4 Pos : SV_Position;
+};
+
+CompositeVSOut CompositeVS(uint vId : SV_VertexID)
+{
+    // Full-screen triangle
+    float2 uv = float2((vId << 1) & 2, vId & 2);
+
+    CompositeVSOut outp;
+    outp.Pos = float4(uv * float2(2, -2) + float2(-1, 1), 0, 1);
+    return outp;
+}
+
+float4 CompositePS(CompositeVSOut i) : SV_Target
+{
+    int3  Coord  = int3(i.Pos.xy, 0);
+    float Reveal = g_OITReveal.Load(Coord).r;
+    // No translucent fragment touched this pixel
+    if (Reveal >= 1.0)
+        discard;
+
+    float4 Accum = g_OITAccum.Load(Coord);
+    // Clamp guards against fp16 overflow when many weighted fragments overlap
+    float3 Color = Accum.rgb / clamp(Accum.a, 1e-4, 5e4);
+#if CONVERT_PS_OUTPUT_TO_GAMMA
+    Color = pow(Color, float3(1.0 / 2.2, 1.0 / 2.2, 1.0 / 2.2));
+#endif
+    return float4(Color, 1.0 - Reveal);
+}
@@ -0,0 +1,302 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "AllocationTracker.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Sanitizers intercept malloc themselves; forwarding their interceptors to __libc_*
+// bypasses the sanitizer's allocator and crashes at startup
+#if defined(__SANITIZE_THREAD__) || defined(__SANITIZE_ADDRESS__)
+#    define ALLOCATION_TRACKER_SANITIZED 1
+#elif defined(__has_feature)
+#    if __has_feature(thread_sanitizer) || __has_feature(address_sanitizer)
+#        define ALLOCATION_TRACKER_SANITIZED 1
+#    endif
+#endif
+#ifndef ALLOCATION_TRACKER_SANITIZED
+#    define ALLOCATION_TRACKER_SANITIZED 0
+#endif
+
+// malloc is interposed only with glibc, whose __libc_* entry points give the
+// replacements something to forward to, and never in sanitizer builds.
+// Elsewhere only operator new/delete are counted.
+#if ALLOCATION_TRACKER_ENABLED && defined(__GLIBC__) && !ALLOCATION_TRACKER_SANITIZED
+#    define ALLOCATION_TRACKER_INTERPOSE_MALLOC 1
+#else
+#    define ALLOCATION_TRACKER_INTERPOSE_MALLOC 0
+#endif
+
+namespace Diligent
+{
+
+namespace AllocationTracker
+{
+
+namespace
+{
+
+// Plain thread_local PODs: constant-initialized, so counting needs no allocation of its own
+thread_local ThreadStats t_Stats;
+thread_local ScopeStats* t_pScope = nullptr;
+
+std::atomic<ScopeStats*> g_pFirstScope{nullptr};
+
+} // namespace
+
+bool IsEnabled()
+{
+    return ALLOCATION_TRACKER_ENABLED != 0;
+}
+
+bool IsMallocInterposed()
+{
+    return ALLOCATION_TRACKER_INTERPOSE_MALLOC != 0;
+}
+
+ThreadStats GetThreadStats()
+{
+    return t_Stats;
+}
+
+ScopeStats::ScopeStats(const char* _Name) :
+    Name{_Name}
+{
+    pNext = g_pFirstScope.load(std::memory_order_relaxed);
+    while (!g_pFirstScope.compare_exchange_weak(pNext, this, std::memory_order_release, std::memory_order_relaxed))
+    {
+    }
+}
+
+Scope::Scope(ScopeStats& Stats) :
+    m_pParent{t_pScope}
+{
+    t_pScope = &Stats;
+}
+
+Scope::~Scope()
+{
+    t_pScope = m_pParent;
+}
+
+const ScopeStats* GetFirstScope()
+{
+    return g_pFirstScope.load(std::memory_order_acquire);
+}
+
+#if ALLOCATION_TRACKER_ENABLED
+
+namespace
+{
+
+void CountAllocation(size_t Size)
+{
+    ++t_Stats.NumAllocations;
+    t_Stats.BytesAllocated += Size;
+    if (ScopeStats* pScope = t_pScope)
+    {
+        pScope->NumAllocations.fetch_add(1, std::memory_order_relaxed);
+        pScope->BytesAllocated.fetch_add(Size, std::memory_order_relaxed);
+    }
+}
+
+void CountFree()
+{
+    ++t_Stats.NumFrees;
+}
+
+// With malloc interposed, the malloc family counts and operator new must not count again
+void* Allocate(size_t Size, size_t Alignment)
+{
+    if (Size == 0)
+        Size = 1;
+
+    void* Ptr = nullptr;
+    if (Alignment <= alignof(std::max_align_t))
+    {
+        Ptr = std::malloc(Size);
+    }
+    else
+    {
+#    if PLATFORM_WIN32 || PLATFORM_UNIVERSAL_WINDOWS
+        Ptr = _aligned_malloc(Size, Alignment);
+#    else
+        if (posix_memalign(&Ptr, Alignment, Size) != 0)
+            Ptr = nullptr;
+#    endif
+    }
+
+#    if !ALLOCATION_TRACKER_INTERPOSE_MALLOC
+    if (Ptr != nullptr)
+        CountAllocation(Size);
+#    endif
+    return Ptr;
+}
+
+void Free(void* Ptr, size_t Alignment)
+{
+    if (Ptr == nullptr)
+        return;
+
+#    if !ALLOCATION_TRACKER_INTERPOSE_MALLOC
+    CountFree();
+#    endif
+#    if PLATFORM_WIN32 || PLATFORM_UNIVERSAL_WINDOWS
+    if (Alignment > alignof(std::max_align_t))
+    {
+        _aligned_free(Ptr);
+        return;
+    }
+#    else
+    (void)Alignment;
+#    endif
+    std::free(Ptr);
+}
+
+void* AllocateOrThrow(size_t Size, size_t Alignment)
+{
+    void* Ptr = Allocate(Size, Alignment);
+    if (Ptr == nullptr)
+        throw std::bad_alloc{};
+    return Ptr;
+}
+
+} // namespace
+
+#endif // ALLOCATION_TRACKER_ENABLED
+
+} // namespace AllocationTracker
+
+} // namespace Diligent
+
+#if ALLOCATION_TRACKER_ENABLED
+
+using Diligent::AllocationTracker::Allocate;
+using Diligent::AllocationTracker::AllocateOrThrow;
+using Diligent::AllocationTracker::Free;
+
+// clang-format off
+void* operator new  (size_t Size) { return AllocateOrThrow(Size, alignof(std::max_align_t)); }
+void* operator new[](size_t Size) { return AllocateOrThrow(Size, alignof(std::max_align_t)); }
+void* operator new  (size_t Size, const std::nothrow_t&) noexcept { return Allocate(Size, alignof(std::max_align_t)); }
+void* operator new[](size_t Size, const std::nothrow_t&) noexcept { return Allocate(Size, alignof(std::max_align_t)); }
+void* operator new  (size_t Size, std::align_val_t Al) { return AllocateOrThrow(Size, static_cast<size_t>(Al)); }
+void* operator new[](size_t Size, std::align_val_t Al) { return AllocateOrThrow(Size, static_cast<size_t>(Al)); }
+void* operator new  (size_t Size, std::align_val_t Al, const std::nothrow_t&) noexcept { return Allocate(Size, static_cast<size_t>(Al)); }
+void* operator new[](size_t Size, std::align_val_t Al, const std::nothrow_t&) noexcept { return Allocate(Size, static_cast<size_t>(Al)); }
+
+void operator delete  (void* Ptr) noexcept { Free(Ptr, alignof(std::max_align_t)); }
+void operator delete[](void* Ptr) noexcept { Free(Ptr, alignof(std::max_align_t)); }
+void operator delete  (void* Ptr, size_t) noexcept { Free(Ptr, alignof(std::max_align_t)); }
+void operator delete[](void* Ptr, size_t) noexcept { Free(Ptr, alignof(std::max_align_t)); }
+void operator delete  (void* Ptr, const std::nothrow_t&) noexcept { Free(Ptr, alignof(std::max_align_t)); }
+void operator delete[](void* Ptr, const std::nothrow_t&) noexcept { Free(Ptr, alignof(std::max_align_t)); }
+void operator delete  (void* Ptr, std::align_val_t Al) noexcept { Free(Ptr, static_cast<size_t>(Al)); }
+void operator delete[](void* Ptr, std::align_val_t Al) noexcept { Free(Ptr, static_cast<size_t>(Al)); }
+void operator delete  (void* Ptr, size_t, std::align_val_t Al) noexcept { Free(Ptr, static_cast<size_t>(Al)); }
+void operator delete[](void* Ptr, size_t, std::align_val_t Al) noexcept { Free(Ptr, static_cast<size_t>(Al)); }
+void operator delete  (void* Ptr, std::align_val_t Al, const std::nothrow_t&) noexcept { Free(Ptr, static_cast<size_t>(Al)); }
+void operator delete[](void* Ptr, std::align_val_t Al, const std::nothrow_t&) noexcept { Free(Ptr, static_cast<size_t>(Al)); }
+// clang-format on
+
+#endif // ALLOCATION_TRACKER_ENABLED
+
+#if ALLOCATION_TRACKER_INTERPOSE_MALLOC
+
+// Definitions in the executable take precedence over libc's for every module in
+// the process, including the engine's shared libraries
+extern "C"
+{
+    void* __libc_malloc(size_t Size);
+    void* __libc_calloc(size_t Num, size_t Size);
+    void* __libc_realloc(void* Ptr, size_t Size);
+    void* __libc_memalign(size_t Alignment, size_t Size);
+    void  __libc_free(void* Ptr);
+
+    void* malloc(size_t Size)
+    {
+        void* Ptr = __libc_malloc(Size);
+        if (Ptr != nullptr)
+            Diligent::AllocationTracker::CountAllocation(Size);
+        return Ptr;
+    }
+
+    void* calloc(size_t Num, size_t Size)
+    {
+        void* Ptr = __libc_calloc(Num, Size);
+        if (Ptr != nullptr)
+            Diligent::AllocationTracker::CountAllocation(Num * Size);
+        return Ptr;
+    }
+
+    // Counted as an allocation whenever it may have to allocate, i.e. unless it frees
+    void* realloc(void* Ptr, size_t Size)
+    {
+        void* NewPtr = __libc_realloc(Ptr, Size);
+        if (NewPtr != nullptr)
+            Diligent::AllocationTracker::CountAllocation(Size);
+        else if (Ptr != nullptr && Size == 0)
+            Diligent::AllocationTracker::CountFree();
+        return NewPtr;
+    }
+
+    void* memalign(size_t Alignment, size_t Size)
+    {
+        void* Ptr = __libc_memalign(Alignment, Size);
+        if (Ptr != nullptr)
+            Diligent::AllocationTracker::CountAllocation(Size);
+        return Ptr;
+    }
+
+    void* aligned_alloc(size_t Alignment, size_t Size)
+    {
+        return memalign(Alignment, Size);
+    }
+
+    int posix_memalign(void** pPtr, size_t Alignment, size_t Size)
+    {
+        if (Alignment < sizeof(void*) || (Alignment & (Alignment - 1)) != 0)
+            return EINVAL;
+        void* Ptr = memalign(Alignment, Size);
+        if (Ptr == nullptr)
+            return ENOMEM;
+        *pPtr = Ptr;
+        return 0;
+    }
+
+    void free(void* Ptr)
+    {
+        if (Ptr != nullptr)
+            Diligent::AllocationTracker::CountFree();
+        __libc_free(Ptr);
+    }
+}
+
+#endif // ALLOCATION_TRACKER_INTERPOSE_MALLOC
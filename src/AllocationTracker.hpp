@@ -0,0 +1,106 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "BasicTypes.h"
+
+// Off unless the build asks for it, see the TUTORIAL03_TRACK_ALLOCATIONS CMake option:
+// the hooks replace the process-wide allocator, engine and driver libraries included
+#ifndef ALLOCATION_TRACKER_ENABLED
+#    define ALLOCATION_TRACKER_ENABLED 0
+#endif
+
+namespace Diligent
+{
+
+// Counts heap allocations. AllocationTracker.cpp replaces the global operator
+// new and delete and, with glibc, also interposes malloc and friends, so
+// allocations made by the engine and by C libraries such as ImGui are counted
+// too. Counters are per thread, and allocations are also attributed to the
+// innermost ALLOCATION_SCOPE active on the allocating thread.
+namespace AllocationTracker
+{
+
+// False if the hooks were compiled out
+bool IsEnabled();
+
+// True if malloc/calloc/realloc/free are counted in addition to operator new/delete
+bool IsMallocInterposed();
+
+struct ThreadStats
+{
+    Uint64 NumAllocations = 0;
+    Uint64 NumFrees       = 0;
+    Uint64 BytesAllocated = 0;
+};
+
+// Totals for the calling thread since it started
+ThreadStats GetThreadStats();
+
+// Allocation counters of one named scope. Instances are created by ALLOCATION_SCOPE
+// and live until exit; counts are exclusive of nested scopes.
+struct ScopeStats
+{
+    explicit ScopeStats(const char* _Name);
+
+    const char* const   Name;
+    std::atomic<Uint64> NumAllocations{0};
+    std::atomic<Uint64> BytesAllocated{0};
+    ScopeStats*         pNext = nullptr; // registration list, see GetFirstScope()
+};
+
+// Makes Stats the scope that the calling thread's allocations are attributed to
+class Scope
+{
+public:
+    explicit Scope(ScopeStats& Stats);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    ScopeStats* const m_pParent;
+};
+
+// All scopes entered so far, most recent first
+const ScopeStats* GetFirstScope();
+
+} // namespace AllocationTracker
+
+} // namespace Diligent
+
+#if ALLOCATION_TRACKER_ENABLED
+#    define ALLOCATION_SCOPE(Name)                                                  \
+        static ::Diligent::AllocationTracker::ScopeStats _AllocationScopeStats{Name}; \
+        ::Diligent::AllocationTracker::Scope             _AllocationScope{_AllocationScopeStats}
+#else
+#    define ALLOCATION_SCOPE(Name)
+#endif
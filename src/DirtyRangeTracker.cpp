@@ -0,0 +1,87 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "DirtyRangeTracker.hpp"
+
+#include <algorithm>
+
+namespace Diligent
+{
+
+void DirtyRangeTracker::Resize(Uint32 NumElements)
+{
+    const Uint32 OldNumElements = m_NumElements;
+
+    // Drop bits of chunks that no longer exist
+    const Uint32 NewNumChunks = (NumElements + m_ChunkSize - 1) / m_ChunkSize;
+    for (Uint32 Chunk = NewNumChunks; Chunk < GetNumChunks(); ++Chunk)
+    {
+        if (IsChunkDirty(Chunk))
+        {
+            m_DirtyBits[Chunk / 64] &= ~(Uint64{1} << (Chunk % 64));
+            --m_NumDirtyChunks;
+        }
+    }
+
+    m_NumElements = NumElements;
+    m_DirtyBits.resize((NewNumChunks + 63) / 64, 0);
+    if (NumElements > OldNumElements)
+        MarkDirty(OldNumElements, NumElements - OldNumElements);
+}
+
+void DirtyRangeTracker::MarkDirty(Uint32 First, Uint32 Count)
+{
+    if (Count == 0 || First >= m_NumElements)
+        return;
+
+    const Uint32 LastChunk = (std::min(First + Count, m_NumElements) - 1) / m_ChunkSize;
+    for (Uint32 Chunk = First / m_ChunkSize; Chunk <= LastChunk; ++Chunk)
+    {
+        Uint64&      Word = m_DirtyBits[Chunk / 64];
+        const Uint64 Bit  = Uint64{1} << (Chunk % 64);
+        if ((Word & Bit) == 0)
+        {
+            Word |= Bit;
+            ++m_NumDirtyChunks;
+        }
+    }
+}
+
+void DirtyRangeTracker::MarkAllDirty()
+{
+    MarkDirty(0, m_NumElements);
+}
+
+void DirtyRangeTracker::Clear()
+{
+    if (m_NumDirtyChunks == 0)
+        return;
+    std::fill(m_DirtyBits.begin(), m_DirtyBits.end(), Uint64{0});
+    m_NumDirtyChunks = 0;
+}
+
+} // namespace Diligent
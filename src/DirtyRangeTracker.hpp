@@ -0,0 +1,99 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Tracks modified elements of an array at a fixed chunk granularity and
+// reports them as coalesced [First, First + Count) element ranges, so that
+// adjacent dirty chunks are uploaded with a single call.
+class DirtyRangeTracker
+{
+public:
+    explicit DirtyRangeTracker(Uint32 ChunkSize = 16) :
+        m_ChunkSize{ChunkSize}
+    {}
+
+    // Resizes the tracked array. Existing state is kept and elements
+    // appended by growing are marked dirty.
+    void Resize(Uint32 NumElements);
+
+    void MarkDirty(Uint32 First, Uint32 Count);
+    void MarkAllDirty();
+    void Clear();
+
+    bool   IsEmpty() const { return m_NumDirtyChunks == 0; }
+    Uint32 GetNumElements() const { return m_NumElements; }
+    Uint32 GetChunkSize() const { return m_ChunkSize; }
+
+    // Calls Handler(First, Count) for every run of consecutive dirty chunks
+    template <typename HandlerType>
+    void ForEachRange(HandlerType&& Handler) const
+    {
+        const Uint32 NumChunks = GetNumChunks();
+        Uint32       Chunk     = 0;
+        while (Chunk < NumChunks)
+        {
+            // Skip clean words quickly
+            if (m_DirtyBits[Chunk / 64] == 0)
+            {
+                Chunk = (Chunk / 64 + 1) * 64;
+                continue;
+            }
+            if (!IsChunkDirty(Chunk))
+            {
+                ++Chunk;
+                continue;
+            }
+
+            const Uint32 RunStart = Chunk;
+            while (Chunk < NumChunks && IsChunkDirty(Chunk))
+                ++Chunk;
+
+            const Uint32 First = RunStart * m_ChunkSize;
+            const Uint32 Last  = Chunk * m_ChunkSize < m_NumElements ? Chunk * m_ChunkSize : m_NumElements;
+            Handler(First, Last - First);
+        }
+    }
+
+private:
+    Uint32 GetNumChunks() const { return (m_NumElements + m_ChunkSize - 1) / m_ChunkSize; }
+    bool   IsChunkDirty(Uint32 Chunk) const { return (m_DirtyBits[Chunk / 64] & (Uint64{1} << (Chunk % 64))) != 0; }
+
+    const Uint32        m_ChunkSize;
+    Uint32              m_NumElements    = 0;
+    Uint32              m_NumDirtyChunks = 0;
+    std::vector<Uint64> m_DirtyBits; // one bit per chunk
+};
+
+} // namespace Diligent
@@ -0,0 +1,90 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Diligent
+{
+
+namespace
+{
+
+size_t AlignUp(size_t Value, size_t Alignment)
+{
+    return (Value + Alignment - 1) & ~(Alignment - 1);
+}
+
+} // namespace
+
+LinearArena::LinearArena(size_t Capacity) :
+    m_Block{Capacity > 0 ? new Uint8[Capacity] : nullptr},
+    m_Capacity{Capacity}
+{
+}
+
+void* LinearArena::Allocate(size_t Size, size_t Alignment)
+{
+    // 1) Bump the offset within the main block. Alignment is applied to the address,
+    //    so alignments stricter than the block's own work as well.
+    const uintptr_t Base    = reinterpret_cast<uintptr_t>(m_Block.get());
+    const size_t    Aligned = AlignUp(Base + m_Offset, Alignment) - Base;
+    if (m_Block && Aligned + Size <= m_Capacity)
+    {
+        m_Offset = Aligned + Size;
+        return m_Block.get() + Aligned;
+    }
+
+    // 2) Does not fit: give it a block of its own until the next Reset()
+    const size_t BlockSize = Size + Alignment - 1;
+    m_Overflow.emplace_back(new Uint8[BlockSize]);
+    m_OverflowBytes += BlockSize;
+    const uintptr_t OverflowBase = reinterpret_cast<uintptr_t>(m_Overflow.back().get());
+    return reinterpret_cast<void*>(AlignUp(OverflowBase, Alignment));
+}
+
+void LinearArena::Reset()
+{
+    const size_t Used = GetUsed();
+    m_Peak            = std::max(m_Peak, Used);
+    m_Offset          = 0;
+
+    // The frame did not fit: grow the main block to what it needed, with headroom,
+    // so that the next frames do not overflow again
+    if (!m_Overflow.empty())
+    {
+        m_Overflow.clear();
+        m_OverflowBytes = 0;
+        m_Capacity      = AlignUp(Used + Used / 2, 4096);
+        m_Block.reset(new Uint8[m_Capacity]);
+        ++m_NumGrowths;
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,130 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Bump allocator for data that lives for one frame. Allocation is a pointer
+// increment and Reset() releases everything at once; nothing is destroyed, so
+// only trivially destructible types belong here.
+//
+// Allocations that do not fit go to separate overflow blocks. The next Reset()
+// replaces the main block with one large enough for the whole frame, so after
+// a warm-up frame or two the arena stops touching the heap.
+class LinearArena
+{
+public:
+    explicit LinearArena(size_t Capacity = 0);
+
+    void* Allocate(size_t Size, size_t Alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* Allocate(size_t Count)
+    {
+        static_assert(std::is_trivially_destructible<T>::value, "Arena memory is released without running destructors");
+        return static_cast<T*>(Allocate(sizeof(T) * Count, alignof(T)));
+    }
+
+    void Reset();
+
+    size_t GetUsed() const { return m_Offset + m_OverflowBytes; }
+    size_t GetPeak() const { return std::max(m_Peak, GetUsed()); }
+    size_t GetCapacity() const { return m_Capacity; }
+    Uint32 GetNumGrowths() const { return m_NumGrowths; } // resets that had to enlarge the block
+
+private:
+    std::unique_ptr<Uint8[]>              m_Block;
+    size_t                                m_Capacity      = 0;
+    size_t                                m_Offset        = 0;
+    size_t                                m_Peak          = 0;
+    std::vector<std::unique_ptr<Uint8[]>> m_Overflow;
+    size_t                                m_OverflowBytes = 0; // including alignment padding
+    Uint32                                m_NumGrowths    = 0;
+};
+
+// Growable array in a LinearArena, for per-frame lists whose size is not known
+// up front. Growing copies the elements into a new arena allocation; the old one
+// is abandoned until the arena is reset.
+template <typename T>
+class ArenaArray
+{
+    static_assert(std::is_trivially_destructible<T>::value, "ArenaArray never destroys its elements");
+
+public:
+    explicit ArenaArray(LinearArena& Arena, size_t InitialCapacity = 64) :
+        m_Arena{Arena},
+        m_pData{Arena.Allocate<T>(InitialCapacity)},
+        m_Capacity{InitialCapacity}
+    {}
+
+    template <typename... ArgsType>
+    T& emplace_back(ArgsType&&... Args)
+    {
+        if (m_Size == m_Capacity)
+        {
+            const size_t NewCapacity = m_Capacity > 0 ? m_Capacity * 2 : 64;
+            T*           pNewData    = m_Arena.Allocate<T>(NewCapacity);
+            std::uninitialized_copy_n(m_pData, m_Size, pNewData);
+            m_pData    = pNewData;
+            m_Capacity = NewCapacity;
+        }
+        return *new (m_pData + m_Size++) T{std::forward<ArgsType>(Args)...};
+    }
+
+    void push_back(const T& Value) { emplace_back(Value); }
+
+    T*       begin() { return m_pData; }
+    T*       end() { return m_pData + m_Size; }
+    const T* begin() const { return m_pData; }
+    const T* end() const { return m_pData + m_Size; }
+
+    T&       operator[](size_t i) { return m_pData[i]; }
+    const T& operator[](size_t i) const { return m_pData[i]; }
+
+    size_t size() const { return m_Size; }
+    bool   empty() const { return m_Size == 0; }
+
+private:
+    LinearArena& m_Arena;
+    T*           m_pData    = nullptr;
+    size_t       m_Size     = 0;
+    size_t       m_Capacity = 0;
+};
+
+} // namespace Diligent
@@ -0,0 +1,256 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "GPURadixSort.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "MapHelper.hpp"
+#include "DebugUtilities.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+GPURadixSort::GPURadixSort(IRenderDevice* pDevice, IShaderSourceInputStreamFactory* pShaderSourceFactory) :
+    m_pDevice{pDevice}
+{
+    // Every stage of a pass is a separate entry point in RadixSort.csh
+    static constexpr const char* EntryPoints[SORT_PASS_COUNT] =
+        {
+            "CountDigits",
+            "ScanBlocks",
+            "ScanBlockSums",
+            "AddBlockOffsets",
+            "ScatterKeys",
+        };
+
+    BufferDesc CBDesc;
+    CBDesc.Name           = "Radix sort constants";
+    CBDesc.Size           = sizeof(RadixSortConstants);
+    CBDesc.Usage          = USAGE_DYNAMIC;
+    CBDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_CB);
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.FilePath                   = "RadixSort.csh";
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    for (Uint32 Pass = 0; Pass < SORT_PASS_COUNT; ++Pass)
+    {
+        RefCntAutoPtr<IShader> pCS;
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.Desc.Name       = EntryPoints[Pass];
+        ShaderCI.EntryPoint      = EntryPoints[Pass];
+        m_pDevice->CreateShader(ShaderCI, &pCS);
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name         = EntryPoints[Pass];
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.pCS                  = pCS;
+
+        // Buffers are mutable: the scratch buffers grow and callers may pass different buffers
+        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+
+        ShaderResourceVariableDesc Vars[] =
+            {
+                {SHADER_TYPE_COMPUTE, "RadixSortConstants", SHADER_RESOURCE_VARIABLE_TYPE_STATIC}};
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_PSOs[Pass]);
+        m_PSOs[Pass]->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "RadixSortConstants")->Set(m_CB);
+    }
+}
+
+void GPURadixSort::Reserve(Uint32 MaxKeys)
+{
+    // The two-level scan in RadixSort.csh cannot handle more; Sort() rejects larger counts
+    MaxKeys = std::min(MaxKeys, kMaxKeys);
+    if (MaxKeys <= m_Capacity)
+        return;
+
+    const Uint32 NumBlocks     = (MaxKeys + kGroupSize - 1) / kGroupSize;
+    const Uint32 NumHist       = kNumDigits * NumBlocks;
+    const Uint32 NumScanBlocks = (NumHist + kScanBlockSize - 1) / kScanBlockSize;
+
+    auto CreateRWBuffer = [&](const char* Name, Uint32 Count, RefCntAutoPtr<IBuffer>& pBuffer) {
+        BufferDesc Desc;
+        Desc.Name              = Name;
+        Desc.Usage             = USAGE_DEFAULT;
+        Desc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+        Desc.Mode              = BUFFER_MODE_STRUCTURED;
+        Desc.ElementByteStride = sizeof(Uint32);
+        Desc.Size              = Uint64{sizeof(Uint32)} * Count;
+        pBuffer.Release();
+        m_pDevice->CreateBuffer(Desc, nullptr, &pBuffer);
+    };
+    CreateRWBuffer("Radix sort temp keys", MaxKeys, m_TempKeys);
+    CreateRWBuffer("Radix sort temp values", MaxKeys, m_TempValues);
+    CreateRWBuffer("Radix sort block histogram", NumHist, m_BlockHist);
+    CreateRWBuffer("Radix sort block sums", NumScanBlocks, m_BlockSums);
+    m_Capacity = MaxKeys;
+
+    // The SRBs reference the old scratch buffers
+    m_pBoundKeys.Release();
+    m_pBoundValues.Release();
+}
+
+void GPURadixSort::BindBuffers(IBuffer* pKeys, IBuffer* pValues)
+{
+    for (Uint32 Parity = 0; Parity < 2; ++Parity)
+    {
+        IBuffer* pSrcKeys   = Parity == 0 ? pKeys : m_TempKeys.RawPtr();
+        IBuffer* pSrcValues = Parity == 0 ? pValues : m_TempValues.RawPtr();
+        IBuffer* pDstKeys   = Parity == 0 ? m_TempKeys.RawPtr() : pKeys;
+        IBuffer* pDstValues = Parity == 0 ? m_TempValues.RawPtr() : pValues;
+
+        // Every pass only declares the buffers it touches
+        const std::pair<const char*, IBuffer*> Bindings[] =
+            {
+                {"g_SrcKeys", pSrcKeys},
+                {"g_SrcValues", pSrcValues},
+                {"g_DstKeys", pDstKeys},
+                {"g_DstValues", pDstValues},
+                {"g_BlockHist", m_BlockHist},
+                {"g_BlockSums", m_BlockSums},
+            };
+        for (Uint32 Pass = 0; Pass < SORT_PASS_COUNT; ++Pass)
+        {
+            auto& pSRB = m_SRBs[Parity][Pass];
+            pSRB.Release();
+            m_PSOs[Pass]->CreateShaderResourceBinding(&pSRB, true);
+            for (const auto& Binding : Bindings)
+            {
+                if (IShaderResourceVariable* pVar = pSRB->GetVariableByName(SHADER_TYPE_COMPUTE, Binding.first))
+                    pVar->Set(Binding.second->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+            }
+        }
+    }
+    m_pBoundKeys   = pKeys;
+    m_pBoundValues = pValues;
+}
+
+bool GPURadixSort::Sort(IDeviceContext* pContext,
+                        IBuffer*        pKeys,
+                        IBuffer*        pValues,
+                        Uint32          NumKeys,
+                        bool            InitValues,
+                        Uint32          NumKeyBits)
+{
+    VERIFY(NumKeyBits > 0 && NumKeyBits <= 32, "Key width must be in [1, 32] bits");
+    if (NumKeys == 0)
+        return true;
+    if (NumKeys > kMaxKeys)
+    {
+        // The scan would silently drop block sums and produce a corrupt permutation
+        LOG_ERROR_MESSAGE("GPURadixSort cannot sort ", NumKeys, " keys, the limit is ", kMaxKeys);
+        return false;
+    }
+
+    Reserve(NumKeys);
+    if (m_pBoundKeys != pKeys || m_pBoundValues != pValues)
+        BindBuffers(pKeys, pValues);
+
+    const Uint32 NumBlocks      = (NumKeys + kGroupSize - 1) / kGroupSize;
+    const Uint32 NumHist        = kNumDigits * NumBlocks;
+    const Uint32 NumHistGroups  = (NumHist + kScanGroupSize - 1) / kScanGroupSize;
+    const Uint32 NumScanBlocks  = (NumHist + kScanBlockSize - 1) / kScanBlockSize;
+    const Uint32 NumDigitPasses = (NumKeyBits + kRadixBits - 1) / kRadixBits;
+
+    for (Uint32 DigitPass = 0; DigitPass < NumDigitPasses; ++DigitPass)
+    {
+        {
+            MapHelper<RadixSortConstants> CB(pContext, m_CB, MAP_WRITE, MAP_FLAG_DISCARD);
+            CB->NumKeys    = NumKeys;
+            CB->NumBlocks  = NumBlocks;
+            CB->Shift      = DigitPass * kRadixBits;
+            CB->InitValues = InitValues && DigitPass == 0 ? 1 : 0;
+        }
+
+        const PassSRBs& SRBs = m_SRBs[DigitPass & 1];
+
+        auto Dispatch = [&](SORT_PASS Pass, Uint32 GroupsX) {
+            pContext->SetPipelineState(m_PSOs[Pass]);
+            pContext->CommitShaderResources(SRBs[Pass], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            pContext->DispatchCompute(DispatchComputeAttribs{GroupsX, 1, 1});
+        };
+        Dispatch(SORT_PASS_COUNT_DIGITS, NumBlocks);
+        Dispatch(SORT_PASS_SCAN_BLOCKS, NumScanBlocks);
+        Dispatch(SORT_PASS_SCAN_BLOCK_SUMS, 1);
+        Dispatch(SORT_PASS_ADD_BLOCK_OFFSETS, NumHistGroups);
+        Dispatch(SORT_PASS_SCATTER_KEYS, NumBlocks);
+    }
+
+    // An odd number of digit passes leaves the result in the scratch pair
+    if (NumDigitPasses & 1)
+    {
+        const Uint64 Size = Uint64{sizeof(Uint32)} * NumKeys;
+        pContext->CopyBuffer(m_TempKeys, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                             pKeys, 0, Size, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pContext->CopyBuffer(m_TempValues, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                             pValues, 0, Size, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+    return true;
+}
+
+void GPURadixSort::SortReference(std::vector<Uint32>& Keys, std::vector<Uint32>& Values, Uint32 NumKeyBits)
+{
+    VERIFY_EXPR(Keys.size() == Values.size());
+
+    std::vector<Uint32> TmpKeys(Keys.size());
+    std::vector<Uint32> TmpValues(Values.size());
+    for (Uint32 Shift = 0; Shift < NumKeyBits; Shift += kRadixBits)
+    {
+        // Counting sort by one digit; scattering in input order keeps it stable
+        std::array<Uint32, kNumDigits> Offsets = {};
+        for (Uint32 Key : Keys)
+            ++Offsets[(Key >> Shift) & (kNumDigits - 1)];
+
+        Uint32 Sum = 0;
+        for (Uint32& Offset : Offsets)
+        {
+            const Uint32 Count = Offset;
+            Offset             = Sum;
+            Sum += Count;
+        }
+
+        for (size_t i = 0; i < Keys.size(); ++i)
+        {
+            const Uint32 Dst = Offsets[(Keys[i] >> Shift) & (kNumDigits - 1)]++;
+            TmpKeys[Dst]     = Keys[i];
+            TmpValues[Dst]   = Values[i];
+        }
+        Keys.swap(TmpKeys);
+        Values.swap(TmpValues);
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,117 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "DeviceContext.h"
+#include "RefCntAutoPtr.hpp"
+
+namespace Diligent
+{
+
+// Stable GPU radix sort of 32-bit keys with a 32-bit payload (RadixSort.csh).
+// Typical use is sorting per-instance keys with InitValues = true, which turns
+// the payload buffer into the permutation that instanced draws index through.
+class GPURadixSort
+{
+public:
+    static constexpr Uint32 kGroupSize     = 256; // RADIX_GROUP_SIZE in RadixSort.csh
+    static constexpr Uint32 kRadixBits     = 4;   // RADIX_BITS in RadixSort.csh
+    static constexpr Uint32 kNumDigits     = 1u << kRadixBits;
+    static constexpr Uint32 kScanGroupSize = 256; // SCAN_GROUP_SIZE in RadixSort.csh
+    static constexpr Uint32 kScanBlockSize = 2 * kScanGroupSize;
+    // The two-level scan covers kScanBlockSize^2 histogram entries, kNumDigits per key block
+    static constexpr Uint32 kMaxKeys = kScanBlockSize * kScanBlockSize / kNumDigits * kGroupSize;
+
+    GPURadixSort(IRenderDevice* pDevice, IShaderSourceInputStreamFactory* pShaderSourceFactory);
+
+    // Grows the scratch buffers to hold at least MaxKeys keys, at most kMaxKeys
+    void Reserve(Uint32 MaxKeys);
+
+    // Sorts the first NumKeys elements of pKeys in ascending order of their low
+    // NumKeyBits bits and applies the same permutation to pValues. With InitValues,
+    // pValues is treated as holding 0..NumKeys-1 and receives the permutation.
+    // Both buffers must be structured Uint32 buffers with BIND_UNORDERED_ACCESS.
+    // Returns false without sorting if NumKeys exceeds kMaxKeys.
+    bool Sort(IDeviceContext* pContext,
+              IBuffer*        pKeys,
+              IBuffer*        pValues,
+              Uint32          NumKeys,
+              bool            InitValues,
+              Uint32          NumKeyBits = 32);
+
+    Uint32 GetCapacity() const { return m_Capacity; }
+
+    // Serial LSD radix sort with the same digits; the result of Sort() must match it exactly
+    static void SortReference(std::vector<Uint32>& Keys, std::vector<Uint32>& Values, Uint32 NumKeyBits = 32);
+
+private:
+    void BindBuffers(IBuffer* pKeys, IBuffer* pValues);
+
+    enum SORT_PASS : Uint32
+    {
+        SORT_PASS_COUNT_DIGITS = 0,
+        SORT_PASS_SCAN_BLOCKS,
+        SORT_PASS_SCAN_BLOCK_SUMS,
+        SORT_PASS_ADD_BLOCK_OFFSETS,
+        SORT_PASS_SCATTER_KEYS,
+        SORT_PASS_COUNT
+    };
+
+    // Must match RadixSortConstants in RadixSort.csh
+    struct RadixSortConstants
+    {
+        Uint32 NumKeys;
+        Uint32 NumBlocks;
+        Uint32 Shift;
+        Uint32 InitValues;
+    };
+    static_assert(sizeof(RadixSortConstants) % 16 == 0, "CB size must be 16-byte aligned");
+
+    using PassSRBs = std::array<RefCntAutoPtr<IShaderResourceBinding>, SORT_PASS_COUNT>;
+
+    RefCntAutoPtr<IRenderDevice>                               m_pDevice;
+    std::array<RefCntAutoPtr<IPipelineState>, SORT_PASS_COUNT> m_PSOs;
+    // Passes alternate between reading the caller's buffers and the scratch
+    // pair (even passes) and the other way round (odd passes)
+    std::array<PassSRBs, 2> m_SRBs;
+
+    RefCntAutoPtr<IBuffer> m_CB;
+    RefCntAutoPtr<IBuffer> m_TempKeys;
+    RefCntAutoPtr<IBuffer> m_TempValues;
+    RefCntAutoPtr<IBuffer> m_BlockHist;
+    RefCntAutoPtr<IBuffer> m_BlockSums;
+    RefCntAutoPtr<IBuffer> m_pBoundKeys; // caller's buffers the SRBs currently reference
+    RefCntAutoPtr<IBuffer> m_pBoundValues;
+    Uint32                 m_Capacity = 0;
+};
+
+} // namespace Diligent
@@ -0,0 +1,187 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ImageDiff.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#include "Image.h"
+#include "RefCntAutoPtr.hpp"
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+double Luma(const Uint8* pPixel)
+{
+    return 0.299 * pPixel[0] + 0.587 * pPixel[1] + 0.114 * pPixel[2];
+}
+
+} // namespace
+
+ImageDiffResult ImageDiff::Compare(const Uint8* pA, const Uint8* pB, Uint32 Width, Uint32 Height)
+{
+    ImageDiffResult Result;
+
+    // 1) PSNR and the largest channel difference; alpha is ignored
+    const size_t NumPixels = size_t{Width} * Height;
+    double       SqErr     = 0;
+    for (size_t i = 0; i < NumPixels * 4; i += 4)
+    {
+        for (size_t c = 0; c < 3; ++c)
+        {
+            const int Diff = static_cast<int>(pA[i + c]) - static_cast<int>(pB[i + c]);
+            SqErr += Diff * Diff;
+            Result.MaxDiff = std::max(Result.MaxDiff, static_cast<Uint32>(std::abs(Diff)));
+        }
+    }
+    const double MSE = NumPixels > 0 ? SqErr / (NumPixels * 3) : 0;
+    Result.PSNR      = MSE > 0 ? 10.0 * std::log10(255.0 * 255.0 / MSE) : std::numeric_limits<double>::infinity();
+
+    // 2) SSIM of the luma with the usual stabilizing constants for 8-bit data.
+    //    Images smaller than a window are treated as one window.
+    constexpr double C1 = (0.01 * 255) * (0.01 * 255);
+    constexpr double C2 = (0.03 * 255) * (0.03 * 255);
+
+    const Uint32 WinX   = std::min(kSSIMWindow, Width);
+    const Uint32 WinY   = std::min(kSSIMWindow, Height);
+    const Uint32 Stride = std::max(kSSIMWindow / 2, 1u);
+
+    double SSIMSum    = 0;
+    Uint32 NumWindows = 0;
+    for (Uint32 y0 = 0; y0 + WinY <= Height; y0 += Stride)
+    {
+        for (Uint32 x0 = 0; x0 + WinX <= Width; x0 += Stride)
+        {
+            double SumA = 0, SumB = 0, SumAA = 0, SumBB = 0, SumAB = 0;
+            for (Uint32 y = y0; y < y0 + WinY; ++y)
+            {
+                for (Uint32 x = x0; x < x0 + WinX; ++x)
+                {
+                    const size_t Offset = (size_t{y} * Width + x) * 4;
+                    const double a      = Luma(pA + Offset);
+                    const double b      = Luma(pB + Offset);
+                    SumA += a;
+                    SumB += b;
+                    SumAA += a * a;
+                    SumBB += b * b;
+                    SumAB += a * b;
+                }
+            }
+
+            const double N     = static_cast<double>(WinX * WinY);
+            const double MeanA = SumA / N;
+            const double MeanB = SumB / N;
+            const double VarA  = SumAA / N - MeanA * MeanA;
+            const double VarB  = SumBB / N - MeanB * MeanB;
+            const double CovAB = SumAB / N - MeanA * MeanB;
+
+            SSIMSum += ((2 * MeanA * MeanB + C1) * (2 * CovAB + C2)) /
+                ((MeanA * MeanA + MeanB * MeanB + C1) * (VarA + VarB + C2));
+            ++NumWindows;
+        }
+    }
+    Result.SSIM = NumWindows > 0 ? SSIMSum / NumWindows : 1.0;
+
+    return Result;
+}
+
+bool ImageDiff::LoadPNG(const char* Path, std::vector<Uint8>& Pixels, Uint32& Width, Uint32& Height)
+{
+    RefCntAutoPtr<Image> pImage;
+    CreateImageFromFile(Path, &pImage);
+    if (!pImage)
+    {
+        LOG_ERROR_MESSAGE("Failed to load image '", Path, "'");
+        return false;
+    }
+
+    const ImageDesc& Desc = pImage->GetDesc();
+    if (Desc.ComponentType != VT_UINT8 || Desc.NumComponents < 3)
+    {
+        LOG_ERROR_MESSAGE("'", Path, "' is not an 8-bit RGB or RGBA image");
+        return false;
+    }
+
+    // Expand to RGBA8; a missing alpha channel is opaque
+    Width  = Desc.Width;
+    Height = Desc.Height;
+    Pixels.resize(size_t{Width} * Height * 4);
+
+    const Uint8* pSrc = static_cast<const Uint8*>(pImage->GetData()->GetConstDataPtr());
+    for (Uint32 y = 0; y < Height; ++y)
+    {
+        const Uint8* pRow = pSrc + size_t{y} * Desc.RowStride;
+        Uint8*       pDst = &Pixels[size_t{y} * Width * 4];
+        for (Uint32 x = 0; x < Width; ++x, pDst += 4)
+        {
+            const Uint8* pTexel = pRow + size_t{x} * Desc.NumComponents;
+            pDst[0]             = pTexel[0];
+            pDst[1]             = pTexel[1];
+            pDst[2]             = pTexel[2];
+            pDst[3]             = Desc.NumComponents > 3 ? pTexel[3] : 255;
+        }
+    }
+    return true;
+}
+
+bool ImageDiff::SavePNG(const char* Path, const Uint8* pPixels, Uint32 Width, Uint32 Height)
+{
+    Image::EncodeInfo Info;
+    Info.Width      = Width;
+    Info.Height     = Height;
+    Info.TexFormat  = TEX_FORMAT_RGBA8_UNORM;
+    Info.KeepAlpha  = false;
+    Info.pData      = pPixels;
+    Info.Stride     = Width * 4;
+    Info.FileFormat = IMAGE_FILE_FORMAT_PNG;
+
+    RefCntAutoPtr<IDataBlob> pEncoded;
+    Image::Encode(Info, &pEncoded);
+    if (!pEncoded)
+    {
+        LOG_ERROR_MESSAGE("Failed to encode '", Path, "'");
+        return false;
+    }
+
+    std::ofstream File{Path, std::ios::binary};
+    File.write(static_cast<const char*>(pEncoded->GetConstDataPtr()), static_cast<std::streamsize>(pEncoded->GetSize()));
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to write '", Path, "'");
+        return false;
+    }
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,58 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Similarity of two images of the same size
+struct ImageDiffResult
+{
+    double PSNR    = 0; // dB over the RGB channels; +inf for identical images
+    double SSIM    = 0; // mean structural similarity of the luma, 1 for identical images
+    Uint32 MaxDiff = 0; // largest difference of any RGB channel
+};
+
+// Comparison and PNG I/O for the render regression harness.
+// All pixel data is tightly packed RGBA8, top row first.
+class ImageDiff
+{
+public:
+    static constexpr Uint32 kSSIMWindow = 8; // SSIM is averaged over 8x8 windows with a stride of half a window
+
+    static ImageDiffResult Compare(const Uint8* pA, const Uint8* pB, Uint32 Width, Uint32 Height);
+
+    static bool LoadPNG(const char* Path, std::vector<Uint8>& Pixels, Uint32& Width, Uint32& Height);
+    static bool SavePNG(const char* Path, const Uint8* pPixels, Uint32 Width, Uint32 Height);
+};
+
+} // namespace Diligent
@@ -0,0 +1,442 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "InstanceGenerator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+void MulHiLo(Uint32 a, Uint32 b, Uint32& Hi, Uint32& Lo)
+{
+    const Uint64 Product = Uint64{a} * b;
+    Hi                   = static_cast<Uint32>(Product >> 32);
+    Lo                   = static_cast<Uint32>(Product);
+}
+
+Uint32 GCD(Uint32 a, Uint32 b)
+{
+    while (b != 0)
+    {
+        const Uint32 t = a % b;
+        a              = b;
+        b              = t;
+    }
+    return a;
+}
+
+// Runs Fn(t) for every t in [0, NumThreads), t = 0 on the calling thread
+template <typename FnType>
+void RunOnThreads(Uint32 NumThreads, const FnType& Fn)
+{
+    std::vector<std::thread> Threads;
+    Threads.reserve(NumThreads - 1);
+    for (Uint32 t = 1; t < NumThreads; ++t)
+        Threads.emplace_back(Fn, t);
+    Fn(0u);
+    for (std::thread& Thread : Threads)
+        Thread.join();
+}
+
+} // namespace
+
+// Indexed by SPAWN_DISTRIBUTION
+const InstanceGenerator::Distribution InstanceGenerator::Distributions[] =
+    {
+        {"box", &InstanceGenerator::GetBoxCenter},
+        {"poisson", &InstanceGenerator::GetPoissonCenter},
+        {"clustered", &InstanceGenerator::GetClusteredCenter},
+        {"file", &InstanceGenerator::GetFileCenter},
+};
+
+std::array<Uint32, 4> CounterRNG::Generate(Uint32 Index, Uint32 Stream) const
+{
+    // Philox4x32 with the standard 10 rounds and constants (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+    std::array<Uint32, 4> Ctr = {Index, Stream, 0, 0};
+    std::array<Uint32, 2> Key = m_Key;
+    for (int Round = 0; Round < 10; ++Round)
+    {
+        Uint32 Hi0, Lo0, Hi1, Lo1;
+        MulHiLo(0xD2511F53u, Ctr[0], Hi0, Lo0);
+        MulHiLo(0xCD9E8D57u, Ctr[2], Hi1, Lo1);
+        Ctr = {Hi1 ^ Ctr[1] ^ Key[0], Lo1, Hi0 ^ Ctr[3] ^ Key[1], Lo0};
+        Key[0] += 0x9E3779B9u;
+        Key[1] += 0xBB67AE85u;
+    }
+    return Ctr;
+}
+
+float4 CounterRNG::GenerateUniform(Uint32 Index, Uint32 Stream) const
+{
+    // 24 random bits per float, so the result is exactly representable and below 1
+    const std::array<Uint32, 4> Bits  = Generate(Index, Stream);
+    constexpr float             Scale = 1.0f / 16777216.0f;
+    return float4{static_cast<float>(Bits[0] >> 8) * Scale,
+                  static_cast<float>(Bits[1] >> 8) * Scale,
+                  static_cast<float>(Bits[2] >> 8) * Scale,
+                  static_cast<float>(Bits[3] >> 8) * Scale};
+}
+
+const char* InstanceGenerator::GetDistributionName(SPAWN_DISTRIBUTION Distribution)
+{
+    return Distribution >= 0 && Distribution < SPAWN_DISTRIBUTION_COUNT ? Distributions[Distribution].Name : "unknown";
+}
+
+SPAWN_DISTRIBUTION InstanceGenerator::FindDistribution(const std::string& Name)
+{
+    for (int i = 0; i < SPAWN_DISTRIBUTION_COUNT; ++i)
+    {
+        if (Name == Distributions[i].Name)
+            return static_cast<SPAWN_DISTRIBUTION>(i);
+    }
+    return SPAWN_DISTRIBUTION_COUNT;
+}
+
+bool InstanceGenerator::Init(const SpawnDesc& Desc)
+{
+    // 1) Spawn file: one "x y z [phase]" per line, '#' starts a comment
+    std::vector<float4> FilePoints;
+    if (Desc.Distribution == SPAWN_DISTRIBUTION_FILE)
+    {
+        std::ifstream File{Desc.FilePath};
+        if (!File)
+        {
+            LOG_ERROR_MESSAGE("Failed to open spawn file '", Desc.FilePath, "'");
+            return false;
+        }
+
+        std::string Line;
+        for (int LineNum = 1; std::getline(File, Line); ++LineNum)
+        {
+            Line = Line.substr(0, Line.find('#'));
+            if (Line.find_first_not_of(" \t\r") == std::string::npos)
+                continue;
+
+            std::istringstream Stream{Line};
+            float4             Point{0, 0, 0, -1};
+            if (!(Stream >> Point.x >> Point.y >> Point.z))
+            {
+                LOG_ERROR_MESSAGE(Desc.FilePath, '(', LineNum, "): expected 'x y z [phase]'");
+                return false;
+            }
+            Stream >> Point.w;
+            FilePoints.push_back(Point);
+        }
+        if (FilePoints.empty())
+        {
+            LOG_ERROR_MESSAGE("Spawn file '", Desc.FilePath, "' has no points");
+            return false;
+        }
+    }
+
+    m_Desc       = Desc;
+    m_RNG        = CounterRNG{Desc.Seed};
+    m_FilePoints = std::move(FilePoints);
+
+    // 2) Poisson disk: cells at least 2 * MinDistance wide. Each centre is jittered within
+    //    its cell by at most (cell size - MinDistance) per axis, which keeps centres in
+    //    neighbouring cells MinDistance apart. Cells are visited in a seeded order given
+    //    by the bijection c -> (c * Stride + Offset) mod NumCells.
+    //    A grid with fewer cells than NumInstances is refined until it has enough, and the
+    //    minimum distance drops to half the new cell size; the box cannot hold NumInstances
+    //    centres MinDistance apart.
+    const float3& Ext        = Desc.HalfExtent;
+    const auto    GetGridDim = [&](float CellSize) {
+        return std::array<Uint32, 3>{std::max(static_cast<Uint32>(2 * Ext.x / CellSize), 1u),
+                                     std::max(static_cast<Uint32>(2 * Ext.y / CellSize), 1u),
+                                     std::max(static_cast<Uint32>(2 * Ext.z / CellSize), 1u)};
+    };
+    const auto GetNumCells = [](const std::array<Uint32, 3>& Dim) {
+        return Uint64{Dim[0]} * Dim[1] * Dim[2];
+    };
+
+    float CellSize = std::max(2 * Desc.MinDistance, 1e-3f);
+    m_MinDistance  = Desc.MinDistance;
+    if (Desc.Distribution == SPAWN_DISTRIBUTION_POISSON_DISK && GetNumCells(GetGridDim(CellSize)) < Desc.NumInstances)
+    {
+        CellSize = std::max(std::cbrt(8 * Ext.x * Ext.y * Ext.z / Desc.NumInstances), 1e-3f);
+        while (CellSize > 1e-3f && GetNumCells(GetGridDim(CellSize)) < Desc.NumInstances)
+            CellSize *= 0.98f;
+        m_MinDistance = std::min(Desc.MinDistance, CellSize * 0.5f);
+        LOG_INFO_MESSAGE("Poisson disk spawn: ", Desc.NumInstances, " instances need a finer grid, minimum distance reduced from ",
+                         Desc.MinDistance, " to ", m_MinDistance);
+    }
+    m_GridDim  = GetGridDim(CellSize);
+    m_NumCells = static_cast<Uint32>(std::min<Uint64>(GetNumCells(m_GridDim), 0xFFFFFFFFu));
+
+    const std::array<Uint32, 4> Shuffle = m_RNG.Generate(0, RNG_STREAM_CELL_ORDER);
+    m_CellStride                        = m_NumCells > 1 ? Shuffle[0] % (m_NumCells - 1) + 1 : 1;
+    while (GCD(m_CellStride, m_NumCells) != 1)
+        ++m_CellStride;
+    m_CellOffset = Shuffle[1] % m_NumCells;
+
+    return true;
+}
+
+float3 InstanceGenerator::GetCenter(Uint32 Index) const
+{
+    static_assert(sizeof(Distributions) / sizeof(Distributions[0]) == SPAWN_DISTRIBUTION_COUNT, "Update the distribution table");
+    return (this->*Distributions[m_Desc.Distribution].GetCenter)(Index);
+}
+
+float3 InstanceGenerator::GetBoxCenter(Uint32 Index) const
+{
+    const float3& Ext = m_Desc.HalfExtent;
+    const float4  u   = m_RNG.GenerateUniform(Index, RNG_STREAM_POSITION);
+    return float3{(2 * u.x - 1) * Ext.x, (2 * u.y - 1) * Ext.y, (2 * u.z - 1) * Ext.z};
+}
+
+float3 InstanceGenerator::GetPoissonCenter(Uint32 Index) const
+{
+    // Instances beyond the number of cells start another pass over the grid; the minimum
+    // distance only holds within a pass. Init sizes the grid for SpawnDesc::NumInstances,
+    // so only a swarm that grows past that count wraps around.
+    const Uint32 Cell = static_cast<Uint32>((Uint64{Index % m_NumCells} * m_CellStride + m_CellOffset) % m_NumCells);
+    const Uint32 cx   = Cell % m_GridDim[0];
+    const Uint32 cy   = (Cell / m_GridDim[0]) % m_GridDim[1];
+    const Uint32 cz   = Cell / (m_GridDim[0] * m_GridDim[1]);
+
+    const float3& Ext    = m_Desc.HalfExtent;
+    const float3  Size   = float3{2 * Ext.x / m_GridDim[0], 2 * Ext.y / m_GridDim[1], 2 * Ext.z / m_GridDim[2]};
+    const float3  Jitter = float3{std::max(Size.x - m_MinDistance, 0.0f),
+                                 std::max(Size.y - m_MinDistance, 0.0f),
+                                 std::max(Size.z - m_MinDistance, 0.0f)};
+    const float4  u      = m_RNG.GenerateUniform(Index, RNG_STREAM_POSITION);
+    return float3{-Ext.x + cx * Size.x + (Size.x - Jitter.x) * 0.5f + u.x * Jitter.x,
+                  -Ext.y + cy * Size.y + (Size.y - Jitter.y) * 0.5f + u.y * Jitter.y,
+                  -Ext.z + cz * Size.z + (Size.z - Jitter.z) * 0.5f + u.z * Jitter.z};
+}
+
+float3 InstanceGenerator::GetClusteredCenter(Uint32 Index) const
+{
+    const float3& Ext     = m_Desc.HalfExtent;
+    const Uint32  Cluster = m_RNG.Generate(Index, RNG_STREAM_CLUSTER)[0] % std::max(m_Desc.NumClusters, 1u);
+    const float4  c       = m_RNG.GenerateUniform(Cluster, RNG_STREAM_CLUSTER_CENTER);
+
+    // Box-Muller: two pairs of uniforms give three normally distributed offsets
+    const float4 u  = m_RNG.GenerateUniform(Index, RNG_STREAM_POSITION);
+    const float  r0 = std::sqrt(-2.0f * std::log(1.0f - u.x));
+    const float  r1 = std::sqrt(-2.0f * std::log(1.0f - u.z));
+    const float3 n  = float3{r0 * std::cos(2 * PI_F * u.y), r0 * std::sin(2 * PI_F * u.y), r1 * std::cos(2 * PI_F * u.w)};
+    return float3{(2 * c.x - 1) * Ext.x, (2 * c.y - 1) * Ext.y, (2 * c.z - 1) * Ext.z} + n * m_Desc.ClusterRadius;
+}
+
+float3 InstanceGenerator::GetFileCenter(Uint32 Index) const
+{
+    // Counts beyond the file repeat its points
+    const float4& Point = m_FilePoints[Index % m_FilePoints.size()];
+    return float3{Point.x, Point.y, Point.z};
+}
+
+void InstanceGenerator::Generate(Uint32 First, Uint32 Count, float3* pCenters, float* pPhases, Uint32 NumThreads) const
+{
+    const Uint32 NumChunks = (Count + kChunkSize - 1) / kChunkSize;
+    if (NumThreads == 0)
+        NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    NumThreads = std::min(NumThreads, NumChunks);
+    if (NumThreads <= 1)
+    {
+        GenerateRange(First, Count, pCenters, pPhases);
+        return;
+    }
+
+    // Every instance is a pure function of its index, so the chunks are independent
+    // and each thread writes straight into its part of the output arrays
+    std::atomic<Uint32> NextChunk{0};
+    RunOnThreads(NumThreads, [&](Uint32) {
+        for (Uint32 Chunk = NextChunk++; Chunk < NumChunks; Chunk = NextChunk++)
+        {
+            const Uint32 Offset = Chunk * kChunkSize;
+            GenerateRange(First + Offset, std::min(kChunkSize, Count - Offset), pCenters + Offset, pPhases + Offset);
+        }
+    });
+}
+
+void InstanceGenerator::GenerateByCell(Uint32 First, Uint32 Count, float CellSize, float3* pCenters, float* pPhases,
+                                       std::vector<CellRange>& Cells, Uint32 NumThreads) const
+{
+    Cells.clear();
+    if (Count == 0)
+        return;
+
+    // Every thread owns the same contiguous part of the indices in all passes, so the
+    // offsets it takes from its histogram in 4) match what it counted in 3)
+    const Uint32 NumChunks = (Count + kChunkSize - 1) / kChunkSize;
+    if (NumThreads == 0)
+        NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    NumThreads = std::min(NumThreads, NumChunks);
+
+    const auto GetPart = [&](Uint32 t, Uint32& Begin, Uint32& End) {
+        Begin = static_cast<Uint32>(Uint64{Count} * t / NumThreads);
+        End   = static_cast<Uint32>(Uint64{Count} * (t + 1) / NumThreads);
+    };
+
+    // 1) Bounds of the centres. All passes evaluate GetCenter the same way, so an instance
+    //    falls into the same cell each time.
+    std::vector<float3> PartMin(NumThreads), PartMax(NumThreads);
+    RunOnThreads(NumThreads, [&](Uint32 t) {
+        Uint32 Begin, End;
+        GetPart(t, Begin, End);
+        float3 Min{FLT_MAX, FLT_MAX, FLT_MAX}, Max{-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        for (Uint32 i = Begin; i < End; ++i)
+        {
+            const float3 C = GetCenter(First + i);
+            Min            = std::min(Min, C);
+            Max            = std::max(Max, C);
+        }
+        PartMin[t] = Min;
+        PartMax[t] = Max;
+    });
+    float3 Min = PartMin[0], Max = PartMax[0];
+    for (Uint32 t = 1; t < NumThreads; ++t)
+    {
+        Min = std::min(Min, PartMin[t]);
+        Max = std::max(Max, PartMax[t]);
+    }
+
+    // 2) Dense grid over the bounds. Sparse layouts spanning more than kMaxCells cells
+    //    (spawn files, mostly) get proportionally larger cells.
+    double                Size = std::max(CellSize, 1e-3f);
+    std::array<double, 3> Lo   = {};
+    std::array<Uint32, 3> Dim  = {};
+    for (;;)
+    {
+        double NumCells = 1;
+        for (int a = 0; a < 3; ++a)
+        {
+            Lo[a] = std::floor(Min[a] / Size);
+            NumCells *= std::floor(Max[a] / Size) - Lo[a] + 1;
+        }
+        if (NumCells <= kMaxCells)
+            break;
+        Size *= std::max(std::cbrt(NumCells / kMaxCells), 1.01);
+    }
+    for (int a = 0; a < 3; ++a)
+        Dim[a] = static_cast<Uint32>(std::floor(Max[a] / Size) - Lo[a] + 1);
+    const Uint32 NumCells = Dim[0] * Dim[1] * Dim[2];
+
+    const auto GetCell = [&](const float3& C) {
+        Uint32 Cell = 0;
+        for (int a = 2; a >= 0; --a)
+        {
+            const double c = std::min(std::max(std::floor(C[a] / Size) - Lo[a], 0.0), static_cast<double>(Dim[a] - 1));
+            Cell           = Cell * Dim[a] + static_cast<Uint32>(c);
+        }
+        return Cell;
+    };
+
+    // 3) Per-thread histograms, then exclusive offsets: cell-major and by thread within a
+    //    cell, which keeps the index order inside every cell
+    std::vector<Uint32> Offsets(size_t{NumThreads} * NumCells);
+    RunOnThreads(NumThreads, [&](Uint32 t) {
+        Uint32 Begin, End;
+        GetPart(t, Begin, End);
+        Uint32* pCounts = &Offsets[size_t{t} * NumCells];
+        for (Uint32 i = Begin; i < End; ++i)
+            ++pCounts[GetCell(GetCenter(First + i))];
+    });
+    Uint32 Pos = 0;
+    for (Uint32 c = 0; c < NumCells; ++c)
+    {
+        const Uint32 CellStart = Pos;
+        for (Uint32 t = 0; t < NumThreads; ++t)
+        {
+            Uint32& Offset = Offsets[size_t{t} * NumCells + c];
+            const Uint32 n = Offset;
+            Offset         = Pos;
+            Pos += n;
+        }
+        if (Pos > CellStart)
+        {
+            CellRange Range;
+            Range.First = CellStart;
+            Range.Count = Pos - CellStart;
+            Cells.push_back(Range);
+        }
+    }
+
+    // 4) Scatter: every instance is generated straight into its slot
+    RunOnThreads(NumThreads, [&](Uint32 t) {
+        Uint32 Begin, End;
+        GetPart(t, Begin, End);
+        Uint32* pOffsets = &Offsets[size_t{t} * NumCells];
+        for (Uint32 i = Begin; i < End; ++i)
+        {
+            const Uint32 Index = First + i;
+            const float3 C     = GetCenter(Index);
+            const Uint32 Slot  = pOffsets[GetCell(C)]++;
+            pCenters[Slot]     = C;
+            pPhases[Slot]      = GetPhase(Index);
+        }
+    });
+
+    // 5) Bounds of every cell
+    std::atomic<Uint32> NextCell{0};
+    RunOnThreads(NumThreads, [&](Uint32) {
+        for (size_t c = NextCell++; c < Cells.size(); c = NextCell++)
+        {
+            CellRange& Range = Cells[c];
+            Range.Min = Range.Max = pCenters[Range.First];
+            for (Uint32 i = Range.First + 1; i < Range.First + Range.Count; ++i)
+            {
+                Range.Min = std::min(Range.Min, pCenters[i]);
+                Range.Max = std::max(Range.Max, pCenters[i]);
+            }
+        }
+    });
+}
+
+void InstanceGenerator::GenerateRange(Uint32 First, Uint32 Count, float3* pCenters, float* pPhases) const
+{
+    for (Uint32 i = 0; i < Count; ++i)
+    {
+        pCenters[i] = GetCenter(First + i);
+        pPhases[i]  = GetPhase(First + i);
+    }
+}
+
+float InstanceGenerator::GetPhase(Uint32 Index) const
+{
+    const bool FilePhase = m_Desc.Distribution == SPAWN_DISTRIBUTION_FILE && m_FilePoints[Index % m_FilePoints.size()].w >= 0;
+    return FilePhase ?
+        m_FilePoints[Index % m_FilePoints.size()].w :
+        m_RNG.GenerateUniform(Index, RNG_STREAM_PHASE).x * 2 * PI_F;
+}
+
+} // namespace Diligent
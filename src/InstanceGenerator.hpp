@@ -0,0 +1,160 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Counter-based random numbers (Philox4x32-10). Every (seed, index, stream)
+// triple maps to four independent 32-bit values without any sequential state,
+// so instances can be generated in any order, in parallel, and the first N
+// instances are the same whatever the total count.
+class CounterRNG
+{
+public:
+    explicit CounterRNG(Uint64 Seed = 0) :
+        m_Key{static_cast<Uint32>(Seed), static_cast<Uint32>(Seed >> 32)}
+    {}
+
+    std::array<Uint32, 4> Generate(Uint32 Index, Uint32 Stream) const;
+
+    // Four floats in [0, 1)
+    float4 GenerateUniform(Uint32 Index, Uint32 Stream) const;
+
+private:
+    std::array<Uint32, 2> m_Key;
+};
+
+enum SPAWN_DISTRIBUTION : int
+{
+    SPAWN_DISTRIBUTION_UNIFORM_BOX = 0, // uniform in the spawn box
+    SPAWN_DISTRIBUTION_POISSON_DISK,    // jittered grid, centres at least MinDistance apart
+    SPAWN_DISTRIBUTION_CLUSTERED,       // gaussian blobs around NumClusters random points
+    SPAWN_DISTRIBUTION_FILE,            // "x y z [phase]" lines read from FilePath
+    SPAWN_DISTRIBUTION_COUNT
+};
+
+struct SpawnDesc
+{
+    SPAWN_DISTRIBUTION Distribution  = SPAWN_DISTRIBUTION_UNIFORM_BOX;
+    Uint64             Seed          = 0;
+    float3             HalfExtent    = {20, 10, 30}; // spawn box is [-HalfExtent, HalfExtent]
+    float              MinDistance   = 1.5f;         // POISSON_DISK
+    Uint32             NumInstances  = 0;            // POISSON_DISK, instances the grid must have cells for
+    Uint32             NumClusters   = 12;           // CLUSTERED
+    float              ClusterRadius = 3.0f;         // CLUSTERED, standard deviation
+    std::string        FilePath;                     // FILE
+};
+
+// Orbit centres and start phases of the butterfly instances. Instance i
+// depends only on the SpawnDesc and i, see CounterRNG. Every distribution is
+// one GetCenter function listed in the Distributions table; adding one takes
+// an enum value, the function and its table entry.
+class InstanceGenerator
+{
+public:
+    // Loads the spawn file, if any. Returns false and keeps the previous state on failure.
+    bool Init(const SpawnDesc& Desc);
+
+    static constexpr Uint32 kChunkSize = 1u << 16; // instances per parallel task
+
+    // Writes instances [First, First + Count) to pCenters[0..Count) and pPhases[0..Count).
+    // Ranges longer than one chunk are split into chunks that are generated on up to
+    // NumThreads threads (0 - one per hardware thread); the output does not depend on it.
+    void Generate(Uint32 First, Uint32 Count, float3* pCenters, float* pPhases, Uint32 NumThreads = 0) const;
+
+    // Instances [First, First + Count) of one occupied grid cell, see GenerateByCell
+    struct CellRange
+    {
+        Uint32 First = 0; // offset in the output arrays
+        Uint32 Count = 0;
+        float3 Min; // bounds of the centres in the cell
+        float3 Max;
+    };
+
+    static constexpr Uint32 kMaxCells = 1u << 16; // GenerateByCell grows the cells of larger grids
+
+    // Like Generate, but the output is grouped by the cell of a CellSize grid each centre falls
+    // into: Cells receives the occupied cells in z, y, x order, and instances within a cell keep
+    // their index order. Parallel counting sort with one histogram per thread. Instances are
+    // generated again in the scatter pass rather than moved, so nothing per instance is allocated.
+    void GenerateByCell(Uint32 First, Uint32 Count, float CellSize, float3* pCenters, float* pPhases,
+                        std::vector<CellRange>& Cells, Uint32 NumThreads = 0) const;
+
+    const SpawnDesc& GetDesc() const { return m_Desc; }
+    float            GetMinDistance() const { return m_MinDistance; } // POISSON_DISK, after fitting the grid to NumInstances
+
+    static const char*        GetDistributionName(SPAWN_DISTRIBUTION Distribution);
+    static SPAWN_DISTRIBUTION FindDistribution(const std::string& Name); // SPAWN_DISTRIBUTION_COUNT if unknown
+
+private:
+    void   GenerateRange(Uint32 First, Uint32 Count, float3* pCenters, float* pPhases) const;
+    float3 GetCenter(Uint32 Index) const;
+    float  GetPhase(Uint32 Index) const;
+
+    float3 GetBoxCenter(Uint32 Index) const;
+    float3 GetPoissonCenter(Uint32 Index) const;
+    float3 GetClusteredCenter(Uint32 Index) const;
+    float3 GetFileCenter(Uint32 Index) const;
+
+    struct Distribution
+    {
+        const char* Name; // spawn setting of SwarmConfig
+        float3 (InstanceGenerator::*GetCenter)(Uint32 Index) const;
+    };
+    static const Distribution Distributions[]; // indexed by SPAWN_DISTRIBUTION
+
+    // Streams of CounterRNG, one per independent quantity
+    enum RNG_STREAM : Uint32
+    {
+        RNG_STREAM_POSITION = 0,
+        RNG_STREAM_PHASE,
+        RNG_STREAM_CLUSTER,
+        RNG_STREAM_CLUSTER_CENTER,
+        RNG_STREAM_CELL_ORDER,
+    };
+
+    SpawnDesc           m_Desc;
+    CounterRNG          m_RNG;
+    std::vector<float4> m_FilePoints; // xyz - centre, w - phase or a negative value for a random phase
+
+    // POISSON_DISK: cell grid and a bijective shuffle of the cells
+    std::array<Uint32, 3> m_GridDim     = {};
+    Uint32                m_NumCells    = 0;
+    Uint32                m_CellStride  = 1; // odd multiplier coprime with m_NumCells
+    Uint32                m_CellOffset  = 0;
+    float                 m_MinDistance = 0; // Desc.MinDistance, or less if the grid had to be refined
+};
+
+} // namespace Diligent
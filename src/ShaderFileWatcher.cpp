@@ -0,0 +1,154 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ShaderFileWatcher.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include <sys/stat.h>
+#if PLATFORM_LINUX
+#    include <poll.h>
+#    include <sys/inotify.h>
+#    include <unistd.h>
+#endif
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+ShaderFileWatcher::~ShaderFileWatcher()
+{
+    Stop();
+}
+
+bool ShaderFileWatcher::Start(const char* Directory, std::vector<std::string> FileNames)
+{
+    Stop();
+    m_Directory = Directory;
+    m_FileNames = std::move(FileNames);
+
+#if PLATFORM_LINUX
+    m_InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_InotifyFd < 0 || inotify_add_watch(m_InotifyFd, Directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        LOG_WARNING_MESSAGE("Failed to watch shader directory '", Directory, "'; shader hot reload is disabled");
+        if (m_InotifyFd >= 0)
+            close(m_InotifyFd);
+        m_InotifyFd = -1;
+        return false;
+    }
+#endif
+
+    m_StopWorker = false;
+    m_Worker     = std::thread{&ShaderFileWatcher::WatchThread, this};
+    return true;
+}
+
+void ShaderFileWatcher::Stop()
+{
+    if (!m_Worker.joinable())
+        return;
+
+    m_StopWorker = true;
+    m_Worker.join();
+#if PLATFORM_LINUX
+    close(m_InotifyFd);
+    m_InotifyFd = -1;
+#endif
+}
+
+bool ShaderFileWatcher::ConsumeChangedFiles(std::vector<std::string>& Changed)
+{
+    Changed.clear();
+    std::lock_guard<std::mutex> Lock{m_Mtx};
+    if (m_Changed.empty())
+        return false;
+    Changed.swap(m_Changed);
+    return true;
+}
+
+void ShaderFileWatcher::MarkChanged(const std::string& FileName)
+{
+    if (std::find(m_FileNames.begin(), m_FileNames.end(), FileName) == m_FileNames.end())
+        return;
+
+    // An editor may write a file several times in a row; report it once
+    std::lock_guard<std::mutex> Lock{m_Mtx};
+    if (std::find(m_Changed.begin(), m_Changed.end(), FileName) == m_Changed.end())
+        m_Changed.push_back(FileName);
+}
+
+void ShaderFileWatcher::WatchThread()
+{
+#if PLATFORM_LINUX
+    // Events are variable-sized, so read into a buffer that is suitably aligned for inotify_event
+    alignas(inotify_event) char Buffer[4096];
+    while (!m_StopWorker)
+    {
+        // Wake up periodically to check the stop flag
+        pollfd Fd{m_InotifyFd, POLLIN, 0};
+        if (poll(&Fd, 1, kPollIntervalMs) <= 0)
+            continue;
+
+        const ssize_t Size = read(m_InotifyFd, Buffer, sizeof(Buffer));
+        for (ssize_t Offset = 0; Offset < Size;)
+        {
+            const inotify_event* pEvent = reinterpret_cast<const inotify_event*>(Buffer + Offset);
+            if (pEvent->len > 0)
+                MarkChanged(pEvent->name);
+            Offset += sizeof(inotify_event) + pEvent->len;
+        }
+    }
+#else
+    const auto GetModTime = [this](const std::string& FileName) {
+        struct stat Info;
+        return stat((m_Directory + "/" + FileName).c_str(), &Info) == 0 ? static_cast<Int64>(Info.st_mtime) : Int64{0};
+    };
+
+    std::vector<Int64> ModTimes;
+    for (const std::string& FileName : m_FileNames)
+        ModTimes.push_back(GetModTime(FileName));
+
+    while (!m_StopWorker)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds{kPollIntervalMs});
+        for (size_t i = 0; i < m_FileNames.size(); ++i)
+        {
+            const Int64 ModTime = GetModTime(m_FileNames[i]);
+            if (ModTime != ModTimes[i])
+            {
+                ModTimes[i] = ModTime;
+                MarkChanged(m_FileNames[i]);
+            }
+        }
+    }
+#endif
+}
+
+} // namespace Diligent
@@ -0,0 +1,77 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Watches a fixed set of files in one directory from a background thread.
+// Uses inotify on Linux, where editors that save through a temporary file and
+// a rename are caught by IN_MOVED_TO; other platforms poll modification times.
+class ShaderFileWatcher
+{
+public:
+    ~ShaderFileWatcher();
+
+    bool Start(const char* Directory, std::vector<std::string> FileNames);
+    void Stop();
+
+    bool IsRunning() const { return m_Worker.joinable(); }
+
+    // Moves the names of the files modified since the previous call into Changed.
+    // Returns false, without allocating, if there were none.
+    bool ConsumeChangedFiles(std::vector<std::string>& Changed);
+
+private:
+    void WatchThread();
+    void MarkChanged(const std::string& FileName);
+
+    static constexpr int kPollIntervalMs = 200;
+
+    std::string              m_Directory;
+    std::vector<std::string> m_FileNames;
+    std::thread              m_Worker;
+    std::atomic<bool>        m_StopWorker{false};
+#if PLATFORM_LINUX
+    int m_InotifyFd = -1;
+#endif
+
+    // Shared with the worker thread
+    std::mutex               m_Mtx;
+    std::vector<std::string> m_Changed;
+};
+
+} // namespace Diligent
@@ -0,0 +1,141 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "ShaderPermutations.hpp"
+
+#include "Errors.hpp"
+#include "StringTools.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr SHADER_TYPE StageTypes[] = {SHADER_TYPE_VERTEX, SHADER_TYPE_PIXEL};
+
+} // namespace
+
+ShaderPermutationCache::ShaderPermutationCache(IRenderDevice*          pDevice,
+                                               const ShaderCreateInfo& BaseCI,
+                                               const ShaderCreateInfo& VSSource,
+                                               const ShaderCreateInfo& PSSource,
+                                               std::vector<Feature>    Features,
+                                               CreatePSOFunc           CreatePSO) :
+    m_pDevice{pDevice},
+    m_pSourceFactory{BaseCI.pShaderSourceStreamFactory},
+    m_BaseCI{BaseCI},
+    m_StageSources{VSSource, PSSource},
+    m_Features{std::move(Features)},
+    m_CreatePSO{std::move(CreatePSO)}
+{
+    for (const Feature& F : m_Features)
+    {
+        VERIFY(F.NumBits >= 1 && F.NumBits <= 4, "Feature values are passed as single hex digits");
+        VERIFY(F.Shift + F.NumBits <= 32, "Feature does not fit into the key");
+        const PermutationKey Mask = ((1u << F.NumBits) - 1u) << F.Shift;
+        for (Uint32 Stage = 0; Stage < kNumStages; ++Stage)
+        {
+            if (F.Macro != nullptr && (F.Stages & StageTypes[Stage]) != 0)
+                m_StageMasks[Stage] |= Mask;
+        }
+    }
+}
+
+IShader* ShaderPermutationCache::GetShader(Generation& Gen, Uint32 Stage, PermutationKey Key) const
+{
+    // Only the bits of features this stage sees select the shader
+    const PermutationKey StageKey = Key & m_StageMasks[Stage];
+    if (const auto* pSlot = Gen.Shaders[Stage].Find(StageKey))
+        return pSlot->pObject;
+
+    static constexpr const char* Values[] = {"0", "1", "2", "3", "4", "5", "6", "7",
+                                             "8", "9", "10", "11", "12", "13", "14", "15"};
+
+    std::vector<ShaderMacro> Macros;
+    for (const Feature& F : m_Features)
+    {
+        if (F.Macro != nullptr && (F.Stages & StageTypes[Stage]) != 0)
+            Macros.push_back({F.Macro, Values[Decode(Key, F.Shift, F.NumBits)]});
+    }
+
+    ShaderCreateInfo ShaderCI = m_BaseCI;
+    ShaderCI.Desc.ShaderType  = StageTypes[Stage];
+    ShaderCI.Desc.Name        = m_StageSources[Stage].Desc.Name;
+    ShaderCI.FilePath         = m_StageSources[Stage].FilePath;
+    ShaderCI.EntryPoint       = m_StageSources[Stage].EntryPoint;
+    ShaderCI.Macros           = {Macros.data(), static_cast<Uint32>(Macros.size())};
+
+    RefCntAutoPtr<IShader> pShader;
+    m_pDevice->CreateShader(ShaderCI, &pShader);
+    if (!pShader)
+        LOG_ERROR_MESSAGE("Failed to compile permutation ", StageKey, " of '", ShaderCI.FilePath, "'");
+
+    Gen.Shaders[Stage].Insert(StageKey, pShader);
+    return pShader;
+}
+
+IPipelineState* ShaderPermutationCache::CreatePermutation(Generation& Gen, PermutationKey Key, const CreatePSOFunc& CreatePSO) const
+{
+    IShader* pVS = GetShader(Gen, 0, Key);
+    IShader* pPS = GetShader(Gen, 1, Key);
+
+    RefCntAutoPtr<IPipelineState> pPSO;
+    if (pVS != nullptr && pPS != nullptr)
+        CreatePSO(Key, pVS, pPS, &pPSO);
+
+    // Failures are cached as well so that a broken permutation is reported once, not every frame
+    Gen.PSOs.Insert(Key, pPSO);
+    return pPSO;
+}
+
+bool ShaderPermutationCache::UsesFile(const char* FileName) const
+{
+    for (const ShaderCreateInfo& Source : m_StageSources)
+    {
+        if (SafeStrEqual(Source.FilePath, FileName))
+            return true;
+    }
+    return false;
+}
+
+std::vector<PermutationKey> ShaderPermutationCache::GetKeys() const
+{
+    std::vector<PermutationKey> Keys;
+    m_Current.PSOs.ForEach([&](PermutationKey Key, IPipelineState*) { Keys.push_back(Key); });
+    return Keys;
+}
+
+bool ShaderPermutationCache::Rebuild(const std::vector<PermutationKey>& Keys, Generation& Gen, const CreatePSOFunc& CreatePSO) const
+{
+    bool Succeeded = true;
+    for (PermutationKey Key : Keys)
+        Succeeded &= CreatePermutation(Gen, Key, CreatePSO) != nullptr;
+    return Succeeded;
+}
+
+} // namespace Diligent
@@ -0,0 +1,226 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <vector>
+
+#include "RenderDevice.h"
+#include "RefCntAutoPtr.hpp"
+#include "DebugUtilities.hpp"
+
+namespace Diligent
+{
+
+// Packed permutation key. Every feature owns a fixed bit range, see ShaderPermutationCache::Feature.
+using PermutationKey = Uint32;
+
+// Open-addressing hash map from a permutation key to a ref-counted object.
+// Linear probing over a power-of-two table that is kept at most half full,
+// so lookups are a short probe sequence and only Insert() ever allocates.
+template <typename T>
+class PermutationMap
+{
+public:
+    struct Slot
+    {
+        PermutationKey   Key  = 0;
+        bool             Used = false;
+        RefCntAutoPtr<T> pObject; // null if creation failed; the failure is cached too
+    };
+
+    const Slot* Find(PermutationKey Key) const
+    {
+        if (m_Slots.empty())
+            return nullptr;
+
+        const size_t Mask = m_Slots.size() - 1;
+        for (size_t i = Hash(Key) & Mask;; i = (i + 1) & Mask)
+        {
+            const Slot& S = m_Slots[i];
+            if (!S.Used)
+                return nullptr;
+            if (S.Key == Key)
+                return &S;
+        }
+    }
+
+    void Insert(PermutationKey Key, T* pObject)
+    {
+        VERIFY_EXPR(Find(Key) == nullptr);
+        if ((m_Count + 1) * 2 > m_Slots.size())
+            Rehash(std::max<size_t>(m_Slots.size() * 2, 16));
+
+        Slot& S   = m_Slots[FindFree(m_Slots, Key)];
+        S.Key     = Key;
+        S.Used    = true;
+        S.pObject = pObject;
+        ++m_Count;
+    }
+
+    size_t GetCount() const { return m_Count; }
+
+    template <typename HandlerType>
+    void ForEach(HandlerType&& Handler) const
+    {
+        for (const Slot& S : m_Slots)
+        {
+            if (S.Used)
+                Handler(S.Key, S.pObject.RawPtr());
+        }
+    }
+
+    void Clear()
+    {
+        m_Slots.clear();
+        m_Count = 0;
+    }
+
+private:
+    static size_t Hash(PermutationKey Key)
+    {
+        // Fibonacci hashing spreads the low, densely used key bits over the table
+        return static_cast<size_t>((Key * 0x9E3779B9u) >> 7);
+    }
+
+    static size_t FindFree(const std::vector<Slot>& Slots, PermutationKey Key)
+    {
+        const size_t Mask = Slots.size() - 1;
+        size_t       i    = Hash(Key) & Mask;
+        while (Slots[i].Used)
+            i = (i + 1) & Mask;
+        return i;
+    }
+
+    void Rehash(size_t NewSize)
+    {
+        std::vector<Slot> NewSlots(NewSize);
+        for (Slot& S : m_Slots)
+        {
+            if (S.Used)
+                NewSlots[FindFree(NewSlots, S.Key)] = std::move(S);
+        }
+        m_Slots.swap(NewSlots);
+    }
+
+    std::vector<Slot> m_Slots;
+    size_t            m_Count = 0;
+};
+
+// Lazily compiled shader permutations and their pipeline states.
+//
+// Features are declared once as a macro name, a bit range in the key and the
+// stages whose source sees the macro. Get() returns the PSO of a key, creating
+// it on first use: the vertex and pixel shaders are compiled with the macro set
+// of their own bits only, so permutations that differ in pixel-only features
+// share the vertex shader and vice versa. Permutations that are never requested
+// are never compiled.
+//
+// For hot reload, Rebuild() recompiles a set of keys into a separate Generation
+// on any thread, and Swap() installs it between frames.
+class ShaderPermutationCache
+{
+public:
+    static constexpr Uint32 kNumStages = 2; // vertex, pixel
+
+    // Shaders and PSOs created from one version of the sources
+    struct Generation
+    {
+        PermutationMap<IPipelineState>                  PSOs;
+        std::array<PermutationMap<IShader>, kNumStages> Shaders;
+    };
+
+    struct Feature
+    {
+        const char* Macro;   // nullptr for features that only affect pipeline state, e.g. the render target
+        Uint32      Shift;   // first bit in the key
+        Uint32      NumBits; // 1 for switches, up to 4 for enumerations
+        SHADER_TYPE Stages;  // SHADER_TYPE_VERTEX and/or SHADER_TYPE_PIXEL
+    };
+
+    // Creates the PSO of a permutation from its shaders; must bind static resources.
+    // Called on cache misses only.
+    using CreatePSOFunc = std::function<void(PermutationKey Key, IShader* pVS, IShader* pPS, IPipelineState** ppPSO)>;
+
+    // BaseCI provides the language, compile flags and source factory; FilePath, EntryPoint
+    // and Name of every stage are given by VSSource and PSSource.
+    ShaderPermutationCache(IRenderDevice*          pDevice,
+                           const ShaderCreateInfo& BaseCI,
+                           const ShaderCreateInfo& VSSource,
+                           const ShaderCreateInfo& PSSource,
+                           std::vector<Feature>    Features,
+                           CreatePSOFunc           CreatePSO);
+
+    static constexpr PermutationKey Encode(Uint32 Shift, Uint32 Value) { return Value << Shift; }
+    static constexpr Uint32 Decode(PermutationKey Key, Uint32 Shift, Uint32 NumBits) { return (Key >> Shift) & ((1u << NumBits) - 1u); }
+
+    // O(1) and allocation-free when the permutation exists. Returns null if creation failed.
+    IPipelineState* Get(PermutationKey Key)
+    {
+        if (const auto* pSlot = m_Current.PSOs.Find(Key))
+            return pSlot->pObject;
+        return CreatePermutation(m_Current, Key, m_CreatePSO);
+    }
+
+    Uint32 GetNumPSOs() const { return static_cast<Uint32>(m_Current.PSOs.GetCount()); }
+    Uint32 GetNumShaders() const { return static_cast<Uint32>(m_Current.Shaders[0].GetCount() + m_Current.Shaders[1].GetCount()); }
+
+    // True if any stage is compiled from FileName
+    bool UsesFile(const char* FileName) const;
+
+    // Keys of the permutations created so far, e.g. to rebuild them after a source change
+    std::vector<PermutationKey> GetKeys() const;
+
+    // Compiles Keys from the current sources into Gen. Only reads state that is immutable
+    // after construction, so it may run on a worker thread while the main thread renders.
+    // PSOs are created with CreatePSO rather than the constructor's function, so that the
+    // caller can hand over state captured on the main thread.
+    // Returns false if any permutation fails to compile.
+    bool Rebuild(const std::vector<PermutationKey>& Keys, Generation& Gen, const CreatePSOFunc& CreatePSO) const;
+
+    // Replaces all shaders and PSOs. Keys that are missing from Gen are created on next use.
+    void Swap(Generation& Gen) { std::swap(m_Current, Gen); }
+
+private:
+    IPipelineState* CreatePermutation(Generation& Gen, PermutationKey Key, const CreatePSOFunc& CreatePSO) const;
+    IShader*        GetShader(Generation& Gen, Uint32 Stage, PermutationKey Key) const;
+
+    RefCntAutoPtr<IRenderDevice>                   m_pDevice;
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> m_pSourceFactory; // BaseCI only holds a raw pointer
+    ShaderCreateInfo                               m_BaseCI;
+    std::array<ShaderCreateInfo, kNumStages>       m_StageSources;
+    std::array<PermutationKey, kNumStages>         m_StageMasks = {};
+    std::vector<Feature>                           m_Features;
+    CreatePSOFunc                                  m_CreatePSO;
+
+    Generation m_Current;
+};
+
+} // namespace Diligent
@@ -0,0 +1,251 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SkyHDRBaker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// DDS file layout, see the DDS_HEADER and DDS_HEADER_DXT10 documentation
+struct DDSPixelFormat
+{
+    Uint32 Size;
+    Uint32 Flags;
+    Uint32 FourCC;
+    Uint32 RGBBitCount;
+    Uint32 RBitMask;
+    Uint32 GBitMask;
+    Uint32 BBitMask;
+    Uint32 ABitMask;
+};
+
+struct DDSHeader
+{
+    Uint32         Size;
+    Uint32         Flags;
+    Uint32         Height;
+    Uint32         Width;
+    Uint32         PitchOrLinearSize;
+    Uint32         Depth;
+    Uint32         MipMapCount;
+    Uint32         Reserved1[11];
+    DDSPixelFormat PixelFormat;
+    Uint32         Caps;
+    Uint32         Caps2;
+    Uint32         Caps3;
+    Uint32         Caps4;
+    Uint32         Reserved2;
+};
+
+struct DDSHeaderDXT10
+{
+    Uint32 DXGIFormat;
+    Uint32 ResourceDimension;
+    Uint32 MiscFlag;
+    Uint32 ArraySize;
+    Uint32 MiscFlags2;
+};
+static_assert(sizeof(DDSHeader) == 124 && sizeof(DDSHeaderDXT10) == 20, "Unexpected DDS header layout");
+
+constexpr Uint32 kDDSMagic                      = 0x20534444; // 'DDS '
+constexpr Uint32 kDX10FourCC                    = 0x30315844; // 'DX10'
+constexpr Uint32 kDXGIFormatRGBA16Float         = 10;         // DXGI_FORMAT_R16G16B16A16_FLOAT
+constexpr Uint32 kDDSResourceDimensionTexture2D = 3;
+
+float SRGBToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// Round to nearest; values below the smallest normal half flush to zero. The sky
+// never comes near the largest half.
+Uint16 FloatToHalf(float f)
+{
+    Uint32 Bits;
+    std::memcpy(&Bits, &f, sizeof(Bits));
+    const Uint32 Sign     = (Bits >> 16) & 0x8000u;
+    const int    Exponent = static_cast<int>((Bits >> 23) & 0xFFu) - 127 + 15;
+    const Uint32 Mantissa = Bits & 0x7FFFFFu;
+    if (Exponent <= 0)
+        return static_cast<Uint16>(Sign);
+    if (Exponent >= 31)
+        return static_cast<Uint16>(Sign | 0x7C00u);
+    Uint32 Half = Sign | (static_cast<Uint32>(Exponent) << 10) | (Mantissa >> 13);
+    if (Mantissa & 0x1000u)
+        ++Half; // a carry into the exponent is still the correctly rounded value
+    return static_cast<Uint16>(Half);
+}
+
+} // namespace
+
+bool SkyHDRBaker::Bake(const Uint8* pPixels,
+                       Uint32       Width,
+                       Uint32       Height,
+                       Uint32       NumComponents,
+                       Uint32       RowStride,
+                       Uint32       MaxWidth,
+                       float        PeakLuminance,
+                       const char*  Path)
+{
+    if (pPixels == nullptr || Width == 0 || Height == 0 || NumComponents < 3)
+    {
+        LOG_ERROR_MESSAGE("HDR sky source must be a non-empty 8-bit RGB or RGBA image");
+        return false;
+    }
+
+    // 1) Linearize and expand every source texel, then average Scale x Scale blocks.
+    //    Expanding before filtering keeps the energy of small highlights such as the sun.
+    Uint32 Scale = 1;
+    while (Width / Scale > std::max(MaxWidth, 1u) && Height / Scale > 1)
+        Scale *= 2;
+    Uint32 MipW = std::max(Width / Scale, 1u);
+    Uint32 MipH = std::max(Height / Scale, 1u);
+
+    float ToLinear[256];
+    for (int i = 0; i < 256; ++i)
+        ToLinear[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+
+    const float        Peak   = std::max(PeakLuminance, 1.0f);
+    const float        Weight = 1.0f / static_cast<float>(Scale * Scale);
+    std::vector<float> Mip(size_t{MipW} * MipH * 3, 0.0f);
+    for (Uint32 y = 0; y < MipH * Scale && y < Height; ++y)
+    {
+        const Uint8* pRow = pPixels + size_t{y} * RowStride;
+        float*       pDst = &Mip[size_t{y / Scale} * MipW * 3];
+        for (Uint32 x = 0; x < MipW * Scale && x < Width; ++x)
+        {
+            const Uint8* pSrc = pRow + size_t{x} * NumComponents;
+            const float  r    = ToLinear[pSrc[0]];
+            const float  g    = ToLinear[pSrc[1]];
+            const float  b    = ToLinear[pSrc[2]];
+            const float  Y    = 0.2126f * r + 0.7152f * g + 0.0722f * b;
+            const float  Yhdr = std::min(Y / std::max(1.0f - Y, 1e-6f), Peak);
+            const float  k    = Y > 0.0f ? Yhdr / Y * Weight : 0.0f;
+
+            float* pTexel = pDst + (x / Scale) * 3;
+            pTexel[0] += r * k;
+            pTexel[1] += g * k;
+            pTexel[2] += b * k;
+        }
+    }
+
+    // 2) Header for the full mip chain, then every mip as it is filtered down from the previous one
+    Uint32 NumMips = 1;
+    while ((std::max(MipW, MipH) >> NumMips) != 0)
+        ++NumMips;
+
+    DDSHeader Header          = {};
+    Header.Size               = sizeof(DDSHeader);
+    Header.Flags              = 0x1 | 0x2 | 0x4 | 0x8 | 0x1000 | 0x20000; // caps, height, width, pitch, pixel format, mip count
+    Header.Height             = MipH;
+    Header.Width              = MipW;
+    Header.PitchOrLinearSize  = MipW * 8;
+    Header.MipMapCount        = NumMips;
+    Header.PixelFormat.Size   = sizeof(DDSPixelFormat);
+    Header.PixelFormat.Flags  = 0x4; // four CC
+    Header.PixelFormat.FourCC = kDX10FourCC;
+    Header.Caps               = 0x1000 | 0x400000 | 0x8; // texture, mipmap, complex
+
+    DDSHeaderDXT10 HeaderDX10    = {};
+    HeaderDX10.DXGIFormat        = kDXGIFormatRGBA16Float;
+    HeaderDX10.ResourceDimension = kDDSResourceDimensionTexture2D;
+    HeaderDX10.ArraySize         = 1;
+
+    std::FILE* pFile = std::fopen(Path, "wb");
+    if (pFile == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create HDR sky file '", Path, "'");
+        return false;
+    }
+    bool Ok = std::fwrite(&kDDSMagic, sizeof(kDDSMagic), 1, pFile) == 1 &&
+        std::fwrite(&Header, sizeof(Header), 1, pFile) == 1 &&
+        std::fwrite(&HeaderDX10, sizeof(HeaderDX10), 1, pFile) == 1;
+
+    std::vector<Uint16> Row;
+    std::vector<float>  NextMip;
+    for (Uint32 Level = 0; Level < NumMips && Ok; ++Level)
+    {
+        Row.resize(size_t{MipW} * 4);
+        for (Uint32 y = 0; y < MipH && Ok; ++y)
+        {
+            const float* pSrc = &Mip[size_t{y} * MipW * 3];
+            for (Uint32 x = 0; x < MipW; ++x)
+            {
+                Row[x * 4 + 0] = FloatToHalf(pSrc[x * 3 + 0]);
+                Row[x * 4 + 1] = FloatToHalf(pSrc[x * 3 + 1]);
+                Row[x * 4 + 2] = FloatToHalf(pSrc[x * 3 + 2]);
+                Row[x * 4 + 3] = FloatToHalf(1.0f);
+            }
+            Ok = std::fwrite(Row.data(), sizeof(Uint16) * Row.size(), 1, pFile) == 1;
+        }
+        if (Level + 1 == NumMips)
+            break;
+
+        // 2x2 box filter; odd sizes clamp the second tap
+        const Uint32 NextW = std::max(MipW / 2, 1u);
+        const Uint32 NextH = std::max(MipH / 2, 1u);
+        NextMip.resize(size_t{NextW} * NextH * 3);
+        for (Uint32 y = 0; y < NextH; ++y)
+        {
+            const Uint32 y0 = std::min(y * 2, MipH - 1), y1 = std::min(y * 2 + 1, MipH - 1);
+            for (Uint32 x = 0; x < NextW; ++x)
+            {
+                const Uint32 x0 = std::min(x * 2, MipW - 1), x1 = std::min(x * 2 + 1, MipW - 1);
+                for (Uint32 c = 0; c < 3; ++c)
+                {
+                    NextMip[(size_t{y} * NextW + x) * 3 + c] =
+                        0.25f * (Mip[(size_t{y0} * MipW + x0) * 3 + c] + Mip[(size_t{y0} * MipW + x1) * 3 + c] +
+                                 Mip[(size_t{y1} * MipW + x0) * 3 + c] + Mip[(size_t{y1} * MipW + x1) * 3 + c]);
+                }
+            }
+        }
+        Mip.swap(NextMip);
+        MipW = NextW;
+        MipH = NextH;
+    }
+    Ok = std::fclose(pFile) == 0 && Ok;
+
+    if (!Ok)
+    {
+        LOG_ERROR_MESSAGE("Failed to write HDR sky file '", Path, "'");
+        std::remove(Path);
+    }
+    return Ok;
+}
+
+} // namespace Diligent
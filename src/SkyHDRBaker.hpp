@@ -0,0 +1,54 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Conversion step for the HDR path when no real HDR sky (hdrHigh.dds / hdrHigh.hdr)
+// ships with the sample. The 8-bit sRGB sky is linearized and its luminance expanded
+// with an inverse Reinhard curve, Y / (1 - Y) capped at PeakLuminance, so that the
+// sun and bright clouds reach well above 1 while the mid-tones stay close to the PNG.
+// The result is written as an RGBA16F DDS with a full box-filtered mip chain.
+class SkyHDRBaker
+{
+public:
+    // Images wider than MaxWidth are box-filtered down by powers of two first
+    static bool Bake(const Uint8* pPixels,
+                     Uint32       Width,
+                     Uint32       Height,
+                     Uint32       NumComponents,
+                     Uint32       RowStride,
+                     Uint32       MaxWidth,
+                     float        PeakLuminance,
+                     const char*  Path);
+};
+
+} // namespace Diligent
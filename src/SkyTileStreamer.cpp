@@ -0,0 +1,425 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SkyTileStreamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+constexpr Uint32 kSkyTileMagic   = 0x54594B53; // 'SKYT'
+constexpr Uint32 kSkyTileVersion = 1;
+
+Uint32 MipDim(Uint32 Dim, Uint32 Mip)
+{
+    return std::max(Dim >> Mip, 1u);
+}
+
+Uint32 NumTilesAlong(Uint32 Dim, Uint32 TileSize)
+{
+    return (Dim + TileSize - 1) / TileSize;
+}
+
+// Computes the first page-table index of every mip and returns the total tile count
+Uint32 ComputeMipLayout(const SkyTileFileHeader& Header, std::vector<Uint32>& MipFirstTile)
+{
+    MipFirstTile.resize(Header.NumMips);
+    Uint32 NumTiles = 0;
+    for (Uint32 Mip = 0; Mip < Header.NumMips; ++Mip)
+    {
+        MipFirstTile[Mip] = NumTiles;
+        NumTiles += NumTilesAlong(MipDim(Header.Width, Mip), Header.TileSize) *
+            NumTilesAlong(MipDim(Header.Height, Mip), Header.TileSize);
+    }
+    return NumTiles;
+}
+
+float SRGBToLinear(float c)
+{
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float c)
+{
+    return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+} // namespace
+
+SkyTileStreamer::~SkyTileStreamer()
+{
+    Close();
+}
+
+bool SkyTileStreamer::BakeTileFile(const Uint8* pPixels,
+                                   Uint32       Width,
+                                   Uint32       Height,
+                                   Uint32       NumComponents,
+                                   Uint32       RowStride,
+                                   Uint32       TileSize,
+                                   Uint32       Border,
+                                   const char*  Path)
+{
+    if (NumComponents != 3 && NumComponents != 4)
+    {
+        LOG_ERROR_MESSAGE("Sky tile baker expects an 8-bit RGB or RGBA image, got ", NumComponents, " components");
+        return false;
+    }
+
+    SkyTileFileHeader Header;
+    Header.Magic    = kSkyTileMagic;
+    Header.Version  = kSkyTileVersion;
+    Header.Width    = Width;
+    Header.Height   = Height;
+    Header.TileSize = TileSize;
+    Header.Border   = Border;
+    Header.NumMips  = 1;
+    while (MipDim(Width, Header.NumMips - 1) > TileSize || MipDim(Height, Header.NumMips - 1) > TileSize)
+        ++Header.NumMips;
+    if (Header.NumMips > kMaxMips)
+    {
+        LOG_ERROR_MESSAGE("Sky image ", Width, "x", Height, " needs more than ", kMaxMips, " mips at tile size ", TileSize);
+        return false;
+    }
+    std::vector<Uint32> MipFirstTile;
+    Header.NumTiles = ComputeMipLayout(Header, MipFirstTile);
+
+    // 1) Expand mip 0 to RGBA8
+    std::vector<std::vector<Uint8>> Mips(Header.NumMips);
+    Mips[0].resize(size_t{Width} * Height * 4);
+    for (Uint32 y = 0; y < Height; ++y)
+    {
+        const Uint8* pSrc = pPixels + size_t{y} * RowStride;
+        Uint8*       pDst = &Mips[0][size_t{y} * Width * 4];
+        for (Uint32 x = 0; x < Width; ++x, pSrc += NumComponents, pDst += 4)
+        {
+            pDst[0] = pSrc[0];
+            pDst[1] = pSrc[1];
+            pDst[2] = pSrc[2];
+            pDst[3] = NumComponents == 4 ? pSrc[3] : 255;
+        }
+    }
+
+    // 2) Box-filter the mip chain. Colour is averaged in linear space, alpha as is.
+    float ToLinear[256];
+    for (Uint32 i = 0; i < 256; ++i)
+        ToLinear[i] = SRGBToLinear(static_cast<float>(i) / 255.0f);
+
+    for (Uint32 Mip = 1; Mip < Header.NumMips; ++Mip)
+    {
+        const Uint32 SrcW = MipDim(Width, Mip - 1), SrcH = MipDim(Height, Mip - 1);
+        const Uint32 DstW = MipDim(Width, Mip), DstH = MipDim(Height, Mip);
+        const auto&  Src  = Mips[Mip - 1];
+        auto&        Dst  = Mips[Mip];
+        Dst.resize(size_t{DstW} * DstH * 4);
+        for (Uint32 y = 0; y < DstH; ++y)
+        {
+            for (Uint32 x = 0; x < DstW; ++x)
+            {
+                const Uint32 x0 = std::min(2 * x, SrcW - 1), x1 = std::min(2 * x + 1, SrcW - 1);
+                const Uint32 y0 = std::min(2 * y, SrcH - 1), y1 = std::min(2 * y + 1, SrcH - 1);
+
+                const Uint8* Taps[] = {
+                    &Src[(size_t{y0} * SrcW + x0) * 4],
+                    &Src[(size_t{y0} * SrcW + x1) * 4],
+                    &Src[(size_t{y1} * SrcW + x0) * 4],
+                    &Src[(size_t{y1} * SrcW + x1) * 4],
+                };
+                Uint8* pDst = &Dst[(size_t{y} * DstW + x) * 4];
+                for (Uint32 c = 0; c < 4; ++c)
+                {
+                    float Sum = 0;
+                    for (const Uint8* pTap : Taps)
+                        Sum += c < 3 ? ToLinear[pTap[c]] : static_cast<float>(pTap[c]) / 255.0f;
+                    const float Avg = c < 3 ? LinearToSRGB(Sum * 0.25f) : Sum * 0.25f;
+                    pDst[c]         = static_cast<Uint8>(std::min(std::max(Avg, 0.0f), 1.0f) * 255.0f + 0.5f);
+                }
+            }
+        }
+    }
+
+    // 3) Write the header followed by every padded tile, mip by mip
+    std::FILE* pFile = std::fopen(Path, "wb");
+    if (pFile == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to create sky tile file '", Path, "'");
+        return false;
+    }
+
+    const Uint32       Padded = TileSize + 2 * Border;
+    std::vector<Uint8> Tile(size_t{Padded} * Padded * 4);
+    bool               Ok = std::fwrite(&Header, sizeof(Header), 1, pFile) == 1;
+    for (Uint32 Mip = 0; Mip < Header.NumMips && Ok; ++Mip)
+    {
+        const Uint32 MipW   = MipDim(Width, Mip), MipH = MipDim(Height, Mip);
+        const Uint32 TilesX = NumTilesAlong(MipW, TileSize), TilesY = NumTilesAlong(MipH, TileSize);
+        for (Uint32 ty = 0; ty < TilesY && Ok; ++ty)
+        {
+            for (Uint32 tx = 0; tx < TilesX && Ok; ++tx)
+            {
+                for (Uint32 py = 0; py < Padded; ++py)
+                {
+                    // Longitude wraps, latitude clamps at the poles
+                    const int    sy   = static_cast<int>(ty * TileSize + py) - static_cast<int>(Border);
+                    const Uint32 SrcY = static_cast<Uint32>(std::min(std::max(sy, 0), static_cast<int>(MipH) - 1));
+                    for (Uint32 px = 0; px < Padded; ++px)
+                    {
+                        const int    sx   = static_cast<int>(tx * TileSize + px) - static_cast<int>(Border);
+                        const Uint32 SrcX = static_cast<Uint32>((sx % static_cast<int>(MipW) + static_cast<int>(MipW)) % static_cast<int>(MipW));
+                        const Uint8* pSrc = &Mips[Mip][(size_t{SrcY} * MipW + SrcX) * 4];
+                        std::copy(pSrc, pSrc + 4, &Tile[(size_t{py} * Padded + px) * 4]);
+                    }
+                }
+                Ok = std::fwrite(Tile.data(), Tile.size(), 1, pFile) == 1;
+            }
+        }
+    }
+    Ok = std::fclose(pFile) == 0 && Ok;
+
+    if (!Ok)
+        LOG_ERROR_MESSAGE("Failed to write sky tile file '", Path, "'");
+    return Ok;
+}
+
+bool SkyTileStreamer::Open(const char* Path, Uint32 NumSlots)
+{
+    Close();
+
+    m_pFile = std::fopen(Path, "rb");
+    if (m_pFile == nullptr)
+        return false;
+
+    std::vector<Uint32> MipFirstTile;
+    if (std::fread(&m_Header, sizeof(m_Header), 1, m_pFile) != 1 ||
+        m_Header.Magic != kSkyTileMagic || m_Header.Version != kSkyTileVersion ||
+        m_Header.TileSize == 0 || m_Header.NumMips == 0 || m_Header.NumMips > kMaxMips ||
+        ComputeMipLayout(m_Header, MipFirstTile) != m_Header.NumTiles)
+    {
+        LOG_ERROR_MESSAGE("'", Path, "' is not a valid sky tile file");
+        Close();
+        return false;
+    }
+    m_MipFirstTile.swap(MipFirstTile);
+
+    // The coarsest mip is always resident, so it must leave room for streamed tiles
+    const Uint32 NumPinned = m_Header.NumTiles - m_MipFirstTile.back();
+    if (NumSlots <= NumPinned)
+    {
+        LOG_ERROR_MESSAGE("Sky tile cache of ", NumSlots, " slots cannot hold the ", NumPinned, " tiles of the coarsest mip");
+        Close();
+        return false;
+    }
+
+    m_PageTable.assign(m_Header.NumTiles, 0);
+    m_Slots.assign(NumSlots, CacheSlot{});
+    m_PageTableDirty = true;
+    m_LatestStamp    = 0;
+    m_NumResident    = 0;
+    m_NumRequested   = 0;
+
+    // Queue the coarsest mip ahead of anything the worker will load; AllocateSlot pins it
+    for (Uint32 Id = m_MipFirstTile.back(); Id < m_Header.NumTiles; ++Id)
+    {
+        LoadedTile Tile;
+        Tile.Id = Id;
+        if (!ReadTile(Id, Tile.Texels))
+        {
+            LOG_ERROR_MESSAGE("Failed to read sky tile ", Id, " from '", Path, "'");
+            Close();
+            return false;
+        }
+        m_Loaded.push_back(std::move(Tile));
+    }
+
+    m_StopWorker = false;
+    m_Worker     = std::thread{&SkyTileStreamer::WorkerThread, this};
+    return true;
+}
+
+void SkyTileStreamer::Close()
+{
+    if (m_Worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_StopWorker = true;
+        }
+        m_CondVar.notify_all();
+        m_Worker.join();
+    }
+
+    if (m_pFile != nullptr)
+    {
+        std::fclose(m_pFile);
+        m_pFile = nullptr;
+    }
+
+    m_Requests.clear();
+    m_Loaded.clear();
+    m_PageTable.clear();
+    m_Slots.clear();
+    m_MipFirstTile.clear();
+    m_NumResident  = 0;
+    m_NumRequested = 0;
+}
+
+bool SkyTileStreamer::ReadTile(Uint32 Id, std::vector<Uint8>& Texels)
+{
+    Texels.resize(GetTileBytes());
+    const long Offset = static_cast<long>(sizeof(SkyTileFileHeader) + size_t{Id} * Texels.size());
+    return std::fseek(m_pFile, Offset, SEEK_SET) == 0 &&
+        std::fread(Texels.data(), Texels.size(), 1, m_pFile) == 1;
+}
+
+void SkyTileStreamer::ProcessFeedback(const Uint32* pFeedback, Uint32 Stamp)
+{
+    m_LatestStamp  = Stamp;
+    m_NumRequested = 0;
+    m_RequestScratch.clear();
+
+    // Mips are stored fine to coarse, so walking backwards queues coarse tiles
+    // first: they cover more of the screen and sharpen the fallback soonest.
+    for (Uint32 Id = m_Header.NumTiles; Id-- > 0;)
+    {
+        if (pFeedback[Id] != Stamp)
+            continue;
+
+        ++m_NumRequested;
+        if (m_PageTable[Id] != 0)
+            m_Slots[m_PageTable[Id] - 1].LastUsed = Stamp;
+        else if (m_RequestScratch.size() < m_Slots.size())
+            m_RequestScratch.push_back(Id);
+    }
+
+    // Only as many tiles as AllocateSlot can place are worth reading: free slots plus slots
+    // whose tile the latest feedback did not use. Otherwise, with the cache saturated by
+    // visible tiles, the same tiles would be read and dropped again every frame.
+    Uint32 NumPlaceable = 0;
+    for (const CacheSlot& Slot : m_Slots)
+    {
+        if (Slot.Tile == ~0u || (!Slot.Pinned && Slot.LastUsed < Stamp))
+            ++NumPlaceable;
+    }
+
+    {
+        // Loaded tiles that wait for ConsumeLoadedTiles take their slots first.
+        // Replace rather than append: tiles that went out of view are no longer worth loading.
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        const size_t NumBudget = NumPlaceable > m_Loaded.size() ? NumPlaceable - m_Loaded.size() : 0;
+        m_Requests.assign(m_RequestScratch.begin(), m_RequestScratch.begin() + std::min(m_RequestScratch.size(), NumBudget));
+    }
+    m_CondVar.notify_one();
+}
+
+bool SkyTileStreamer::PopLoadedTile(LoadedTile& Tile)
+{
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        if (m_Loaded.empty())
+            return false;
+        Tile = std::move(m_Loaded.front());
+        m_Loaded.pop_front();
+    }
+    m_CondVar.notify_one();
+    return true;
+}
+
+Uint32 SkyTileStreamer::AllocateSlot(Uint32 Id)
+{
+    // The worker may load a tile twice if it was re-requested while in flight
+    if (m_PageTable[Id] != 0)
+        return ~0u;
+
+    // Prefer a free slot, otherwise evict the least recently used tile that
+    // was not requested by the latest feedback
+    Uint32 Slot = ~0u;
+    for (Uint32 s = 0; s < m_Slots.size(); ++s)
+    {
+        const CacheSlot& Candidate = m_Slots[s];
+        if (Candidate.Tile == ~0u)
+        {
+            Slot = s;
+            break;
+        }
+        if (Candidate.Pinned || Candidate.LastUsed >= m_LatestStamp)
+            continue;
+        if (Slot == ~0u || Candidate.LastUsed < m_Slots[Slot].LastUsed)
+            Slot = s;
+    }
+    if (Slot == ~0u)
+        return ~0u; // cache is saturated by visible tiles; the shader keeps using coarser mips
+
+    CacheSlot& Dst = m_Slots[Slot];
+    if (Dst.Tile != ~0u)
+    {
+        m_PageTable[Dst.Tile] = 0;
+        --m_NumResident;
+    }
+    Dst.Tile         = Id;
+    Dst.LastUsed     = m_LatestStamp;
+    Dst.Pinned       = Id >= m_MipFirstTile.back();
+    m_PageTable[Id]  = Slot + 1;
+    m_PageTableDirty = true;
+    ++m_NumResident;
+    return Slot;
+}
+
+void SkyTileStreamer::WorkerThread()
+{
+    std::unique_lock<std::mutex> Lock{m_Mtx};
+    while (true)
+    {
+        m_CondVar.wait(Lock, [this] {
+            return m_StopWorker || (!m_Requests.empty() && m_Loaded.size() < kMaxLoadedTiles);
+        });
+        if (m_StopWorker)
+            break;
+
+        LoadedTile Tile;
+        Tile.Id = m_Requests.front();
+        m_Requests.pop_front();
+
+        // Disk reads happen outside of the lock
+        Lock.unlock();
+        const bool Ok = ReadTile(Tile.Id, Tile.Texels);
+        Lock.lock();
+
+        if (Ok)
+            m_Loaded.push_back(std::move(Tile));
+        else
+            LOG_ERROR_MESSAGE("Failed to read sky tile ", Tile.Id);
+    }
+}
+
+} // namespace Diligent
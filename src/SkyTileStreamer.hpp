@@ -0,0 +1,175 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Paged sky tile file. The equirectangular image and all of its mips are split
+// into TileSize x TileSize RGBA8 tiles, each stored with a Border-texel apron
+// (wrapped horizontally, clamped vertically) so that bilinear filtering never
+// reads outside a tile. Tiles are stored mip by mip, row by row, right after
+// the header, so the offset of any tile follows from its index.
+struct SkyTileFileHeader
+{
+    Uint32 Magic    = 0;
+    Uint32 Version  = 0;
+    Uint32 Width    = 0; // mip 0 size in texels
+    Uint32 Height   = 0;
+    Uint32 TileSize = 0; // texels per tile side, excluding the border
+    Uint32 Border   = 0;
+    Uint32 NumMips  = 0;
+    Uint32 NumTiles = 0; // over all mips
+};
+
+// Streams sky tiles from a paged file into a fixed number of cache slots.
+//
+// The main thread feeds GPU feedback (one stamp per virtual tile) into
+// ProcessFeedback(), which touches resident tiles and queues missing ones for
+// the worker thread. The worker reads tiles from disk; ConsumeLoadedTiles()
+// then assigns them to least-recently-used slots on the main thread and hands
+// the texels out for upload. The coarsest mip is loaded up front and pinned,
+// so every lookup has a resident fallback.
+class SkyTileStreamer
+{
+public:
+    static constexpr Uint32 kMaxMips = 16;
+
+    ~SkyTileStreamer();
+
+    // Splits an 8-bit RGB or RGBA sRGB image into a paged tile file. Mips are
+    // box-filtered in linear space until the whole image fits into one tile.
+    static bool BakeTileFile(const Uint8* pPixels,
+                             Uint32       Width,
+                             Uint32       Height,
+                             Uint32       NumComponents,
+                             Uint32       RowStride,
+                             Uint32       TileSize,
+                             Uint32       Border,
+                             const char*  Path);
+
+    // Opens a tile file, loads and pins the coarsest mip, and starts the worker.
+    bool Open(const char* Path, Uint32 NumSlots);
+    void Close();
+
+    bool IsOpen() const { return m_pFile != nullptr; }
+
+    const SkyTileFileHeader& GetHeader() const { return m_Header; }
+
+    Uint32 GetPaddedTileSize() const { return m_Header.TileSize + 2 * m_Header.Border; }
+    Uint32 GetTileBytes() const { return GetPaddedTileSize() * GetPaddedTileSize() * 4; }
+    Uint32 GetNumSlots() const { return static_cast<Uint32>(m_Slots.size()); }
+    Uint32 GetMipFirstTile(Uint32 Mip) const { return m_MipFirstTile[Mip]; }
+    Uint32 GetNumResidentTiles() const { return m_NumResident; }
+    Uint32 GetNumRequestedTiles() const { return m_NumRequested; }
+
+    // Page table with one entry per virtual tile: 0 - not resident, otherwise cache slot + 1.
+    const std::vector<Uint32>& GetPageTable() const { return m_PageTable; }
+
+    bool IsPageTableDirty() const { return m_PageTableDirty; }
+    void ClearPageTableDirty() { m_PageTableDirty = false; }
+
+    // pFeedback holds GetHeader().NumTiles stamps; tiles whose stamp equals Stamp
+    // were sampled in the frame the feedback was captured in. Missing tiles are queued
+    // only up to the number of slots that could take them.
+    void ProcessFeedback(const Uint32* pFeedback, Uint32 Stamp);
+
+    // Places up to MaxTiles loaded tiles into the cache and calls
+    // Handler(Uint32 Slot, const Uint8* pTexels) for each of them.
+    // Returns the number of tiles placed.
+    template <typename HandlerType>
+    Uint32 ConsumeLoadedTiles(Uint32 MaxTiles, HandlerType&& Handler)
+    {
+        Uint32 NumPlaced = 0;
+        while (NumPlaced < MaxTiles)
+        {
+            LoadedTile Tile;
+            if (!PopLoadedTile(Tile))
+                break;
+
+            const Uint32 Slot = AllocateSlot(Tile.Id);
+            if (Slot == ~0u)
+                continue;
+
+            Handler(Slot, Tile.Texels.data());
+            ++NumPlaced;
+        }
+        return NumPlaced;
+    }
+
+private:
+    struct CacheSlot
+    {
+        Uint32 Tile     = ~0u; // virtual tile currently held, ~0u if free
+        Uint32 LastUsed = 0;   // last feedback stamp that requested the tile
+        bool   Pinned   = false;
+    };
+
+    struct LoadedTile
+    {
+        Uint32             Id = 0;
+        std::vector<Uint8> Texels;
+    };
+
+    bool   ReadTile(Uint32 Id, std::vector<Uint8>& Texels);
+    bool   PopLoadedTile(LoadedTile& Tile);
+    Uint32 AllocateSlot(Uint32 Id);
+    void   WorkerThread();
+
+    SkyTileFileHeader      m_Header;
+    std::FILE*             m_pFile = nullptr;
+    std::vector<Uint32>    m_MipFirstTile;
+    std::vector<Uint32>    m_PageTable;
+    std::vector<CacheSlot> m_Slots;
+    bool                   m_PageTableDirty = false;
+    Uint32                 m_LatestStamp    = 0;
+    Uint32                 m_NumResident    = 0;
+    Uint32                 m_NumRequested   = 0;
+    std::vector<Uint32>    m_RequestScratch;
+
+    // Shared with the worker thread
+    std::thread             m_Worker;
+    std::mutex              m_Mtx;
+    std::condition_variable m_CondVar;
+    std::deque<Uint32>      m_Requests; // most important first
+    std::deque<LoadedTile>  m_Loaded;
+    bool                    m_StopWorker = false;
+
+    static constexpr size_t kMaxLoadedTiles = 32; // worker stalls when the main thread falls behind
+};
+
+} // namespace Diligent
@@ -0,0 +1,150 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "StateExchange.hpp"
+
+#include <chrono>
+#include <thread>
+
+#include "Errors.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+// Every field holds the same counter, so a torn copy has mismatching fields
+struct StressState
+{
+    Uint32 Fields[40];
+};
+
+} // namespace
+
+bool RunStateExchangeStressTest(Uint32 NumReaders, double Seconds)
+{
+    using ArrayExchange = EpochExchange<std::vector<Uint32>>;
+    NumReaders          = std::min(std::max(NumReaders, 1u), ArrayExchange::kMaxReaders);
+
+    constexpr Uint32     kArraySize = 4096;
+    SeqLock<StressState> SeqState;
+    ArrayExchange        Arrays;
+    std::atomic<bool>    Stop{false};
+    std::atomic<Uint32>  NumErrors{0};
+    std::vector<Uint64>  NumReads(NumReaders);
+
+    // 1) Readers check that every copy and every version they hold is intact. A version
+    //    recycled too early shows up as its contents changing under the reader.
+    std::vector<std::thread> Readers;
+    for (Uint32 r = 0; r < NumReaders; ++r)
+    {
+        Readers.emplace_back([&, r]() {
+            const Uint32                  Reader    = Arrays.AddReader();
+            Uint32                        LastSeq   = 0;
+            Uint64                        LastEpoch = 0;
+            Uint64                        Reads     = 0;
+            const ArrayExchange::Version* pPrev     = nullptr;
+            while (!Stop.load(std::memory_order_relaxed))
+            {
+                const StressState State = SeqState.Read();
+                for (Uint32 f = 1; f < _countof(State.Fields); ++f)
+                {
+                    if (State.Fields[f] != State.Fields[0])
+                        NumErrors.fetch_add(1);
+                }
+                if (State.Fields[0] < LastSeq)
+                    NumErrors.fetch_add(1);
+                LastSeq = State.Fields[0];
+
+                // Keep the previous version alive alongside the latest, like interpolation does
+                const auto* pLatest = Arrays.Acquire(Reader, pPrev != nullptr ? pPrev->Epoch : ~Uint64{0});
+                if (pLatest == nullptr)
+                    continue;
+                if (pLatest->Epoch < LastEpoch)
+                    NumErrors.fetch_add(1);
+                LastEpoch = pLatest->Epoch;
+                for (const auto* pVersion : {pPrev, pLatest})
+                {
+                    if (pVersion == nullptr)
+                        continue;
+                    if (pVersion->Value.size() != kArraySize)
+                    {
+                        NumErrors.fetch_add(1);
+                        continue;
+                    }
+                    for (Uint32 Value : pVersion->Value)
+                    {
+                        if (Value != static_cast<Uint32>(pVersion->Epoch))
+                        {
+                            NumErrors.fetch_add(1);
+                            break;
+                        }
+                    }
+                }
+                pPrev = pLatest;
+                ++Reads;
+            }
+            Arrays.Release(Reader);
+            NumReads[r] = Reads;
+        });
+    }
+
+    // 2) The producer rewrites both as fast as it can
+    Uint64     NumWrites = 0;
+    const auto Start     = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double>{std::chrono::steady_clock::now() - Start}.count() < Seconds)
+    {
+        StressState State;
+        for (Uint32& Field : State.Fields)
+            Field = static_cast<Uint32>(NumWrites + 1);
+        SeqState.Write(State);
+
+        std::vector<Uint32>& Values = Arrays.BeginWrite();
+        Values.assign(kArraySize, static_cast<Uint32>(Arrays.GetEpoch() + 1));
+        Arrays.Publish();
+        ++NumWrites;
+    }
+    Stop.store(true);
+    for (std::thread& Reader : Readers)
+        Reader.join();
+
+    Uint64 TotalReads = 0;
+    for (Uint64 Reads : NumReads)
+        TotalReads += Reads;
+
+    if (NumErrors.load() != 0)
+    {
+        LOG_ERROR_MESSAGE("State exchange stress test: ", NumErrors.load(), " inconsistent reads in ", TotalReads,
+                          " reads of ", NumWrites, " writes");
+        return false;
+    }
+    LOG_INFO_MESSAGE("State exchange stress test: passed, ", NumWrites, " writes, ", TotalReads, " reads by ", NumReaders, " readers");
+    return true;
+}
+
+} // namespace Diligent
@@ -0,0 +1,221 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Lock-free exchange of state between the thread that produces it and the
+// threads that consume it. Neither side ever blocks the other.
+//
+// SeqLock suits small, trivially copyable structs that are rewritten as a whole
+// (camera, view-projection, frame time). EpochExchange suits large arrays
+// (instance transforms): readers get a pointer to a published version instead
+// of a copy, and the producer recycles a version once no reader can still see it.
+
+// Single writer, any number of readers. The writer never waits. A reader retries
+// if the writer was in the middle of an update, so it always gets a consistent
+// copy. The payload is held in atomic words: a reader that sees any word of a new
+// write also sees the odd sequence number that precedes it, and torn reads that the
+// retry discards stay well-defined. No standalone fences, so TSan models it fully.
+template <typename T>
+class SeqLock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock copies T as raw words");
+
+public:
+    void Write(const T& Value)
+    {
+        Words W = {};
+        std::memcpy(W.data(), &Value, sizeof(T));
+
+        const Uint32 Seq = m_Seq.load(std::memory_order_relaxed);
+        m_Seq.store(Seq + 1, std::memory_order_relaxed); // odd - write in progress
+        for (size_t i = 0; i < kNumWords; ++i)
+            m_Data[i].store(W[i], std::memory_order_release);
+        m_Seq.store(Seq + 2, std::memory_order_release);
+    }
+
+    T Read() const
+    {
+        Words  W;
+        Uint32 Seq0, Seq1;
+        do
+        {
+            Seq0 = m_Seq.load(std::memory_order_acquire);
+            for (size_t i = 0; i < kNumWords; ++i)
+                W[i] = m_Data[i].load(std::memory_order_acquire);
+            Seq1 = m_Seq.load(std::memory_order_relaxed);
+        } while ((Seq0 & 1u) != 0 || Seq0 != Seq1);
+
+        T Value;
+        std::memcpy(&Value, W.data(), sizeof(T));
+        return Value;
+    }
+
+    // Number of completed writes
+    Uint32 GetVersion() const { return m_Seq.load(std::memory_order_acquire) >> 1; }
+
+private:
+    static constexpr size_t kNumWords = (sizeof(T) + sizeof(Uint64) - 1) / sizeof(Uint64);
+    using Words                       = std::array<Uint64, kNumWords>;
+
+    std::atomic<Uint32>                        m_Seq{0};
+    std::array<std::atomic<Uint64>, kNumWords> m_Data{};
+};
+
+// Single producer, up to kMaxReaders readers. Every published version gets the
+// next epoch. A reader pins an epoch while it holds versions; a version retired
+// (replaced by a newer one) at epoch R is recycled only once every pinned reader
+// has moved past R. Versions are recycled, not freed, so containers inside T
+// keep their storage and a steady-state producer does not allocate.
+template <typename T>
+class EpochExchange
+{
+public:
+    static constexpr Uint32 kMaxReaders = 8;
+
+    struct Version
+    {
+        T      Value;
+        Uint64 Epoch     = 0; // epoch it was published at
+        Uint64 RetiredAt = 0; // epoch of the version that replaced it
+    };
+
+    // --- Producer ---------------------------------------------------------
+
+    // Returns the value to fill for the next Publish(). It may hold the contents
+    // of an older version.
+    T& BeginWrite()
+    {
+        if (!m_pWriting)
+        {
+            Reclaim();
+            if (!m_Free.empty())
+            {
+                m_pWriting = std::move(m_Free.back());
+                m_Free.pop_back();
+            }
+            else
+            {
+                m_pWriting = std::make_unique<Version>();
+            }
+        }
+        return m_pWriting->Value;
+    }
+
+    void Publish()
+    {
+        // The epoch is advanced before the swap: a reader that pins the new epoch
+        // but still loads the old version keeps that version alive, see Reclaim().
+        m_pWriting->Epoch = m_Epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        m_pCurrent.store(m_pWriting.get(), std::memory_order_seq_cst);
+        if (m_pPublished)
+        {
+            m_pPublished->RetiredAt = m_pWriting->Epoch;
+            m_Retired.push_back(std::move(m_pPublished));
+        }
+        m_pPublished = std::move(m_pWriting);
+    }
+
+    Uint64 GetEpoch() const { return m_Epoch.load(std::memory_order_acquire); }
+
+    // --- Readers ----------------------------------------------------------
+
+    // Returns the reader slot, or ~0u if all kMaxReaders are taken
+    Uint32 AddReader()
+    {
+        const Uint32 Reader = m_NumReaders.fetch_add(1, std::memory_order_relaxed);
+        return Reader < kMaxReaders ? Reader : ~0u;
+    }
+
+    // Returns the latest version, or null if nothing has been published yet. It stays
+    // valid until the reader's next Acquire() or Release(). To keep holding versions
+    // from earlier calls, pass the smallest Epoch among them in OldestHeld.
+    const Version* Acquire(Uint32 Reader, Uint64 OldestHeld = ~Uint64{0})
+    {
+        const Uint64 Pin = std::min(OldestHeld, m_Epoch.load(std::memory_order_seq_cst));
+        m_Pins[Reader].store(std::max(Pin, Uint64{1}), std::memory_order_seq_cst);
+        return m_pCurrent.load(std::memory_order_seq_cst);
+    }
+
+    // Drops all versions the reader holds
+    void Release(Uint32 Reader)
+    {
+        m_Pins[Reader].store(0, std::memory_order_seq_cst);
+    }
+
+private:
+    // Producer only. A version retired at R may still be read by any reader whose
+    // pin is at most R: the reader pinned before R and may have loaded it.
+    void Reclaim()
+    {
+        Uint64 MinPin = ~Uint64{0};
+        for (const std::atomic<Uint64>& Pin : m_Pins)
+        {
+            const Uint64 p = Pin.load(std::memory_order_seq_cst);
+            if (p != 0)
+                MinPin = std::min(MinPin, p);
+        }
+
+        // Retired versions are in epoch order
+        size_t NumReclaimed = 0;
+        while (NumReclaimed < m_Retired.size() && m_Retired[NumReclaimed]->RetiredAt < MinPin)
+            m_Free.push_back(std::move(m_Retired[NumReclaimed++]));
+        m_Retired.erase(m_Retired.begin(), m_Retired.begin() + NumReclaimed);
+    }
+
+    // Producer state
+    std::unique_ptr<Version>              m_pWriting;
+    std::unique_ptr<Version>              m_pPublished; // owns m_pCurrent
+    std::vector<std::unique_ptr<Version>> m_Retired;    // replaced, possibly still read
+    std::vector<std::unique_ptr<Version>> m_Free;       // safe to overwrite
+
+    // Shared
+    std::atomic<Version*>                        m_pCurrent{nullptr};
+    std::atomic<Uint64>                          m_Epoch{0};
+    std::array<std::atomic<Uint64>, kMaxReaders> m_Pins{}; // 0 - the reader holds nothing
+    std::atomic<Uint32>                          m_NumReaders{0};
+};
+
+// Hammers a SeqLock and an EpochExchange from one producer and NumReaders reader
+// threads for Seconds and checks that no reader ever sees a torn or recycled
+// value. Meant to be run under ThreadSanitizer as well. Returns true on success.
+bool RunStateExchangeStressTest(Uint32 NumReaders, double Seconds);
+
+} // namespace Diligent
@@ -0,0 +1,175 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#include "SwarmConfig.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+#include "Errors.hpp"
+#include "InstanceGenerator.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+std::string Trim(const std::string& Str)
+{
+    const size_t Begin = Str.find_first_not_of(" \t\r\n");
+    if (Begin == std::string::npos)
+        return {};
+    const size_t End = Str.find_last_not_of(" \t\r\n");
+    return Str.substr(Begin, End - Begin + 1);
+}
+
+// strtof also accepts "nan" and "inf", which would poison every orbit and bounding box
+bool ParseFloat(const std::string& Str, float MinValue, float& Value)
+{
+    char* pEnd = nullptr;
+    errno      = 0;
+    const float f = std::strtof(Str.c_str(), &pEnd);
+    if (Str.empty() || *pEnd != '\0' || errno != 0 || !std::isfinite(f) || f < MinValue)
+        return false;
+    Value = f;
+    return true;
+}
+
+bool ParseUint(const std::string& Str, Uint32& Value)
+{
+    char* pEnd = nullptr;
+    errno      = 0;
+    const unsigned long u = std::strtoul(Str.c_str(), &pEnd, 10);
+    if (Str.empty() || Str[0] == '-' || *pEnd != '\0' || errno != 0 || u > 0xFFFFFFFFul)
+        return false;
+    Value = static_cast<Uint32>(u);
+    return true;
+}
+
+struct FloatParam
+{
+    const char* Name;
+    float SwarmConfig::*pMember;
+    float MinValue;
+};
+
+constexpr FloatParam FloatParams[] =
+    {
+        // Negative values are not meaningful for any of these and break the culling bounds
+        {"radius", &SwarmConfig::Radius, 0.0f},
+        {"speed", &SwarmConfig::Speed, 0.0f},
+        {"bob_amp", &SwarmConfig::BobAmp, 0.0f},
+        {"bob_freq", &SwarmConfig::BobFreq, 0.0f},
+        {"wing_factor", &SwarmConfig::WingFactor, 0.0f},
+        {"wing_amp", &SwarmConfig::WingAmp, 0.0f},
+        {"min_distance", &SwarmConfig::MinDistance, 0.0f},
+        {"cluster_radius", &SwarmConfig::ClusterRadius, 0.0f},
+};
+
+} // namespace
+
+bool SwarmConfig::SetValue(const std::string& Name, const std::string& Value)
+{
+    if (Name == "instances")
+        return ParseUint(Value, InstanceCount);
+    if (Name == "species")
+        return ParseUint(Value, NumSpecies);
+    if (Name == "seed")
+        return ParseUint(Value, Seed);
+    if (Name == "clusters")
+        return ParseUint(Value, NumClusters) && NumClusters > 0;
+    if (Name == "spawn")
+    {
+        if (InstanceGenerator::FindDistribution(Value) == SPAWN_DISTRIBUTION_COUNT)
+            return false;
+        Spawn = Value;
+        return true;
+    }
+    if (Name == "spawn_file")
+    {
+        SpawnFile = Value;
+        return true;
+    }
+
+    for (const FloatParam& Param : FloatParams)
+    {
+        if (Name == Param.Name)
+            return ParseFloat(Value, Param.MinValue, this->*Param.pMember);
+    }
+    return false;
+}
+
+bool SwarmConfig::LoadFromFile(const char* Path)
+{
+    std::ifstream File{Path};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to open swarm config file '", Path, "'");
+        return false;
+    }
+
+    std::string Line;
+    for (int LineNum = 1; std::getline(File, Line); ++LineNum)
+    {
+        Line = Trim(Line.substr(0, Line.find('#')));
+        if (Line.empty())
+            continue;
+
+        const size_t Eq = Line.find('=');
+        if (Eq == std::string::npos || !SetValue(Trim(Line.substr(0, Eq)), Trim(Line.substr(Eq + 1))))
+        {
+            LOG_ERROR_MESSAGE(Path, '(', LineNum, "): invalid swarm config entry '", Line, "'");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SwarmConfig::SaveToFile(const char* Path) const
+{
+    std::ofstream File{Path};
+    if (!File)
+    {
+        LOG_ERROR_MESSAGE("Failed to write swarm config file '", Path, "'");
+        return false;
+    }
+
+    File << "instances = " << InstanceCount << '\n';
+    File << "species = " << NumSpecies << '\n';
+    File << "seed = " << Seed << '\n';
+    File << "clusters = " << NumClusters << '\n';
+    File << "spawn = " << Spawn << '\n';
+    if (!SpawnFile.empty())
+        File << "spawn_file = " << SpawnFile << '\n';
+    for (const FloatParam& Param : FloatParams)
+        File << Param.Name << " = " << this->*Param.pMember << '\n';
+    return true;
+}
+
+} // namespace Diligent
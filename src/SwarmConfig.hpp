@@ -0,0 +1,68 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+#pragma once
+
+#include <string>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Tunable swarm parameters. Can be set from the settings window, from the
+// command line (--swarm_<name> <value> or --swarm_<name>=<value>) or from a
+// config file passed with --swarm_config <path>.
+//
+// Config files hold one "<name> = <value>" pair per line; '#' starts a comment.
+struct SwarmConfig
+{
+    Uint32 InstanceCount = 50;    // instances
+    float  Radius        = 6.0f;  // radius: circle radius
+    float  Speed         = 0.75f; // speed: radians·s-¹
+    float  BobAmp        = 0.25f; // bob_amp: vertical amplitude
+    float  BobFreq       = 0.80f; // bob_freq: Hz
+    float  WingFactor    = 6.0f;  // wing_factor: flaps per bob
+    float  WingAmp       = 0.60f; // wing_amp: radians
+    Uint32 NumSpecies    = 1;     // species: wing textures in use, 1..16
+    Uint32 Seed          = 0;     // seed: spawn seed, 0 picks a new one on every reset
+
+    std::string Spawn = "box"; // spawn: box, poisson, clustered or file (see InstanceGenerator)
+    std::string SpawnFile;     // spawn_file: "x y z [phase]" per line, for spawn = file
+
+    float  MinDistance   = 1.5f; // min_distance: centre spacing for spawn = poisson, reduced for swarms that do not fit
+    Uint32 NumClusters   = 12;   // clusters: blobs for spawn = clustered
+    float  ClusterRadius = 3.0f; // cluster_radius: blob standard deviation for spawn = clustered
+
+    // Sets a parameter by name. Returns false if the name is unknown or the value is malformed
+    // or out of range (non-finite or negative floats, zero clusters).
+    bool SetValue(const std::string& Name, const std::string& Value);
+
+    bool LoadFromFile(const char* Path);
+    bool SaveToFile(const char* Path) const;
+};
+
+} // namespace Diligent
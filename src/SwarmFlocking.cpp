@@ -0,0 +1,162 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SwarmFlocking.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Diligent
+{
+
+namespace
+{
+
+Uint32 ToCell(float P, float Origin, float CellSize, Uint32 Dim)
+{
+    const int c = static_cast<int>(std::floor((P - Origin) / CellSize));
+    return static_cast<Uint32>(std::min(std::max(c, 0), static_cast<int>(Dim) - 1));
+}
+
+float3 XYZ(const float4& v)
+{
+    return float3{v.x, v.y, v.z};
+}
+
+} // namespace
+
+Uint32 FlockingReference::GetCellIndex(const float3& Pos, const FlockConstants& Consts)
+{
+    const Uint32 x = ToCell(Pos.x, Consts.GridOrigin.x, Consts.CellSize, Consts.GridDimX);
+    const Uint32 y = ToCell(Pos.y, Consts.GridOrigin.y, Consts.CellSize, Consts.GridDimY);
+    const Uint32 z = ToCell(Pos.z, Consts.GridOrigin.z, Consts.CellSize, Consts.GridDimZ);
+    return x + Consts.GridDimX * (y + Consts.GridDimY * z);
+}
+
+void FlockingReference::Step(std::vector<FlockAgent>& Agents, const FlockConstants& Consts)
+{
+    const Uint32 NumAgents = static_cast<Uint32>(Agents.size());
+    const Uint32 NumCells  = Consts.GridDimX * Consts.GridDimY * Consts.GridDimZ;
+
+    // 1) Bin agents into grid cells
+    m_CellCounts.assign(NumCells, 0);
+    m_AgentCell.resize(NumAgents);
+    for (Uint32 i = 0; i < NumAgents; ++i)
+    {
+        const Uint32 Cell = GetCellIndex(XYZ(Agents[i].Pos), Consts);
+        m_AgentCell[i]    = Cell;
+        ++m_CellCounts[Cell];
+    }
+
+    // 2) Exclusive prefix sum of the cell counts gives the first sorted slot of every cell
+    m_CellStart.resize(NumCells);
+    Uint32 Sum = 0;
+    for (Uint32 c = 0; c < NumCells; ++c)
+    {
+        m_CellStart[c] = Sum;
+        Sum += m_CellCounts[c];
+    }
+
+    // 3) Scatter agents into cell order. Sorted.Home.w keeps the original index.
+    m_Sorted.resize(NumAgents);
+    m_CellFill = m_CellStart;
+    for (Uint32 i = 0; i < NumAgents; ++i)
+    {
+        FlockAgent& Dst = m_Sorted[m_CellFill[m_AgentCell[i]]++];
+        Dst             = Agents[i];
+        Dst.Home.w      = static_cast<float>(i);
+    }
+
+    // 4) Steer and integrate every agent against the 3x3x3 neighbouring cells
+    const float R2 = Consts.NeighborRadius * Consts.NeighborRadius;
+    for (const FlockAgent& Self : m_Sorted)
+    {
+        const float3 P = XYZ(Self.Pos);
+        float3       V = XYZ(Self.Vel);
+
+        const Uint32 Cell = GetCellIndex(P, Consts);
+        const int    cx   = static_cast<int>(Cell % Consts.GridDimX);
+        const int    cy   = static_cast<int>((Cell / Consts.GridDimX) % Consts.GridDimY);
+        const int    cz   = static_cast<int>(Cell / (Consts.GridDimX * Consts.GridDimY));
+
+        float3 Sep, Align, Coh;
+        Uint32 Count = 0;
+        for (int dz = -1; dz <= 1; ++dz)
+        {
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    const int nx = cx + dx, ny = cy + dy, nz = cz + dz;
+                    if (nx < 0 || ny < 0 || nz < 0 ||
+                        nx >= static_cast<int>(Consts.GridDimX) ||
+                        ny >= static_cast<int>(Consts.GridDimY) ||
+                        nz >= static_cast<int>(Consts.GridDimZ))
+                        continue;
+
+                    const Uint32 NCell = nx + Consts.GridDimX * (ny + Consts.GridDimY * nz);
+                    for (Uint32 j = 0; j < m_CellCounts[NCell]; ++j)
+                    {
+                        const FlockAgent& Other = m_Sorted[m_CellStart[NCell] + j];
+
+                        const float3 D  = P - XYZ(Other.Pos);
+                        const float  d2 = dot(D, D);
+                        // d2 > 0 also skips the agent itself
+                        if (d2 < R2 && d2 > 1e-8f)
+                        {
+                            Sep += D / d2;
+                            Align += XYZ(Other.Vel);
+                            Coh += XYZ(Other.Pos);
+                            ++Count;
+                        }
+                    }
+                }
+            }
+        }
+
+        float3 Acc = Sep * Consts.SeparationWeight + (XYZ(Self.Home) - P) * Consts.HomeWeight;
+        if (Count > 0)
+        {
+            const float InvCount = 1.0f / static_cast<float>(Count);
+            Acc += (Align * InvCount - V) * Consts.AlignmentWeight;
+            Acc += (Coh * InvCount - P) * Consts.CohesionWeight;
+        }
+
+        V += Acc * Consts.DeltaTime;
+        const float Speed = length(V);
+        if (Speed > 1e-6f)
+            V *= std::min(std::max(Speed, Consts.MinSpeed), Consts.MaxSpeed) / Speed;
+        else
+            V = float3{Consts.MinSpeed, 0, 0};
+
+        FlockAgent& Dst = Agents[static_cast<Uint32>(Self.Home.w)];
+        Dst.Pos         = float4{P + V * Consts.DeltaTime, 1.0f};
+        Dst.Vel         = float4{V, 0.0f};
+    }
+}
+
+} // namespace Diligent
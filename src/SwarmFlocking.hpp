@@ -0,0 +1,87 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Per-agent state. Must match FlockAgent in Flocking.csh.
+struct FlockAgent
+{
+    float4 Pos;  // xyz - position
+    float4 Vel;  // xyz - velocity
+    float4 Home; // xyz - spawn centre the agent is loosely tethered to
+};
+static_assert(sizeof(FlockAgent) % 16 == 0, "Structured buffer stride must be 16-byte aligned");
+
+// Must match the FlockConstants cbuffer in Flocking.csh.
+struct FlockConstants
+{
+    float3 GridOrigin; // min corner of the binning grid
+    float  CellSize;   // >= NeighborRadius so that 3x3x3 cells cover the neighbourhood
+
+    Uint32 GridDimX;
+    Uint32 GridDimY;
+    Uint32 GridDimZ;
+    Uint32 NumAgents;
+
+    float DeltaTime;
+    float NeighborRadius;
+    float SeparationWeight;
+    float AlignmentWeight;
+
+    float CohesionWeight;
+    float HomeWeight;
+    float MinSpeed;
+    float MaxSpeed;
+};
+static_assert(sizeof(FlockConstants) % 16 == 0, "CB size must be 16-byte aligned");
+
+// Serial reference implementation of the GPU flocking step.
+// Uses the same counting-sort binning and steering rules as Flocking.csh so
+// that a single step from identical state can be compared within float tolerance.
+class FlockingReference
+{
+public:
+    void Step(std::vector<FlockAgent>& Agents, const FlockConstants& Consts);
+
+    static Uint32 GetCellIndex(const float3& Pos, const FlockConstants& Consts);
+
+private:
+    std::vector<Uint32>     m_CellCounts;
+    std::vector<Uint32>     m_CellStart;
+    std::vector<Uint32>     m_CellFill;
+    std::vector<Uint32>     m_AgentCell;
+    std::vector<FlockAgent> m_Sorted;
+};
+
+} // namespace Diligent
@@ -0,0 +1,228 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SwarmSimulation.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Diligent
+{
+
+float ComputeBobOffset(float Time, const OrbitParams& Params)
+{
+    const float BobPhase = Time * Params.BobFreq * 2.0f * PI_F;
+    return Params.BobAmp * (0.6f * std::sin(BobPhase) + 0.4f * std::sin(BobPhase * 2.3f));
+}
+
+float4x4 MakeYawWorld(const float3& Pos, float Yaw)
+{
+    const float s = std::sin(Yaw);
+    const float c = std::cos(Yaw);
+    return float4x4{
+        -c, 0, -s, 0,
+        0, 1, 0, 0,
+        s, 0, -c, 0,
+        Pos.x, Pos.y, Pos.z, 1};
+}
+
+float4x4 EvaluateOrbit(const float3& Center, float Phase, float Time, float BobOffset, const OrbitParams& Params)
+{
+    // 1) Compute orbit angle: startPhase + global speed*time
+    const float Theta = Phase + Time * Params.Speed;
+
+    // 2) Position on horizontal circle + vertical bob
+    const float3 Pos{
+        Center.x + Params.Radius * std::cos(Theta),
+        Center.y + BobOffset,
+        Center.z + Params.Radius * std::sin(Theta),
+    };
+
+    // 3) The butterfly flies along the tangent (-sin(Theta), 0, cos(Theta)), which is yaw -Theta
+    return MakeYawWorld(Pos, -Theta);
+}
+
+SwarmSimThread::~SwarmSimThread()
+{
+    Stop();
+}
+
+void SwarmSimThread::Start(const std::vector<float3>& Centers, const std::vector<float>& Phases, const OrbitParams& Params, float StartTime, float TickRate)
+{
+    Stop();
+
+    m_Centers      = Centers;
+    m_Phases       = Phases;
+    m_StartTime    = StartTime;
+    m_TickRate     = TickRate;
+    m_TickInterval = 1.0f / TickRate;
+    SetParams(Params);
+
+    // The last snapshot of a previous run stays published until this run replaces it
+    if (m_RenderReader == ~0u)
+        m_RenderReader = m_Snapshots.AddReader();
+    m_Snapshots.Release(m_RenderReader);
+    m_FirstEpoch = m_Snapshots.GetEpoch() + 1;
+    m_pPrev      = nullptr;
+    m_pLatest    = nullptr;
+
+    m_TickMs       = 0;
+    m_TicksPerSec  = 0;
+    m_NumTicks     = 0;
+    m_DroppedTicks = 0;
+    m_Stop         = false;
+    m_StartClock   = std::chrono::steady_clock::now();
+    m_Thread       = std::thread{&SwarmSimThread::SimulationThread, this};
+}
+
+void SwarmSimThread::Stop()
+{
+    if (!m_Thread.joinable())
+        return;
+
+    m_Stop = true;
+    m_Thread.join();
+}
+
+void SwarmSimThread::SetParams(const OrbitParams& Params)
+{
+    m_Params.GetWriteBuffer() = Params;
+    m_Params.Publish();
+}
+
+void SwarmSimThread::SimulationThread()
+{
+    using Clock = std::chrono::steady_clock;
+
+    const auto   Interval     = std::chrono::duration<double>{m_TickInterval};
+    const Uint32 NumInstances = static_cast<Uint32>(m_Centers.size());
+
+    Uint64 Tick      = 0;
+    Uint64 RateTicks = 0;
+    auto   RateStart = m_StartClock;
+    while (!m_Stop.load(std::memory_order_relaxed))
+    {
+        // 1) Evaluate all instances at the tick time into the free snapshot
+        const auto TickStart = Clock::now();
+
+        m_Params.Fetch();
+        const OrbitParams& Params = m_Params.GetReadBuffer();
+
+        Snapshot& Snap = m_Snapshots.BeginWrite();
+        Snap.Time      = m_StartTime + static_cast<float>(Tick * m_TickInterval);
+        Snap.Worlds.resize(NumInstances);
+
+        const float BobOffset = ComputeBobOffset(Snap.Time, Params);
+        for (Uint32 i = 0; i < NumInstances; ++i)
+            Snap.Worlds[i] = EvaluateOrbit(m_Centers[i], m_Phases[i], Snap.Time, BobOffset, Params);
+
+        m_Snapshots.Publish();
+
+        // 2) Statistics
+        const auto TickEnd = Clock::now();
+        m_TickMs.store(std::chrono::duration<float, std::milli>{TickEnd - TickStart}.count(), std::memory_order_relaxed);
+        m_NumTicks.fetch_add(1, std::memory_order_relaxed);
+        ++RateTicks;
+        if (TickEnd - RateStart >= std::chrono::seconds{1})
+        {
+            m_TicksPerSec.store(static_cast<float>(RateTicks / std::chrono::duration<double>{TickEnd - RateStart}.count()), std::memory_order_relaxed);
+            RateTicks = 0;
+            RateStart = TickEnd;
+        }
+
+        // 3) Sleep until the next tick is due. A tick that overran its interval skips
+        //    the ticks it missed instead of running them back to back.
+        ++Tick;
+        const Uint64 Due = static_cast<Uint64>((TickEnd - m_StartClock) / Interval);
+        if (Due > Tick)
+        {
+            m_DroppedTicks.fetch_add(Due - Tick, std::memory_order_relaxed);
+            Tick = Due;
+        }
+        std::this_thread::sleep_until(m_StartClock + std::chrono::duration_cast<Clock::duration>(Interval * static_cast<double>(Tick)));
+    }
+}
+
+bool SwarmSimThread::Interpolate(std::vector<float4x4>& Worlds, float& Time)
+{
+    // 1) Keep the two latest snapshots. Pinning the older one's epoch keeps both alive;
+    //    everything older goes back to the simulation for reuse.
+    const SnapshotExchange::Version* pOldest  = m_pPrev != nullptr ? m_pPrev : m_pLatest;
+    const SnapshotExchange::Version* pCurrent = m_Snapshots.Acquire(m_RenderReader, pOldest != nullptr ? pOldest->Epoch : ~Uint64{0});
+    if (pCurrent != nullptr && pCurrent->Epoch >= m_FirstEpoch && pCurrent != m_pLatest)
+    {
+        m_pPrev   = m_pLatest;
+        m_pLatest = pCurrent;
+    }
+    if (m_pLatest == nullptr)
+        return false;
+    const Snapshot& Latest = m_pLatest->Value;
+
+    // 2) Render one tick behind the simulation clock so that, while the simulation
+    //    keeps up, there is a snapshot on either side of the render time
+    const float Elapsed = std::chrono::duration<float>{std::chrono::steady_clock::now() - m_StartClock}.count();
+    Time                = std::max(m_StartTime + Elapsed - m_TickInterval, m_StartTime);
+
+    const Uint32 NumInstances = static_cast<Uint32>(Latest.Worlds.size());
+    Worlds.resize(NumInstances);
+    if (m_pPrev == nullptr || Time >= Latest.Time || Latest.Time <= m_pPrev->Value.Time)
+    {
+        Time = Latest.Time;
+        std::copy(Latest.Worlds.begin(), Latest.Worlds.end(), Worlds.begin());
+        return true;
+    }
+    const Snapshot& Prev = m_pPrev->Value;
+
+    // 3) Blend the matrices. The rotation rows are not renormalized: between two ticks the
+    //    yaw changes by dYaw = Speed / TickRate, which shrinks the basis by at most
+    //    1 - cos(dYaw / 2), well under 0.1% at 60 Hz.
+    const float t = std::max((Time - Prev.Time) / (Latest.Time - Prev.Time), 0.0f);
+    for (Uint32 i = 0; i < NumInstances; ++i)
+    {
+        const float4x4& A = Prev.Worlds[i];
+        const float4x4& B = Latest.Worlds[i];
+        float4x4&       W = Worlds[i];
+        for (int r = 0; r < 4; ++r)
+        {
+            for (int c = 0; c < 4; ++c)
+                W.m[r][c] = A.m[r][c] + (B.m[r][c] - A.m[r][c]) * t;
+        }
+    }
+    return true;
+}
+
+SwarmSimThread::Stats SwarmSimThread::GetStats() const
+{
+    Stats S;
+    S.TickMs       = m_TickMs.load(std::memory_order_relaxed);
+    S.TicksPerSec  = m_TicksPerSec.load(std::memory_order_relaxed);
+    S.NumTicks     = m_NumTicks.load(std::memory_order_relaxed);
+    S.DroppedTicks = m_DroppedTicks.load(std::memory_order_relaxed);
+    return S;
+}
+
+} // namespace Diligent
@@ -0,0 +1,140 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "BasicMath.hpp"
+#include "TripleBuffer.hpp"
+#include "StateExchange.hpp"
+
+namespace Diligent
+{
+
+// Parameters of the closed-form orbit motion, see EvaluateOrbit()
+struct OrbitParams
+{
+    float Radius  = 6.0f;
+    float Speed   = 0.75f;
+    float BobAmp  = 0.25f;
+    float BobFreq = 0.80f;
+};
+
+// Vertical bob shared by all instances at Time
+float ComputeBobOffset(float Time, const OrbitParams& Params);
+
+// World matrix of a butterfly at Pos facing along (sin(Yaw), 0, cos(Yaw)) with Up = (0, 1, 0).
+// The columns of the upper 3x3 are X = cross(Up, Z), Y = cross(Z, X) and Z = -Forward, the last
+// row is the translation. Flocking.csh builds the same basis for an arbitrary forward direction.
+float4x4 MakeYawWorld(const float3& Pos, float Yaw);
+
+// World matrix of a butterfly circling Center, Phase radians along its orbit at Time = 0
+float4x4 EvaluateOrbit(const float3& Center, float Phase, float Time, float BobOffset, const OrbitParams& Params);
+
+// Runs the orbit simulation on its own thread at a fixed tick rate. Every tick
+// evaluates all instances into a snapshot and publishes it through an epoch
+// exchange, so neither the simulation nor its readers ever wait for each other.
+// The render thread interpolates between the two latest snapshots; other threads
+// can read them through AcquireSnapshot().
+class SwarmSimThread
+{
+public:
+    ~SwarmSimThread();
+
+    // Copies the spawn data. Tick 0 is simulated at StartTime.
+    void Start(const std::vector<float3>& Centers, const std::vector<float>& Phases, const OrbitParams& Params, float StartTime, float TickRate);
+    void Stop();
+
+    bool  IsRunning() const { return m_Thread.joinable(); }
+    float GetTickRate() const { return m_TickRate; }
+
+    // Render thread. Parameters take effect from the next tick.
+    void SetParams(const OrbitParams& Params);
+
+    // Render thread. Writes the world matrices one tick interval behind the simulation
+    // clock, interpolated between the two snapshots around that time, and returns that
+    // time in Time. If the simulation has fallen behind, the latest snapshot is used as is.
+    // Returns false until the first snapshot is available.
+    bool Interpolate(std::vector<float4x4>& Worlds, float& Time);
+
+    struct Snapshot
+    {
+        float                 Time = 0;
+        std::vector<float4x4> Worlds;
+    };
+    using SnapshotExchange = EpochExchange<Snapshot>;
+
+    // Any thread other than the render thread. Reader comes from AddSnapshotReader()
+    // and the result stays valid until the reader's next call or ReleaseSnapshot().
+    Uint32                           AddSnapshotReader() { return m_Snapshots.AddReader(); }
+    const SnapshotExchange::Version* AcquireSnapshot(Uint32 Reader) { return m_Snapshots.Acquire(Reader); }
+    void                             ReleaseSnapshot(Uint32 Reader) { m_Snapshots.Release(Reader); }
+
+    struct Stats
+    {
+        float  TickMs       = 0; // CPU time of the last tick
+        float  TicksPerSec  = 0; // measured over the last second
+        Uint64 NumTicks     = 0;
+        Uint64 DroppedTicks = 0; // skipped because a tick overran its interval
+    };
+    Stats GetStats() const;
+
+private:
+    void SimulationThread();
+
+    // Spawn data, immutable while the thread runs
+    std::vector<float3> m_Centers;
+    std::vector<float>  m_Phases;
+    float               m_StartTime    = 0;
+    float               m_TickRate     = 0;
+    float               m_TickInterval = 0;
+
+    SnapshotExchange          m_Snapshots;
+    TripleBuffer<OrbitParams> m_Params;
+
+    // Render-thread state: the two latest snapshots of the current run
+    Uint32                           m_RenderReader = ~0u;
+    Uint64                           m_FirstEpoch   = 0; // snapshots before this are from an earlier run
+    const SnapshotExchange::Version* m_pPrev        = nullptr;
+    const SnapshotExchange::Version* m_pLatest      = nullptr;
+
+    std::chrono::steady_clock::time_point m_StartClock;
+
+    std::thread       m_Thread;
+    std::atomic<bool> m_Stop{false};
+
+    std::atomic<float>  m_TickMs{0};
+    std::atomic<float>  m_TicksPerSec{0};
+    std::atomic<Uint64> m_NumTicks{0};
+    std::atomic<Uint64> m_DroppedTicks{0};
+};
+
+} // namespace Diligent
@@ -0,0 +1,480 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "SwarmTrajectory.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if PLATFORM_WIN32
+#    ifndef NOMINMAX
+#        define NOMINMAX
+#    endif
+#    include <Windows.h>
+#elif PLATFORM_LINUX || PLATFORM_MACOS
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+#include "Errors.hpp"
+#include "SwarmSimulation.hpp"
+
+namespace Diligent
+{
+
+namespace
+{
+
+Uint16 QuantizePos(float p, float Min, float Max)
+{
+    const float t = Max > Min ? std::min(std::max((p - Min) / (Max - Min), 0.0f), 1.0f) : 0.0f;
+    return static_cast<Uint16>(t * 65535.0f + 0.5f);
+}
+
+Uint16 QuantizeYaw(float Yaw)
+{
+    float t = Yaw / (2 * PI_F);
+    t -= std::floor(t);
+    return static_cast<Uint16>(static_cast<Uint32>(t * 65536.0f + 0.5f) & 0xFFFFu);
+}
+
+// Signed 16-bit change as a zigzag varint, 7 bits per byte
+void WriteDelta(std::vector<Uint8>& Chunk, Uint16 Prev, Uint16 Curr)
+{
+    const Int32 d = static_cast<Int16>(static_cast<Uint16>(Curr - Prev));
+    Uint32      z = static_cast<Uint32>((d << 1) ^ (d >> 31));
+    while (z >= 0x80)
+    {
+        Chunk.push_back(static_cast<Uint8>(z | 0x80));
+        z >>= 7;
+    }
+    Chunk.push_back(static_cast<Uint8>(z));
+}
+
+bool ReadDelta(const Uint8*& pSrc, const Uint8* pEnd, Uint16& Value)
+{
+    Uint32 z = 0;
+    for (Uint32 Shift = 0; Shift < 21; Shift += 7)
+    {
+        if (pSrc == pEnd)
+            return false;
+        const Uint8 Byte = *pSrc++;
+        z |= static_cast<Uint32>(Byte & 0x7F) << Shift;
+        if ((Byte & 0x80) == 0)
+        {
+            const Int32 d = static_cast<Int32>(z >> 1) ^ -static_cast<Int32>(z & 1);
+            Value         = static_cast<Uint16>(Value + d);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool SwarmTrajectoryWriter::Begin(const char* Path, Uint32 NumInstances, float FrameRate, const float3& BoundsMin, const float3& BoundsMax, Uint32 KeyframeInterval)
+{
+    m_File.open(Path, std::ios::binary | std::ios::trunc);
+    if (!m_File)
+    {
+        LOG_ERROR_MESSAGE("Failed to create trajectory file '", Path, "'");
+        return false;
+    }
+
+    m_Header                  = {};
+    m_Header.NumInstances     = NumInstances;
+    m_Header.FrameRate        = FrameRate;
+    m_Header.KeyframeInterval = std::max(KeyframeInterval, 1u);
+    for (int c = 0; c < 3; ++c)
+    {
+        m_Header.BoundsMin[c] = BoundsMin[c];
+        m_Header.BoundsMax[c] = BoundsMax[c];
+    }
+    m_FrameTable.clear();
+    m_State.assign(size_t{NumInstances} * 4, 0);
+
+    // Completed by Finish()
+    m_File.write(reinterpret_cast<const char*>(&m_Header), sizeof(m_Header));
+    return m_File.good();
+}
+
+bool SwarmTrajectoryWriter::AddFrame(const float4* pPosYaw)
+{
+    const bool Keyframe = m_FrameTable.size() % m_Header.KeyframeInterval == 0;
+
+    m_Chunk.clear();
+    for (Uint32 i = 0; i < m_Header.NumInstances; ++i)
+    {
+        const float4& Src = pPosYaw[i];
+        const Uint16  Q[] = {
+            QuantizePos(Src.x, m_Header.BoundsMin[0], m_Header.BoundsMax[0]),
+            QuantizePos(Src.y, m_Header.BoundsMin[1], m_Header.BoundsMax[1]),
+            QuantizePos(Src.z, m_Header.BoundsMin[2], m_Header.BoundsMax[2]),
+            QuantizeYaw(Src.w),
+        };
+
+        Uint16* pState = &m_State[size_t{i} * 4];
+        for (int c = 0; c < 4; ++c)
+        {
+            if (Keyframe)
+            {
+                m_Chunk.push_back(static_cast<Uint8>(Q[c]));
+                m_Chunk.push_back(static_cast<Uint8>(Q[c] >> 8));
+            }
+            else
+            {
+                WriteDelta(m_Chunk, pState[c], Q[c]);
+            }
+            pState[c] = Q[c];
+        }
+    }
+
+    m_FrameTable.push_back(static_cast<Uint64>(m_File.tellp()) | (Keyframe ? SwarmTrajectoryHeader::kKeyframeBit : 0));
+    m_File.write(reinterpret_cast<const char*>(m_Chunk.data()), static_cast<std::streamsize>(m_Chunk.size()));
+    return m_File.good();
+}
+
+bool SwarmTrajectoryWriter::Finish()
+{
+    m_Header.NumFrames        = static_cast<Uint32>(m_FrameTable.size());
+    m_Header.FrameTableOffset = static_cast<Uint64>(m_File.tellp());
+    m_File.write(reinterpret_cast<const char*>(m_FrameTable.data()), static_cast<std::streamsize>(m_FrameTable.size() * sizeof(Uint64)));
+
+    m_File.seekp(0);
+    m_File.write(reinterpret_cast<const char*>(&m_Header), sizeof(m_Header));
+    const bool Succeeded = m_File.good();
+    m_File.close();
+    if (!Succeeded)
+        LOG_ERROR_MESSAGE("Failed to write the trajectory file");
+    return Succeeded;
+}
+
+SwarmTrajectoryReader::~SwarmTrajectoryReader()
+{
+    Close();
+}
+
+bool SwarmTrajectoryReader::Open(const char* Path)
+{
+    Close();
+
+    // 1) Map the file. Playback touches it frame by frame on the worker thread,
+    //    so the OS only pages in what is about to be decoded.
+#if PLATFORM_WIN32
+    m_hFile = CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+        m_hFile = nullptr;
+    LARGE_INTEGER Size = {};
+    if (m_hFile != nullptr && GetFileSizeEx(m_hFile, &Size) && Size.QuadPart > 0)
+    {
+        m_hMapping = CreateFileMappingA(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (m_hMapping != nullptr)
+        {
+            m_pData    = static_cast<const Uint8*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+            m_DataSize = static_cast<size_t>(Size.QuadPart);
+        }
+    }
+#elif PLATFORM_LINUX || PLATFORM_MACOS
+    const int Fd = open(Path, O_RDONLY);
+    struct stat Info;
+    if (Fd >= 0 && fstat(Fd, &Info) == 0 && Info.st_size > 0)
+    {
+        void* pMapped = mmap(nullptr, static_cast<size_t>(Info.st_size), PROT_READ, MAP_PRIVATE, Fd, 0);
+        if (pMapped != MAP_FAILED)
+        {
+            madvise(pMapped, static_cast<size_t>(Info.st_size), MADV_SEQUENTIAL);
+            m_pData    = static_cast<const Uint8*>(pMapped);
+            m_DataSize = static_cast<size_t>(Info.st_size);
+        }
+    }
+    if (Fd >= 0)
+        close(Fd); // the mapping stays valid
+#else
+    std::ifstream File{Path, std::ios::binary};
+    m_FileData.assign(std::istreambuf_iterator<char>{File}, std::istreambuf_iterator<char>{});
+    if (!m_FileData.empty())
+    {
+        m_pData    = m_FileData.data();
+        m_DataSize = m_FileData.size();
+    }
+#endif
+    if (m_pData == nullptr)
+    {
+        LOG_ERROR_MESSAGE("Failed to open trajectory file '", Path, "'");
+        Close();
+        return false;
+    }
+
+    // 2) Validate the header and the frame table, so that decoding only has to check chunk contents
+    bool Valid = m_DataSize >= sizeof(m_Header);
+    if (Valid)
+    {
+        std::memcpy(&m_Header, m_pData, sizeof(m_Header));
+        Valid = std::memcmp(m_Header.Magic, "SWTR", 4) == 0 && m_Header.Version == 1 &&
+            m_Header.NumInstances > 0 && m_Header.NumFrames > 0 && m_Header.FrameRate > 0 &&
+            m_Header.FrameTableOffset <= m_DataSize &&
+            (m_DataSize - m_Header.FrameTableOffset) / sizeof(Uint64) >= m_Header.NumFrames;
+    }
+    for (Uint32 f = 0; Valid && f < m_Header.NumFrames; ++f)
+    {
+        const Uint64 Begin = GetFrameOffset(f);
+        const Uint64 End   = f + 1 < m_Header.NumFrames ? GetFrameOffset(f + 1) : m_Header.FrameTableOffset;
+        Valid              = Begin >= sizeof(m_Header) && Begin <= End && End <= m_Header.FrameTableOffset &&
+            (!IsKeyframe(f) || End - Begin == Uint64{m_Header.NumInstances} * 8);
+    }
+    if (!Valid || !IsKeyframe(0))
+    {
+        LOG_ERROR_MESSAGE("'", Path, "' is not a valid swarm trajectory file");
+        Close();
+        return false;
+    }
+
+    // 3) Start decoding from the first frame
+    m_StateFrame     = ~0u;
+    m_RequestedFrame = 0;
+    m_DeliveredFrame = ~0u;
+    m_StopWorker     = false;
+    m_Failed         = false;
+    m_Worker         = std::thread{&SwarmTrajectoryReader::WorkerThread, this};
+    return true;
+}
+
+void SwarmTrajectoryReader::Close()
+{
+    if (m_Worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> Lock{m_Mtx};
+            m_StopWorker = true;
+        }
+        m_WorkerCV.notify_one();
+        m_Worker.join();
+    }
+    for (DecodedFrame& Slot : m_Slots)
+        Slot = {};
+
+#if PLATFORM_WIN32
+    if (m_pData != nullptr)
+        UnmapViewOfFile(m_pData);
+    if (m_hMapping != nullptr)
+        CloseHandle(m_hMapping);
+    if (m_hFile != nullptr)
+        CloseHandle(m_hFile);
+    m_hMapping = nullptr;
+    m_hFile    = nullptr;
+#elif PLATFORM_LINUX || PLATFORM_MACOS
+    if (m_pData != nullptr)
+        munmap(const_cast<Uint8*>(m_pData), m_DataSize);
+#endif
+    m_FileData.clear();
+    m_pData    = nullptr;
+    m_DataSize = 0;
+    m_Header   = {};
+}
+
+Uint64 SwarmTrajectoryReader::GetFrameOffset(Uint32 Frame) const
+{
+    Uint64 Entry;
+    std::memcpy(&Entry, m_pData + m_Header.FrameTableOffset + size_t{Frame} * sizeof(Uint64), sizeof(Entry));
+    return Entry & ~SwarmTrajectoryHeader::kKeyframeBit;
+}
+
+bool SwarmTrajectoryReader::IsKeyframe(Uint32 Frame) const
+{
+    Uint64 Entry;
+    std::memcpy(&Entry, m_pData + m_Header.FrameTableOffset + size_t{Frame} * sizeof(Uint64), sizeof(Entry));
+    return (Entry & SwarmTrajectoryHeader::kKeyframeBit) != 0;
+}
+
+Uint32 SwarmTrajectoryReader::GetFrameAt(double Time) const
+{
+    const double Frame = std::floor(std::max(Time, 0.0) * m_Header.FrameRate);
+    return static_cast<Uint32>(std::fmod(Frame, static_cast<double>(m_Header.NumFrames)));
+}
+
+bool SwarmTrajectoryReader::FetchFrame(Uint32 Frame, std::vector<float4x4>& Worlds)
+{
+    bool Fetched = false;
+    {
+        std::lock_guard<std::mutex> Lock{m_Mtx};
+        m_RequestedFrame = Frame;
+        for (DecodedFrame& Slot : m_Slots)
+        {
+            if (Slot.Ready && Slot.Frame == Frame)
+            {
+                std::swap(Slot.Worlds, Worlds);
+                Slot.Ready       = false;
+                m_DeliveredFrame = Frame;
+                Fetched          = true;
+                break;
+            }
+        }
+    }
+    // The request may have moved on, or a slot has been freed
+    m_WorkerCV.notify_one();
+    return Fetched;
+}
+
+bool SwarmTrajectoryReader::FindWork(DecodedFrame*& pSlot, Uint32& Frame)
+{
+    const Uint32 NumFrames = m_Header.NumFrames;
+    for (Uint32 k = 0; k < std::min(kNumSlots, NumFrames); ++k)
+    {
+        const Uint32 Candidate = (m_RequestedFrame + k) % NumFrames;
+
+        bool Present = Candidate == m_DeliveredFrame;
+        for (const DecodedFrame& Slot : m_Slots)
+            Present |= (Slot.Ready || Slot.Busy) && Slot.Frame == Candidate;
+        if (Present)
+            continue;
+
+        // Reuse an empty slot or one that holds a frame playback has already passed
+        for (DecodedFrame& Slot : m_Slots)
+        {
+            const bool Stale = Slot.Ready && (Slot.Frame + NumFrames - m_RequestedFrame) % NumFrames >= kNumSlots;
+            if (!Slot.Busy && (!Slot.Ready || Stale))
+            {
+                pSlot = &Slot;
+                Frame = Candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+    return false;
+}
+
+void SwarmTrajectoryReader::WorkerThread()
+{
+    std::unique_lock<std::mutex> Lock{m_Mtx};
+    while (true)
+    {
+        DecodedFrame* pSlot = nullptr;
+        Uint32        Frame = 0;
+        m_WorkerCV.wait(Lock, [&]() { return m_StopWorker || (!m_Failed && FindWork(pSlot, Frame)); });
+        if (m_StopWorker)
+            return;
+
+        pSlot->Busy  = true;
+        pSlot->Ready = false;
+        pSlot->Frame = Frame;
+        Lock.unlock();
+
+        // Decoding touches the mapped pages, so any I/O happens here
+        ReadAhead(Frame);
+        const bool Decoded = DecodeTo(Frame);
+        if (Decoded)
+            BuildWorlds(pSlot->Worlds);
+
+        Lock.lock();
+        pSlot->Busy  = false;
+        pSlot->Ready = Decoded;
+        if (!Decoded)
+        {
+            LOG_ERROR_MESSAGE("Trajectory frame ", Frame, " is corrupt; playback stopped");
+            m_Failed = true;
+        }
+    }
+}
+
+void SwarmTrajectoryReader::ReadAhead(Uint32 Frame) const
+{
+#if PLATFORM_LINUX || PLATFORM_MACOS
+    // Ask the kernel to start reading the frames after this one
+    const Uint32 Last  = std::min(Frame + kNumSlots + 1, m_Header.NumFrames);
+    const Uint64 Begin = Frame + 1 < m_Header.NumFrames ? GetFrameOffset(Frame + 1) : m_Header.FrameTableOffset;
+    const Uint64 End   = Last < m_Header.NumFrames ? GetFrameOffset(Last) : m_Header.FrameTableOffset;
+    if (End > Begin)
+    {
+        const size_t PageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t Aligned  = static_cast<size_t>(Begin) / PageSize * PageSize;
+        madvise(const_cast<Uint8*>(m_pData) + Aligned, static_cast<size_t>(End) - Aligned, MADV_WILLNEED);
+    }
+#else
+    (void)Frame;
+#endif
+}
+
+bool SwarmTrajectoryReader::DecodeTo(Uint32 Frame)
+{
+    if (m_StateFrame == Frame)
+        return true;
+
+    // Continue from the current state unless a keyframe lies in between or the target is behind it
+    Uint32 Keyframe = Frame;
+    while (!IsKeyframe(Keyframe))
+        --Keyframe;
+
+    Uint32 Next = m_StateFrame + 1;
+    if (m_StateFrame == ~0u || m_StateFrame > Frame || m_StateFrame < Keyframe)
+    {
+        const Uint8* pSrc = m_pData + GetFrameOffset(Keyframe);
+        m_State.resize(size_t{m_Header.NumInstances} * 4);
+        for (size_t i = 0; i < m_State.size(); ++i, pSrc += 2)
+            m_State[i] = static_cast<Uint16>(pSrc[0] | (pSrc[1] << 8));
+        m_StateFrame = Keyframe;
+        Next         = Keyframe + 1;
+    }
+
+    for (Uint32 f = Next; f <= Frame; ++f)
+    {
+        const Uint8* pSrc = m_pData + GetFrameOffset(f);
+        const Uint8* pEnd = m_pData + (f + 1 < m_Header.NumFrames ? GetFrameOffset(f + 1) : m_Header.FrameTableOffset);
+        for (Uint16& Value : m_State)
+        {
+            if (!ReadDelta(pSrc, pEnd, Value))
+            {
+                m_StateFrame = ~0u;
+                return false;
+            }
+        }
+        m_StateFrame = f;
+    }
+    return true;
+}
+
+void SwarmTrajectoryReader::BuildWorlds(std::vector<float4x4>& Worlds) const
+{
+    float3 Min, Scale;
+    for (int c = 0; c < 3; ++c)
+    {
+        Min[c]   = m_Header.BoundsMin[c];
+        Scale[c] = (m_Header.BoundsMax[c] - m_Header.BoundsMin[c]) / 65535.0f;
+    }
+
+    Worlds.resize(m_Header.NumInstances);
+    for (Uint32 i = 0; i < m_Header.NumInstances; ++i)
+    {
+        const Uint16* q = &m_State[size_t{i} * 4];
+        Worlds[i]       = MakeYawWorld(Min + float3{q[0] * Scale.x, q[1] * Scale.y, q[2] * Scale.z}, q[3] * (2 * PI_F / 65536.0f));
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,164 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Recorded swarm trajectories (.swtr).
+//
+// File layout:
+//   SwarmTrajectoryHeader
+//   NumFrames frame chunks
+//   frame table: NumFrames Uint64 chunk offsets, kKeyframeBit marks keyframes
+//
+// Every instance has a position quantized to 16 bits per axis within the header
+// bounds and a 16-bit yaw (2*pi / 65536 steps). Keyframes store these as four
+// Uint16 per instance. Other frames store the per-component change from the
+// previous frame as four zigzag varints, one byte for changes below 64 steps.
+// Keyframes are written every KeyframeInterval frames so that playback can seek
+// and loop.
+struct SwarmTrajectoryHeader
+{
+    char   Magic[4] = {'S', 'W', 'T', 'R'};
+    Uint32 Version  = 1;
+
+    Uint32 NumInstances     = 0;
+    Uint32 NumFrames        = 0;
+    float  FrameRate        = 30;
+    Uint32 KeyframeInterval = 30;
+
+    float BoundsMin[3] = {};
+    float BoundsMax[3] = {};
+
+    Uint64 FrameTableOffset = 0;
+
+    static constexpr Uint64 kKeyframeBit = Uint64{1} << 63; // in frame table entries
+};
+static_assert(sizeof(SwarmTrajectoryHeader) == 56, "The header is written as is");
+
+// Records a trajectory one frame at a time
+class SwarmTrajectoryWriter
+{
+public:
+    bool Begin(const char* Path, Uint32 NumInstances, float FrameRate, const float3& BoundsMin, const float3& BoundsMax, Uint32 KeyframeInterval = 30);
+
+    // xyz - position, w - yaw in radians; the forward direction is (sin(yaw), 0, cos(yaw))
+    bool AddFrame(const float4* pPosYaw);
+
+    // Writes the frame table and completes the header
+    bool Finish();
+
+private:
+    std::ofstream         m_File;
+    SwarmTrajectoryHeader m_Header;
+    std::vector<Uint64>   m_FrameTable;
+    std::vector<Uint16>   m_State; // quantized x, y, z, yaw of the previous frame
+    std::vector<Uint8>    m_Chunk;
+};
+
+// Plays a trajectory back. The file is memory-mapped, and a worker thread
+// decodes the frames around the requested one into world matrices while the
+// render thread keeps drawing. Page faults and decoding never happen on the
+// calling thread.
+class SwarmTrajectoryReader
+{
+public:
+    ~SwarmTrajectoryReader();
+
+    bool Open(const char* Path);
+    void Close();
+
+    bool                         IsOpen() const { return m_pData != nullptr; }
+    const SwarmTrajectoryHeader& GetHeader() const { return m_Header; }
+
+    // Frame to show at playback time Time, looping
+    Uint32 GetFrameAt(double Time) const;
+
+    // Requests Frame and, if it has been decoded, swaps its world matrices into
+    // Worlds and returns true. Worlds' previous storage is reused for decoding.
+    // Otherwise, or if Frame was the last one returned, returns false without waiting.
+    bool FetchFrame(Uint32 Frame, std::vector<float4x4>& Worlds);
+
+private:
+    void WorkerThread();
+    bool DecodeTo(Uint32 Frame);
+    void ReadAhead(Uint32 Frame) const;
+    void BuildWorlds(std::vector<float4x4>& Worlds) const;
+
+    Uint64 GetFrameOffset(Uint32 Frame) const;
+    bool   IsKeyframe(Uint32 Frame) const;
+
+    static constexpr Uint32 kNumSlots = 2; // the requested frame and the one after it
+
+    // Mapping
+    const Uint8*          m_pData    = nullptr;
+    size_t                m_DataSize = 0;
+    std::vector<Uint8>    m_FileData; // used where memory mapping is unavailable
+    SwarmTrajectoryHeader m_Header;
+#if PLATFORM_WIN32
+    void* m_hFile    = nullptr;
+    void* m_hMapping = nullptr;
+#endif
+
+    // Decoder state, owned by the worker
+    std::vector<Uint16> m_State;            // quantized x, y, z, yaw of m_StateFrame
+    Uint32              m_StateFrame = ~0u; // ~0u - nothing decoded yet
+
+    // Decoded frames; together with the caller's array this makes three buffers
+    struct DecodedFrame
+    {
+        std::vector<float4x4> Worlds;
+        Uint32                Frame = 0;
+        bool                  Ready = false;
+        bool                  Busy  = false; // being decoded
+    };
+    std::array<DecodedFrame, kNumSlots> m_Slots;
+
+    // Called with m_Mtx locked
+    bool FindWork(DecodedFrame*& pSlot, Uint32& Frame);
+
+    std::thread             m_Worker;
+    std::mutex              m_Mtx;
+    std::condition_variable m_WorkerCV;
+    Uint32                  m_RequestedFrame = 0;
+    Uint32                  m_DeliveredFrame = ~0u; // already in the caller's array, not decoded again
+    bool                    m_StopWorker     = false;
+    bool                    m_Failed         = false; // a corrupt frame stopped decoding
+};
+
+} // namespace Diligent
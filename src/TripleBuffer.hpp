@@ -0,0 +1,80 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "BasicTypes.h"
+
+namespace Diligent
+{
+
+// Single-producer, single-consumer triple buffer. The producer fills the write
+// buffer and publishes it; the consumer fetches the most recently published one.
+// Neither side ever waits: the third buffer is always free for the producer, and
+// buffers published but never fetched are simply overwritten.
+//
+// Buffers are recycled, not cleared, so containers inside T keep their storage.
+template <typename T>
+class TripleBuffer
+{
+public:
+    // Producer side
+    T& GetWriteBuffer() { return m_Buffers[m_WriteIdx]; }
+
+    void Publish()
+    {
+        const Uint32 Prev = m_Middle.exchange(m_WriteIdx | kFreshBit, std::memory_order_acq_rel);
+        m_WriteIdx        = Prev & kIndexMask;
+    }
+
+    // Consumer side. Returns true if a buffer newer than the current read buffer was published.
+    bool Fetch()
+    {
+        if ((m_Middle.load(std::memory_order_relaxed) & kFreshBit) == 0)
+            return false;
+        const Uint32 Prev = m_Middle.exchange(m_ReadIdx, std::memory_order_acq_rel);
+        m_ReadIdx         = Prev & kIndexMask;
+        return true;
+    }
+
+    T& GetReadBuffer() { return m_Buffers[m_ReadIdx]; }
+
+private:
+    static constexpr Uint32 kIndexMask = 0x3u;
+    static constexpr Uint32 kFreshBit  = 0x4u; // the middle buffer has not been fetched yet
+
+    std::array<T, 3> m_Buffers;
+
+    Uint32              m_WriteIdx = 0; // owned by the producer
+    Uint32              m_ReadIdx  = 1; // owned by the consumer
+    std::atomic<Uint32> m_Middle{2};    // last published or returned buffer, plus kFreshBit
+};
+
+} // namespace Diligent
@@ -31,10 +31,27 @@
 #include "FirstPersonCamera.hpp"
 #include "StringTools.hpp"
 #include "GraphicsUtilities.h"
+#include "GraphicsAccessories.hpp"
 #include "TextureUtilities.h"
+#include "Image.h"
+#include "ScopedQueryHelper.hpp"
+#include "ImageDiff.hpp"
+#include "SkyHDRBaker.hpp"
 #include "ColorConversion.h"
 #include "BasicMath.hpp"
+#include "AdvancedMath.hpp"
+#include "Errors.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cctype>
+#include <cfloat>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
 #include <random> 
+#include <thread>
 
 namespace Diligent
 {
@@ -46,87 +63,170 @@ SampleBase* CreateSample()
 
 void Tutorial03_Texturing::CreatePipelineState()
 {
-    // 1) Prepare PSO descriptor
-    GraphicsPipelineStateCreateInfo PSOCreateInfo;
-    PSOCreateInfo.PSODesc.Name         = "Butterfly PSO";
-    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
-
-    // 2) Configure render target and depth formats
-    const auto& SCDesc                              = m_pSwapChain->GetDesc();
-    PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
-    PSOCreateInfo.GraphicsPipeline.RTVFormats[0]    = SCDesc.ColorBufferFormat;
-    PSOCreateInfo.GraphicsPipeline.DSVFormat        = SCDesc.DepthBufferFormat;
-
-    // 3) Rasterizer & Depth‐Stencil settings
-    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE; // no back‐face culling
-    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = True;           // enable depth test
+    // 1) Create dynamic uniform buffer for VSConstants (shared by all VS permutations)
+    {
+        BufferDesc CBDesc;
+        CBDesc.Name           = "VS constants";
+        CBDesc.Size           = sizeof(VSConstants);
+        CBDesc.Usage          = USAGE_DYNAMIC;
+        CBDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+        CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+        m_pDevice->CreateBuffer(CBDesc, nullptr, &m_VSConstants);
+    }
 
-    // 4) Common shader compile settings
+    // 2) Common shader compile settings
     ShaderCreateInfo ShaderCI;
     ShaderCI.SourceLanguage                  = SHADER_SOURCE_LANGUAGE_HLSL;
     ShaderCI.Desc.UseCombinedTextureSamplers = true;
     ShaderCI.CompileFlags                    = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR;
 
-    // Macro to optionally convert PS output to gamma
-    ShaderMacro Macros[] = {{"CONVERT_PS_OUTPUT_TO_GAMMA", m_ConvertPSOutputToGamma ? "1" : "0"}};
-    ShaderCI.Macros      = {Macros, _countof(Macros)};
-
     // Shader source loader
     RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
-    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &pShaderSourceFactory);
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(m_ShaderSearchPath.c_str(), &pShaderSourceFactory);
     ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
 
-    // 5) Create vertex shader + its constant buffer
-    RefCntAutoPtr<IShader> pVS;
+    ShaderCreateInfo VSSource;
+    VSSource.Desc.Name  = "Butterfly VS";
+    VSSource.FilePath   = "cube.vsh";
+    VSSource.EntryPoint = "main";
+
+    ShaderCreateInfo PSSource;
+    PSSource.Desc.Name  = "Butterfly PS";
+    PSSource.FilePath   = "cube.psh";
+    PSSource.EntryPoint = "main";
+
+    // 3) Butterfly features and their place in the key, see BUTTERFLY_PERM_*.
+    //    Shaders and PSOs are only created when Render() first asks for a key.
+    std::vector<ShaderPermutationCache::Feature> Features =
+        {
+            {nullptr, BUTTERFLY_PERM_TARGET, 2, SHADER_TYPE_UNKNOWN},
+            {"ANALYTIC_MOTION", BUTTERFLY_PERM_ANALYTIC, 1, SHADER_TYPE_VERTEX},
+            {"SORTED_INSTANCES", BUTTERFLY_PERM_SORTED, 1, SHADER_TYPE_VERTEX},
+            {"WING_VAT", BUTTERFLY_PERM_WING_VAT, 1, SHADER_TYPE_VERTEX},
+            {"BRANCHLESS_WING", BUTTERFLY_PERM_BRANCHLESS_WING, 1, SHADER_TYPE_VERTEX},
+            {"WING_ALPHA_MODE", BUTTERFLY_PERM_WING_ALPHA_MODE, 2, SHADER_TYPE_PIXEL},
+            {"CONVERT_PS_OUTPUT_TO_GAMMA", BUTTERFLY_PERM_GAMMA, 1, SHADER_TYPE_PIXEL},
+            {"MULTI_VIEW", BUTTERFLY_PERM_MULTI_VIEW, 1, SHADER_TYPE_VERTEX},
+        };
+    m_ButterflyPermutations.reset(new ShaderPermutationCache{
+        m_pDevice, ShaderCI, VSSource, PSSource, std::move(Features),
+        [this](PermutationKey Key, IShader* pVS, IShader* pPS, IPipelineState** ppPSO) {
+            // Cache misses happen on the main thread, where the live state can be read
+            CreateButterflyPSO(CapturePipelineTargets(), Key, pVS, pPS, ppPSO);
+        }});
+
+    // 4) SRBs are shared by every permutation with the same motion source, so each is
+    //    created from the back-buffer permutation, which every session renders with.
+    //    The sorted variant needs compute shaders to build the order.
+    const int NumVariants = m_pDevice->GetDeviceInfo().Features.ComputeShaders ? 3 : 2;
+    for (int Variant = 0; Variant < NumVariants; ++Variant)
     {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_VERTEX;
-        ShaderCI.EntryPoint      = "main";
-        ShaderCI.Desc.Name       = "Butterfly VS";
-        ShaderCI.FilePath        = "cube.vsh";
-        m_pDevice->CreateShader(ShaderCI, &pVS);
+        const bool Analytic = Variant == 1;
+        const bool Sorted   = Variant == 2;
+        auto&      pSRB     = Analytic ? m_AnalyticSRB : (Sorted ? m_SortedSRB : m_SRB);
+        if (IPipelineState* pPSO = m_ButterflyPermutations->Get(GetButterflyKey(RENDER_TARGET_BACK_BUFFER, Analytic, Sorted, false, false)))
+            pPSO->CreateShaderResourceBinding(&pSRB, true);
+    }
 
-        // Create dynamic uniform buffer for VSConstants
+    // 5) Single-pass multi-view: MultiView.gsh replicates every triangle into each
+    //    view's viewport. It is not a permutation, every MULTI_VIEW PSO shares it.
+    const DeviceFeatures& DevFeatures = m_pDevice->GetDeviceInfo().Features;
+    if (DevFeatures.GeometryShaders && DevFeatures.MultiViewport)
+    {
         BufferDesc CBDesc;
-        CBDesc.Name           = "VS constants";
-        CBDesc.Size           = sizeof(VSConstants);
+        CBDesc.Name           = "Multi-view constants";
+        CBDesc.Size           = sizeof(MultiViewConstants);
         CBDesc.Usage          = USAGE_DYNAMIC;
         CBDesc.BindFlags      = BIND_UNIFORM_BUFFER;
         CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
-        m_pDevice->CreateBuffer(CBDesc, nullptr, &m_VSConstants);
+        m_pDevice->CreateBuffer(CBDesc, nullptr, &m_MultiViewCB);
+
+        ShaderCreateInfo GSCI = ShaderCI;
+        GSCI.Desc.ShaderType  = SHADER_TYPE_GEOMETRY;
+        GSCI.Desc.Name        = "Multi-view GS";
+        GSCI.FilePath         = "MultiView.gsh";
+        GSCI.EntryPoint       = "main";
+        m_pDevice->CreateShader(GSCI, &m_MultiViewGS);
     }
+    m_MultiViewSupported = m_MultiViewCB && m_MultiViewGS;
+}
+
+PermutationKey Tutorial03_Texturing::GetButterflyKey(Uint32 Target, bool Analytic, bool Sorted, bool OIT, bool MultiView) const
+{
+    using Cache = ShaderPermutationCache;
 
-    // 6) Create pixel shader
-    RefCntAutoPtr<IShader> pPS;
+    PermutationKey Key = Cache::Encode(BUTTERFLY_PERM_ANALYTIC, Analytic ? 1 : 0) |
+        Cache::Encode(BUTTERFLY_PERM_SORTED, Sorted && !Analytic ? 1 : 0) |
+        Cache::Encode(BUTTERFLY_PERM_WING_VAT, m_WingVAT ? 1 : 0) |
+        Cache::Encode(BUTTERFLY_PERM_BRANCHLESS_WING, 1) |
+        Cache::Encode(BUTTERFLY_PERM_MULTI_VIEW, MultiView && m_MultiViewSupported ? 1 : 0);
+    if (OIT)
+    {
+        // The accumulation targets replace the scene target, so the target bits stay zero
+        Key |= Cache::Encode(BUTTERFLY_PERM_WING_ALPHA_MODE, 2);
+    }
+    else
     {
-        ShaderCI.Desc.ShaderType = SHADER_TYPE_PIXEL;
-        ShaderCI.EntryPoint      = "main";
-        ShaderCI.Desc.Name       = "Butterfly PS";
-        ShaderCI.FilePath        = "cube.psh";
-        m_pDevice->CreateShader(ShaderCI, &pPS);
+        // The HDR target stores linear colour and is encoded by the tone mapper.
+        // MSAA targets sharpen alpha for alpha to coverage (WING_ALPHA_MODE 1).
+        Key |= Cache::Encode(BUTTERFLY_PERM_TARGET, Target) |
+            Cache::Encode(BUTTERFLY_PERM_WING_ALPHA_MODE, IsMSAATarget(Target) ? 1 : 0) |
+            Cache::Encode(BUTTERFLY_PERM_GAMMA, !IsHDRTarget(Target) && m_ConvertPSOutputToGamma ? 1 : 0);
     }
+    return Key;
+}
+
+Tutorial03_Texturing::PipelineTargets Tutorial03_Texturing::CapturePipelineTargets() const
+{
+    PipelineTargets Targets;
+    for (Uint32 Target = 0; Target < RENDER_TARGET_COUNT; ++Target)
+        Targets.Formats[Target] = IsTargetSupported(Target) ? GetTargetFormat(Target) : TEX_FORMAT_UNKNOWN;
+    Targets.DepthFormat = m_pSwapChain->GetDesc().DepthBufferFormat;
+    if (m_WingVATTex)
+        Targets.pWingVATSRV = m_WingVATTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    return Targets;
+}
+
+void Tutorial03_Texturing::CreateButterflyPSO(const PipelineTargets& Targets, PermutationKey Key, IShader* pVS, IShader* pPS, IPipelineState** ppPSO)
+{
+    using Cache = ShaderPermutationCache;
+
+    const Uint32 Target    = Cache::Decode(Key, BUTTERFLY_PERM_TARGET, 2);
+    const bool   Analytic  = Cache::Decode(Key, BUTTERFLY_PERM_ANALYTIC, 1) != 0;
+    const bool   Sorted    = Cache::Decode(Key, BUTTERFLY_PERM_SORTED, 1) != 0;
+    const bool   WingVAT   = Cache::Decode(Key, BUTTERFLY_PERM_WING_VAT, 1) != 0;
+    const Uint32 AlphaMode = Cache::Decode(Key, BUTTERFLY_PERM_WING_ALPHA_MODE, 2);
+    const bool   MultiView = Cache::Decode(Key, BUTTERFLY_PERM_MULTI_VIEW, 1) != 0;
+    if (MultiView && !m_MultiViewSupported)
+        return;
+
+    // 1) Prepare PSO descriptor
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name         = AlphaMode == 2 ? "Butterfly OIT PSO" : "Butterfly PSO";
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+    PSOCreateInfo.pVS                  = pVS;
+    PSOCreateInfo.pGS                  = MultiView ? m_MultiViewGS.RawPtr() : nullptr;
+    PSOCreateInfo.pPS                  = pPS;
+
+    // 2) Rasterizer & Depth‐Stencil settings
+    PSOCreateInfo.GraphicsPipeline.DSVFormat                    = Targets.DepthFormat;
+    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE; // no back‐face culling
+    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = True;           // enable depth test
 
-    // 7) Define vertex input layout: Position, UV, WingFlag
+    // 3) Define vertex input layout: Position, UV, WingFlag from the mesh, instance index from slot 1
     LayoutElement LayoutElems[] =
         {
-            {0, 0, 3, VT_FLOAT32, False}, // ATTRIB0: float3 Pos
-            {1, 0, 2, VT_FLOAT32, False}, // ATTRIB1: float2 UV
-            {2, 0, 1, VT_FLOAT32, False}  // ATTRIB2: float  WingFlag
+            {0, 0, 3, VT_FLOAT32, False},                                     // ATTRIB0: float3 Pos
+            {1, 0, 2, VT_FLOAT32, False},                                     // ATTRIB1: float2 UV
+            {2, 0, 1, VT_FLOAT32, False},                                     // ATTRIB2: float  WingFlag
+            {3, 1, 1, VT_UINT32, False, INPUT_ELEMENT_FREQUENCY_PER_INSTANCE} // ATTRIB3: uint   instance index
         };
-    PSOCreateInfo.pVS                                         = pVS;
-    PSOCreateInfo.pPS                                         = pPS;
     PSOCreateInfo.GraphicsPipeline.InputLayout.LayoutElements = LayoutElems;
     PSOCreateInfo.GraphicsPipeline.InputLayout.NumElements    = _countof(LayoutElems);
 
-    // 8) Resource layout: one mutable texture SRV, one immutable sampler
-    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
-
-    ShaderResourceVariableDesc Vars[] =
-        {
-            {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
-    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
-    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
-
+    // 4) Resource layout: mutable texture SRV and per-instance buffer SRVs, one immutable sampler.
+    //    It depends on the motion bits only, which keeps SRBs compatible across targets.
     SamplerDesc SamLinearClampDesc{
         FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
         TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP};
@@ -135,13 +235,63 @@ void Tutorial03_Texturing::CreatePipelineState()
             {SHADER_TYPE_PIXEL, "g_Texture", SamLinearClampDesc}};
     PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = ImtblSamplers;
     PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(ImtblSamplers);
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType  = SHADER_RESOURCE_VARIABLE_TYPE_STATIC;
+
+    ShaderResourceVariableDesc Vars[] =
+        {
+            {SHADER_TYPE_PIXEL, "g_Texture", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+            {SHADER_TYPE_VERTEX, Analytic ? "g_InstanceParams" : "g_Instances", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+            {SHADER_TYPE_VERTEX, "g_InstanceOrder", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = Sorted ? 3 : 2;
+
+    auto& Pipeline = PSOCreateInfo.GraphicsPipeline;
+    if (AlphaMode == 2)
+    {
+        // 5a) Weighted blended OIT accumulation: RT0 sums weighted premultiplied colour,
+        //     RT1 multiplies the revealage by (1 - alpha). Depth is tested against the
+        //     opaque scene but not written, so the draw order does not matter.
+        Pipeline.NumRenderTargets                  = 2;
+        Pipeline.RTVFormats[0]                     = kOITAccumFormat;
+        Pipeline.RTVFormats[1]                     = kOITRevealFormat;
+        Pipeline.DepthStencilDesc.DepthWriteEnable = False;
+        Pipeline.BlendDesc.IndependentBlendEnable  = True;
+
+        auto& Accum          = Pipeline.BlendDesc.RenderTargets[0];
+        Accum.BlendEnable    = True;
+        Accum.SrcBlend       = BLEND_FACTOR_ONE;
+        Accum.DestBlend      = BLEND_FACTOR_ONE;
+        Accum.SrcBlendAlpha  = BLEND_FACTOR_ONE;
+        Accum.DestBlendAlpha = BLEND_FACTOR_ONE;
+
+        auto& Reveal          = Pipeline.BlendDesc.RenderTargets[1];
+        Reveal.BlendEnable    = True;
+        Reveal.SrcBlend       = BLEND_FACTOR_ZERO;
+        Reveal.DestBlend      = BLEND_FACTOR_INV_SRC_COLOR;
+        Reveal.SrcBlendAlpha  = BLEND_FACTOR_ZERO;
+        Reveal.DestBlendAlpha = BLEND_FACTOR_INV_SRC_ALPHA;
+    }
+    else
+    {
+        // 5b) Scene target. MSAA targets convert the sharpened alpha to a coverage mask.
+        if (Targets.Formats[Target] == TEX_FORMAT_UNKNOWN)
+            return;
+        Pipeline.NumRenderTargets                = 1;
+        Pipeline.RTVFormats[0]                   = Targets.Formats[Target];
+        Pipeline.SmplDesc.Count                  = IsMSAATarget(Target) ? kMSAASampleCount : 1;
+        Pipeline.BlendDesc.AlphaToCoverageEnable = IsMSAATarget(Target);
+    }
 
-    // 9) Create the PSO
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_pPSO);
+    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, ppPSO);
+    if (*ppPSO == nullptr)
+        return;
 
-    // 10) Bind the static VS constant buffer and create SRB
-    m_pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_VSConstants);
-    m_pPSO->CreateShaderResourceBinding(&m_SRB, true);
+    // 6) Bind the static constant buffers and the baked wing animation
+    (*ppPSO)->GetStaticVariableByName(SHADER_TYPE_VERTEX, "Constants")->Set(m_VSConstants);
+    if (MultiView)
+        (*ppPSO)->GetStaticVariableByName(SHADER_TYPE_GEOMETRY, "MultiViewConstants")->Set(m_MultiViewCB);
+    if (WingVAT)
+        (*ppPSO)->GetStaticVariableByName(SHADER_TYPE_VERTEX, "g_WingVAT")->Set(Targets.pWingVATSRV);
 }
 
 void Tutorial03_Texturing::CreateSkySphere()
@@ -157,110 +307,608 @@ void Tutorial03_Texturing::CreateSkySphere()
     cbd.CPUAccessFlags = CPU_ACCESS_WRITE;
     m_pDevice->CreateBuffer(cbd, nullptr, &m_SkyCB);
 
+    cbd.Name = "Sky streaming CB";
+    cbd.Size = sizeof(SkyStreamingConstants);
+    m_pDevice->CreateBuffer(cbd, nullptr, &m_SkyStreamCB);
+
+    // Per-draw shading rate lets the sky shade coarse pixels in place of the offscreen target
+    const auto& ShadingRate = m_pDevice->GetAdapterInfo().ShadingRate;
+    m_SkyVRSSupported       = m_pDevice->GetDeviceInfo().Features.VariableRateShading &&
+        (ShadingRate.CapFlags & SHADING_RATE_CAP_FLAG_PER_DRAW) != 0;
+    if (m_SkyVRSSupported)
+    {
+        for (Uint32 i = 0; i < ShadingRate.NumShadingRates; ++i)
+            m_SkyVRS4x4Supported |= ShadingRate.ShadingRates[i].Rate == SHADING_RATE_4X4;
+    }
+
     //----------------------------------------------------------------------------------------------
-    // 2) Load the equirectangular HDR sky texture from file and create SRV
+    // 2) Pipelines, shared by the full-resolution and tile-streaming paths
     //----------------------------------------------------------------------------------------------
-    TextureLoadInfo tli{};
-    tli.IsSRGB = true; // treat as sRGB for correct gamma
-    RefCntAutoPtr<ITexture> SkyTex;
-    CreateTextureFromFile("hdrHigh.png", tli, m_pDevice, &SkyTex);
-    m_SkySRV = SkyTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    SkyPipelines Pipelines;
+    CreateSkyPipelines(CapturePipelineTargets(), Pipelines);
+    m_SkyPSO         = Pipelines.Sky;
+    m_SkyStreamPSO   = Pipelines.Stream;
+    m_SkyUpsamplePSO = Pipelines.Upsample;
+    if (m_SkyUpsamplePSO[RENDER_TARGET_BACK_BUFFER])
+        m_SkyUpsamplePSO[RENDER_TARGET_BACK_BUFFER]->CreateShaderResourceBinding(&m_SkyUpsampleSRB, true);
+
+    // Pixel-shader invocation counts of the sky draws and of the upsample, read back a few frames late
+    if (m_pDevice->GetDeviceInfo().Features.PipelineStatisticsQueries)
+    {
+        QueryDesc StatsDesc;
+        StatsDesc.Name = "Sky pipeline statistics";
+        StatsDesc.Type = QUERY_TYPE_PIPELINE_STATISTICS;
+        m_SkyStatsQuery.reset(new ScopedQueryHelper{m_pDevice, StatsDesc, 3});
+        StatsDesc.Name = "Sky upsample pipeline statistics";
+        m_SkyUpsampleStatsQuery.reset(new ScopedQueryHelper{m_pDevice, StatsDesc, 3});
+    }
+
+    //----------------------------------------------------------------------------------------------
+    // 3) Prefer tile streaming; fall back to the full 8K texture if it is unavailable
+    //----------------------------------------------------------------------------------------------
+    //    Regression frames use the full texture: streamed tiles arrive over several frames.
+    m_SkyStreaming = m_SkyStreamPSO[RENDER_TARGET_BACK_BUFFER] && !m_Regression.IsEnabled() && InitSkyStreaming();
+    if (!m_SkyStreaming)
+        LoadSkyTexture();
+}
 
+bool Tutorial03_Texturing::CreateSkyPipelines(const PipelineTargets& Targets, SkyPipelines& Out) const
+{
     //----------------------------------------------------------------------------------------------
-    // 3) Configure graphics pipeline state for rendering the sky sphere
+    // 1) Configure graphics pipeline state for rendering the sky sphere
     //----------------------------------------------------------------------------------------------
     GraphicsPipelineStateCreateInfo PSOCreateInfo;
-    PSOCreateInfo.PSODesc.Name         = "SkySphere PSO";
     PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
 
-    // Render target & depth formats match the swap chain
-    const auto& SCDesc                              = m_pSwapChain->GetDesc();
+    // The colour format is set per render target. The sky is drawn without a
+    // depth buffer so that the same PSOs also render into the reduced-resolution target.
     PSOCreateInfo.GraphicsPipeline.NumRenderTargets = 1;
-    PSOCreateInfo.GraphicsPipeline.RTVFormats[0]    = SCDesc.ColorBufferFormat;
-    PSOCreateInfo.GraphicsPipeline.DSVFormat        = SCDesc.DepthBufferFormat;
+    PSOCreateInfo.GraphicsPipeline.DSVFormat        = TEX_FORMAT_UNKNOWN;
 
     // We only draw a full‐screen triangle, no depth test needed
     PSOCreateInfo.GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE;
     PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = False;
 
+    // Per-draw shading rate lets the sky shade coarse pixels in place of the offscreen target
+    if (m_SkyVRSSupported)
+        PSOCreateInfo.GraphicsPipeline.ShadingRateFlags = PIPELINE_SHADING_RATE_FLAG_PER_PRIMITIVE;
+
     //----------------------------------------------------------------------------------------------
-    // 4) Compile sky‐sphere shaders (HLSL entry points VSMain/PSMain in DepthGrid.hlsl)
+    // 2) Two variants: SKY_STREAMING = 0 samples the full-resolution texture,
+    //    SKY_STREAMING = 1 samples the tile cache and writes tile feedback.
+    //    Streaming needs UAV writes from the pixel shader.
     //----------------------------------------------------------------------------------------------
     ShaderCreateInfo ShaderCI;
     ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
-    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(nullptr, &ShaderCI.pShaderSourceStreamFactory);
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(m_ShaderSearchPath.c_str(), &ShaderCI.pShaderSourceStreamFactory);
 
-    RefCntAutoPtr<IShader> vs, ps;
-    // Vertex shader
-    ShaderCI.Desc       = {"Sky VS", SHADER_TYPE_VERTEX, true};
-    ShaderCI.EntryPoint = "VSMain";
-    ShaderCI.FilePath   = "DepthGrid.hlsl";
-    m_pDevice->CreateShader(ShaderCI, &vs);
+    SamplerDesc sampDesc{FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
+                         TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP};
+
+    const int NumVariants = m_pDevice->GetDeviceInfo().Features.PixelUAVWritesAndAtomics ? 2 : 1;
+    for (int Streaming = 0; Streaming < NumVariants; ++Streaming)
+    {
+        ShaderMacro Macros[] = {{"SKY_STREAMING", Streaming ? "1" : "0"}};
+        ShaderCI.Macros      = {Macros, _countof(Macros)};
 
-    // Pixel shader
-    ShaderCI.Desc       = {"Sky PS", SHADER_TYPE_PIXEL, true};
-    ShaderCI.EntryPoint = "PSMain";
-    m_pDevice->CreateShader(ShaderCI, &ps);
+        // Compile sky‐sphere shaders (HLSL entry points VSMain/PSMain in DepthGrid.hlsl)
+        RefCntAutoPtr<IShader> vs, ps;
+        ShaderCI.Desc       = {"Sky VS", SHADER_TYPE_VERTEX, true};
+        ShaderCI.EntryPoint = "VSMain";
+        ShaderCI.FilePath   = "DepthGrid.hlsl";
+        m_pDevice->CreateShader(ShaderCI, &vs);
 
-    PSOCreateInfo.pVS = vs;
-    PSOCreateInfo.pPS = ps;
+        ShaderCI.Desc       = {Streaming ? "Sky streaming PS" : "Sky PS", SHADER_TYPE_PIXEL, true};
+        ShaderCI.EntryPoint = "PSMain";
+        m_pDevice->CreateShader(ShaderCI, &ps);
 
-    //----------------------------------------------------------------------------------------------
-    // 5) Resource layout: mutable sky texture + immutable linear sampler
-    //----------------------------------------------------------------------------------------------
-    ShaderResourceVariableDesc Vars[] =
+        PSOCreateInfo.pVS = vs;
+        PSOCreateInfo.pPS = ps;
+
+        // Resource layout: mutable sky texture (or page table + feedback) and an immutable linear sampler
+        ShaderResourceVariableDesc Vars[] =
+            {
+                {SHADER_TYPE_PIXEL, "g_SkyTex", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
+        ShaderResourceVariableDesc StreamingVars[] =
+            {
+                {SHADER_TYPE_PIXEL, "g_SkyCache", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+                {SHADER_TYPE_PIXEL, "g_SkyPageTable", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+                {SHADER_TYPE_PIXEL, "g_SkyFeedback", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Streaming ? StreamingVars : Vars;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = Streaming ? _countof(StreamingVars) : _countof(Vars);
+
+        ImmutableSamplerDesc immutableSamp[]                      = {{SHADER_TYPE_PIXEL, Streaming ? "g_SkyCache" : "g_SkyTex", sampDesc}};
+        PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = immutableSamp;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(immutableSamp);
+
+        // Create one pipeline state per render target and bind the static CBs
+        for (Uint32 Target = 0; Target < RENDER_TARGET_COUNT; ++Target)
         {
-            {SHADER_TYPE_PIXEL, "g_SkyTex", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
-    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
-    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+            if (Targets.Formats[Target] == TEX_FORMAT_UNKNOWN)
+                continue;
 
-    SamplerDesc          sampDesc{FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR, FILTER_TYPE_LINEAR,
-                         TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP, TEXTURE_ADDRESS_CLAMP};
-    ImmutableSamplerDesc immutableSamp[]                      = {{SHADER_TYPE_PIXEL, "g_SkyTex", sampDesc}};
-    PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = immutableSamp;
-    PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(immutableSamp);
+            PSOCreateInfo.PSODesc.Name                    = Streaming ? "SkySphere streaming PSO" : "SkySphere PSO";
+            PSOCreateInfo.GraphicsPipeline.RTVFormats[0]  = Targets.Formats[Target];
+            PSOCreateInfo.GraphicsPipeline.SmplDesc.Count = IsMSAATarget(Target) ? kMSAASampleCount : 1;
+            auto& pPSO                                    = Streaming ? Out.Stream[Target] : Out.Sky[Target];
+            m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &pPSO);
+            if (!pPSO)
+                return false;
+
+            // Bind the sky‐sphere CB as a static VS variable named "CB"
+            pPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "CB")->Set(m_SkyCB);
+            if (Streaming)
+                pPSO->GetStaticVariableByName(SHADER_TYPE_PIXEL, "SkyStreamingCB")->Set(m_SkyStreamCB);
+        }
+    }
 
     //----------------------------------------------------------------------------------------------
-    // 6) Create the pipeline state and bind static resources
+    // 3) Bilinear upsample from the reduced-resolution sky target, one PSO per render target
     //----------------------------------------------------------------------------------------------
-    m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_SkyPSO);
+    {
+        ShaderCI.Macros = {};
+
+        RefCntAutoPtr<IShader> vs, ps;
+        ShaderCI.Desc       = {"Sky upsample VS", SHADER_TYPE_VERTEX, true};
+        ShaderCI.EntryPoint = "UpsampleVS";
+        ShaderCI.FilePath   = "DepthGrid.hlsl";
+        m_pDevice->CreateShader(ShaderCI, &vs);
+
+        ShaderCI.Desc       = {"Sky upsample PS", SHADER_TYPE_PIXEL, true};
+        ShaderCI.EntryPoint = "UpsamplePS";
+        m_pDevice->CreateShader(ShaderCI, &ps);
+
+        PSOCreateInfo.pVS                               = vs;
+        PSOCreateInfo.pPS                               = ps;
+        PSOCreateInfo.GraphicsPipeline.ShadingRateFlags = PIPELINE_SHADING_RATE_FLAG_NONE;
+
+        ShaderResourceVariableDesc Vars[] =
+            {
+                {SHADER_TYPE_PIXEL, "g_SkyLowRes", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+        ImmutableSamplerDesc immutableSamp[]                      = {{SHADER_TYPE_PIXEL, "g_SkyLowRes", sampDesc}};
+        PSOCreateInfo.PSODesc.ResourceLayout.ImmutableSamplers    = immutableSamp;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumImmutableSamplers = _countof(immutableSamp);
+
+        for (Uint32 Target = 0; Target < RENDER_TARGET_COUNT; ++Target)
+        {
+            if (Targets.Formats[Target] == TEX_FORMAT_UNKNOWN)
+                continue;
+
+            PSOCreateInfo.PSODesc.Name                    = "Sky upsample PSO";
+            PSOCreateInfo.GraphicsPipeline.RTVFormats[0]  = Targets.Formats[Target];
+            PSOCreateInfo.GraphicsPipeline.SmplDesc.Count = IsMSAATarget(Target) ? kMSAASampleCount : 1;
+            m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &Out.Upsample[Target]);
+            if (!Out.Upsample[Target])
+                return false;
+        }
+    }
+    return true;
+}
+
+
+void Tutorial03_Texturing::UpdateShaderHotReload()
+{
+    // 1) Collect saved files. Only the scene shaders have pipelines that can be
+    //    rebuilt in place; compute passes need their owners recreated.
+    if (m_ShaderWatcher.ConsumeChangedFiles(m_ChangedShaders))
+    {
+        for (const auto& FileName : m_ChangedShaders)
+        {
+            if (m_ButterflyPermutations->UsesFile(FileName.c_str()))
+                m_ReloadButterfly = true;
+            else if (FileName == "DepthGrid.hlsl")
+                m_ReloadSky = true;
+            else
+                LOG_INFO_MESSAGE(FileName, " changed; it is not hot-reloaded, restart the sample to apply it");
+        }
+    }
+
+    // 2) Install a finished rebuild at the frame boundary, before any pipeline is bound
+    if (m_PendingReload.valid() && m_PendingReload.wait_for(std::chrono::seconds{0}) == std::future_status::ready)
+    {
+        ShaderReload Reload = m_PendingReload.get();
+        if (Reload.Succeeded)
+        {
+            if (Reload.Butterfly)
+                m_ButterflyPermutations->Swap(Reload.ButterflyPSOs);
+            if (Reload.Sky)
+            {
+                m_SkyPSO         = Reload.SkyPSOs.Sky;
+                m_SkyStreamPSO   = Reload.SkyPSOs.Stream;
+                m_SkyUpsamplePSO = Reload.SkyPSOs.Upsample;
+            }
+            m_ShaderReloadStatus = FormatString("Shaders reloaded in ", static_cast<int>(Reload.CompileMs), " ms");
+            LOG_INFO_MESSAGE(m_ShaderReloadStatus);
+        }
+        else
+        {
+            m_ShaderReloadStatus = "Shader reload failed, keeping the previous pipelines";
+            LOG_ERROR_MESSAGE(m_ShaderReloadStatus, " (", static_cast<int>(Reload.CompileMs), " ms)");
+        }
+    }
+
+    // 3) Start a rebuild of everything that changed. Files saved while a job is
+    //    running are picked up by the next one.
+    if (m_PendingReload.valid() || !(m_ReloadButterfly || m_ReloadSky))
+        return;
+
+    // Formats and resources are captured here: the job must not read the swap chain,
+    // which WindowResize() may recreate while it runs.
+    auto Job = [this, Butterfly = m_ReloadButterfly, Sky = m_ReloadSky, Keys = m_ButterflyPermutations->GetKeys(), Targets = CapturePipelineTargets()]() {
+        const auto Start = std::chrono::high_resolution_clock::now();
+
+        ShaderReload Reload;
+        Reload.Butterfly = Butterfly;
+        Reload.Sky       = Sky;
+        Reload.Succeeded = (!Butterfly || m_ButterflyPermutations->Rebuild(Keys, Reload.ButterflyPSOs, [this, &Targets](PermutationKey Key, IShader* pVS, IShader* pPS, IPipelineState** ppPSO) {
+                                CreateButterflyPSO(Targets, Key, pVS, pPS, ppPSO);
+                            })) &&
+            (!Sky || CreateSkyPipelines(Targets, Reload.SkyPSOs));
+        Reload.CompileMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+        return Reload;
+    };
+    m_ReloadButterfly = false;
+    m_ReloadSky       = false;
+
+    // GL contexts are bound to the main thread, so compile there; the result is swapped next frame
+    if (m_pDevice->GetDeviceInfo().IsGLDevice())
+    {
+        std::promise<ShaderReload> Done;
+        Done.set_value(Job());
+        m_PendingReload = Done.get_future();
+    }
+    else
+    {
+        m_PendingReload = std::async(std::launch::async, std::move(Job));
+    }
+}
 
-    // Bind the sky‐sphere CB as a static VS variable named "CB"
-    m_SkyPSO->GetStaticVariableByName(SHADER_TYPE_VERTEX, "CB")->Set(m_SkyCB);
+void Tutorial03_Texturing::LoadSkyTexture()
+{
+    // Load the equirectangular HDR sky texture from file and create SRV + SRB.
+    // Only used when tile streaming is off; the full mip chain costs ~170 MB.
+    TextureLoadInfo tli{};
+    tli.IsSRGB = true; // treat as sRGB for correct gamma
+    RefCntAutoPtr<ITexture> SkyTex;
+    CreateTextureFromFile("hdrHigh.png", tli, m_pDevice, &SkyTex);
+    m_SkySRV = SkyTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
 
-    // Create SRB and set the sky texture SRV
-    m_SkyPSO->CreateShaderResourceBinding(&m_SkySRB, true);
+    m_SkySRB.Release();
+    m_SkyPSO[RENDER_TARGET_BACK_BUFFER]->CreateShaderResourceBinding(&m_SkySRB, true);
     m_SkySRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_SkyTex")->Set(m_SkySRV);
 }
 
-void Tutorial03_Texturing::InitInstanceData()
+bool Tutorial03_Texturing::InitSkyStreaming()
+{
+    // 1) Size the physical cache to the VRAM budget as a square grid of padded tiles
+    const Uint32 PaddedTile  = kSkyTileSize + 2 * kSkyTileBorder;
+    const Uint32 TileBytes   = PaddedTile * PaddedTile * 4;
+    const Uint32 SlotsPerRow = static_cast<Uint32>(std::sqrt(static_cast<double>(kSkyCacheBudget / TileBytes)));
+
+    // 2) Open the paged tile file, baking it from the PNG on first run
+    if (!m_SkyStreamer.Open(kSkyTileFile, SlotsPerRow * SlotsPerRow))
+    {
+        LOG_INFO_MESSAGE("Baking sky tile file '", kSkyTileFile, "' from hdrHigh.png");
+
+        RefCntAutoPtr<Image> pImage;
+        CreateImageFromFile("hdrHigh.png", &pImage);
+        if (!pImage || pImage->GetDesc().ComponentType != VT_UINT8)
+        {
+            LOG_WARNING_MESSAGE("Failed to load hdrHigh.png as 8-bit image; sky tile streaming is disabled");
+            return false;
+        }
+
+        const ImageDesc& ImgDesc = pImage->GetDesc();
+        if (!SkyTileStreamer::BakeTileFile(static_cast<const Uint8*>(pImage->GetData()->GetConstDataPtr()),
+                                           ImgDesc.Width, ImgDesc.Height, ImgDesc.NumComponents, ImgDesc.RowStride,
+                                           kSkyTileSize, kSkyTileBorder, kSkyTileFile))
+        {
+            LOG_WARNING_MESSAGE("Sky tile streaming is disabled");
+            return false;
+        }
+        if (!m_SkyStreamer.Open(kSkyTileFile, SlotsPerRow * SlotsPerRow))
+        {
+            LOG_WARNING_MESSAGE("Sky tile streaming is disabled");
+            return false;
+        }
+    }
+    const SkyTileFileHeader& Header = m_SkyStreamer.GetHeader();
+    if (Header.TileSize != kSkyTileSize || Header.Border != kSkyTileBorder)
+    {
+        LOG_WARNING_MESSAGE("'", kSkyTileFile, "' was baked with a different tile size; delete it to rebake. Sky tile streaming is disabled");
+        m_SkyStreamer.Close();
+        return false;
+    }
+
+    // 3) Cache texture. Tiles are sampled with an explicit LOD, so it has a single mip.
+    TextureDesc CacheDesc;
+    CacheDesc.Name      = "Sky tile cache";
+    CacheDesc.Type      = RESOURCE_DIM_TEX_2D;
+    CacheDesc.Width     = SlotsPerRow * PaddedTile;
+    CacheDesc.Height    = SlotsPerRow * PaddedTile;
+    CacheDesc.Format    = TEX_FORMAT_RGBA8_UNORM_SRGB;
+    CacheDesc.Usage     = USAGE_DEFAULT;
+    CacheDesc.BindFlags = BIND_SHADER_RESOURCE;
+    m_pDevice->CreateTexture(CacheDesc, nullptr, &m_SkyCache);
+
+    // 4) Page table and feedback buffers hold one uint per virtual tile
+    std::vector<Uint32> Zeros(Header.NumTiles, 0);
+    BufferData          InitData{Zeros.data(), sizeof(Uint32) * Header.NumTiles};
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name              = "Sky page table";
+    BuffDesc.Usage             = USAGE_DEFAULT;
+    BuffDesc.BindFlags         = BIND_SHADER_RESOURCE;
+    BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+    BuffDesc.ElementByteStride = sizeof(Uint32);
+    BuffDesc.Size              = sizeof(Uint32) * Header.NumTiles;
+    m_pDevice->CreateBuffer(BuffDesc, &InitData, &m_SkyPageTable);
+
+    BuffDesc.Name      = "Sky tile feedback";
+    BuffDesc.BindFlags = BIND_UNORDERED_ACCESS;
+    m_pDevice->CreateBuffer(BuffDesc, &InitData, &m_SkyFeedback);
+
+    BufferDesc ReadbackDesc;
+    ReadbackDesc.Name           = "Sky tile feedback readback";
+    ReadbackDesc.Usage          = USAGE_STAGING;
+    ReadbackDesc.CPUAccessFlags = CPU_ACCESS_READ;
+    ReadbackDesc.Size           = BuffDesc.Size;
+    for (auto& pReadback : m_SkyFeedbackReadback)
+        m_pDevice->CreateBuffer(ReadbackDesc, nullptr, &pReadback);
+
+    FenceDesc FncDesc;
+    FncDesc.Name = "Sky feedback fence";
+    FncDesc.Type = FENCE_TYPE_CPU_WAIT_ONLY;
+    m_pDevice->CreateFence(FncDesc, &m_SkyFeedbackFence);
+
+    // 5) Constants that do not change while streaming
+    m_SkyStreamConsts              = {};
+    m_SkyStreamConsts.VirtualSize  = float2{static_cast<float>(Header.Width), static_cast<float>(Header.Height)};
+    m_SkyStreamConsts.CacheSize    = float2{static_cast<float>(CacheDesc.Width), static_cast<float>(CacheDesc.Height)};
+    m_SkyStreamConsts.TileSize     = static_cast<float>(Header.TileSize);
+    m_SkyStreamConsts.TileBorder   = static_cast<float>(Header.Border);
+    m_SkyStreamConsts.SlotsPerRow  = SlotsPerRow;
+    m_SkyStreamConsts.NumMips      = Header.NumMips;
+    m_SkyStreamConsts.FeedbackMask = kSkyFeedbackMask;
+    for (Uint32 Mip = 0; Mip < Header.NumMips; ++Mip)
+        m_SkyStreamConsts.MipFirstTile[Mip].x = m_SkyStreamer.GetMipFirstTile(Mip);
+
+    m_SkyStreamPSO[RENDER_TARGET_BACK_BUFFER]->CreateShaderResourceBinding(&m_SkyStreamSRB, true);
+    m_SkyStreamSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_SkyCache")->Set(m_SkyCache->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+    m_SkyStreamSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_SkyPageTable")->Set(m_SkyPageTable->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    m_SkyStreamSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_SkyFeedback")->Set(m_SkyFeedback->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+
+    // 6) Upload the pinned coarsest mip so that every lookup has a fallback from the first frame
+    UpdateSkyStreaming();
+    return true;
+}
+
+void Tutorial03_Texturing::UpdateSkyStreaming()
+{
+    ALLOCATION_SCOPE("UpdateSkyStreaming");
+
+    // 1) Consume the newest feedback that the GPU has finished writing. Older
+    //    completed readbacks are dropped; pending ones are never waited on.
+    const Uint64 Completed = m_SkyFeedbackFence->GetCompletedValue();
+    Uint32       Newest    = ~0u;
+    for (Uint32 i = 0; i < kNumSkyFeedbackReadbacks; ++i)
+    {
+        if (m_SkyFeedbackFenceValues[i] == 0 || m_SkyFeedbackFenceValues[i] > Completed)
+            continue;
+        if (Newest == ~0u || m_SkyFeedbackStamps[i] > m_SkyFeedbackStamps[Newest])
+            Newest = i;
+    }
+    if (Newest != ~0u)
+    {
+        {
+            MapHelper<Uint32> Feedback(m_pImmediateContext, m_SkyFeedbackReadback[Newest], MAP_READ, MAP_FLAG_DO_NOT_WAIT);
+            if (Feedback)
+                m_SkyStreamer.ProcessFeedback(Feedback, m_SkyFeedbackStamps[Newest]);
+        }
+        for (Uint32 i = 0; i < kNumSkyFeedbackReadbacks; ++i)
+        {
+            if (m_SkyFeedbackFenceValues[i] != 0 && m_SkyFeedbackFenceValues[i] <= Completed)
+                m_SkyFeedbackFenceValues[i] = 0;
+        }
+    }
+
+    // 2) Copy tiles loaded by the streaming thread into their cache slots
+    const Uint32 PaddedTile  = m_SkyStreamer.GetPaddedTileSize();
+    const Uint32 SlotsPerRow = m_SkyStreamConsts.SlotsPerRow;
+    m_SkyTilesUploaded       = m_SkyStreamer.ConsumeLoadedTiles(
+        kSkyMaxUploadsPerFrame,
+        [&](Uint32 Slot, const Uint8* pTexels) {
+            Box DstBox;
+            DstBox.MinX = (Slot % SlotsPerRow) * PaddedTile;
+            DstBox.MaxX = DstBox.MinX + PaddedTile;
+            DstBox.MinY = (Slot / SlotsPerRow) * PaddedTile;
+            DstBox.MaxY = DstBox.MinY + PaddedTile;
+
+            TextureSubResData SubresData{pTexels, Uint64{PaddedTile} * 4};
+            m_pImmediateContext->UpdateTexture(m_SkyCache, 0, 0, DstBox, SubresData,
+                                               RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                               RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        });
+
+    // 3) Publish residency changes; the table is a few KB, so it is uploaded whole
+    if (m_SkyStreamer.IsPageTableDirty())
+    {
+        const auto& PageTable = m_SkyStreamer.GetPageTable();
+        m_pImmediateContext->UpdateBuffer(m_SkyPageTable, 0, sizeof(Uint32) * PageTable.size(), PageTable.data(),
+                                          RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_SkyStreamer.ClearPageTableDirty();
+    }
+
+    // 4) New stamp for this frame's feedback
+    m_SkyStreamConsts.FeedbackStamp = ++m_SkyFeedbackStamp;
+    MapHelper<SkyStreamingConstants> CB(m_pImmediateContext, m_SkyStreamCB, MAP_WRITE, MAP_FLAG_DISCARD);
+    *CB = m_SkyStreamConsts;
+}
+
+void Tutorial03_Texturing::ReadBackSkyFeedback()
+{
+    // Skip this frame's feedback if the ring slot is still in flight rather than stall
+    const Uint32 Idx = m_SkyReadbackIndex;
+    if (m_SkyFeedbackFenceValues[Idx] != 0)
+        return;
+
+    m_pImmediateContext->CopyBuffer(m_SkyFeedback, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                    m_SkyFeedbackReadback[Idx], 0, m_SkyFeedback->GetDesc().Size,
+                                    RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->EnqueueSignal(m_SkyFeedbackFence, ++m_SkyFeedbackFenceValue);
+    m_SkyFeedbackFenceValues[Idx] = m_SkyFeedbackFenceValue;
+    m_SkyFeedbackStamps[Idx]      = m_SkyFeedbackStamp;
+    m_SkyReadbackIndex            = (Idx + 1) % kNumSkyFeedbackReadbacks;
+}
+
+void Tutorial03_Texturing::InitInstanceData(Uint32 Seed)
 {
     // Prepare containers
     m_InstanceCenters.clear();
     m_InstancePhases.clear();
-    m_InstanceCenters.reserve(m_InstanceCount);
-    m_InstancePhases.reserve(m_InstanceCount);
+    m_Clusters.clear();
+    m_NextSpawnIndex = 0;
+
+    // Spawn index i depends only on the spawn settings and i, so a fresh swarm of
+    // N instances is always spawn indices [0, N), whatever order their slots end up in.
+    // The Poisson disk grid is sized for the count at reset; instances added past it
+    // start another pass over the grid until the next reset.
+    SpawnDesc Desc;
+    Desc.Distribution  = InstanceGenerator::FindDistribution(m_Swarm.Spawn);
+    Desc.Seed          = Seed;
+    Desc.FilePath      = m_Swarm.SpawnFile;
+    Desc.MinDistance   = m_Swarm.MinDistance;
+    Desc.NumInstances  = m_InstanceCount;
+    Desc.NumClusters   = m_Swarm.NumClusters;
+    Desc.ClusterRadius = m_Swarm.ClusterRadius;
+    if (Desc.Distribution == SPAWN_DISTRIBUTION_COUNT || !m_InstanceGenerator.Init(Desc))
+    {
+        LOG_WARNING_MESSAGE("Spawn distribution '", m_Swarm.Spawn, "' is unavailable, using a uniform box");
+        Desc.Distribution = SPAWN_DISTRIBUTION_UNIFORM_BOX;
+        m_InstanceGenerator.Init(Desc);
+    }
+
+    const Uint32 NumInstances = m_InstanceCount;
+    m_InstanceCount           = 0;
+    AppendInstances(NumInstances);
+}
+
+void Tutorial03_Texturing::AppendInstances(Uint32 NumNew)
+{
+    const Uint32 FirstNew = m_InstanceCount;
+    m_InstanceCenters.resize(FirstNew + NumNew);
+    m_InstancePhases.resize(FirstNew + NumNew);
+
+    // Orbit centres and initial phases around the orbit, generated in parallel straight
+    // into the slots of their cluster, see InstanceGenerator::GenerateByCell.
+    // Slots are reordered by cluster, so after a shrink the surviving slots hold spawn
+    // indices from the whole old range. New instances therefore continue after the
+    // highest index ever generated rather than at m_InstanceCount, which would spawn
+    // copies of survivors (same centre and phase).
+    const auto                                Start = std::chrono::high_resolution_clock::now();
+    std::vector<InstanceGenerator::CellRange> Cells;
+    m_InstanceGenerator.GenerateByCell(m_NextSpawnIndex, NumNew, kClusterSize, m_InstanceCenters.data() + FirstNew, m_InstancePhases.data() + FirstNew, Cells);
+    m_NextSpawnIndex += NumNew;
+    m_InstanceCount += NumNew;
+    BuildInstanceClusters(FirstNew, Cells);
+    if (FirstNew == 0)
+        m_NumCompactClusters = static_cast<Uint32>(m_Clusters.size());
+    if (NumNew > InstanceGenerator::kChunkSize)
+    {
+        LOG_INFO_MESSAGE("Generated and clustered ", NumNew, " instances in ",
+                         std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count(), " ms");
+    }
+
+    ++m_SwarmVersion;
+}
+
+void Tutorial03_Texturing::BuildInstanceClusters(Uint32 FirstInstance, const std::vector<InstanceGenerator::CellRange>& Cells)
+{
+    // Orbit centres never move, so instances are bucketed by the coarse grid cell of
+    // their centre once, and every cluster is a contiguous range of m_InstanceWorlds
+    // (and of the instance buffer). Cells holds the instances from FirstInstance on,
+    // so existing instances keep their slots when the swarm grows.
+    for (const InstanceGenerator::CellRange& Cell : Cells)
+    {
+        InstanceCluster Cluster;
+        Cluster.CenterBounds  = BoundBox{Cell.Min, Cell.Max};
+        Cluster.FirstInstance = FirstInstance + Cell.First;
+        Cluster.NumInstances  = Cell.Count;
+        m_Clusters.push_back(Cluster);
+    }
+
+    // Culling fills these every frame; reserve the worst case so that it never allocates
+    m_ClusterViews.reserve(m_Clusters.size());
+    for (auto& Ranges : m_ViewDrawRanges)
+        Ranges.reserve(m_Clusters.size());
+}
+
+void Tutorial03_Texturing::ResizeSwarm(Uint32 NewCount)
+{
+    if (m_SimulationMode == SIMULATION_MODE_FLOCKING_GPU && m_FlockCompare)
+        NewCount = std::min(NewCount, kFlockCompareMaxCount);
+    m_Swarm.InstanceCount = NewCount;
 
-    // Set up random generators
-    std::mt19937                          rng{std::random_device{}()};
-    std::uniform_real_distribution<float> distX(-20.f, 20.f);       // X range
-    std::uniform_real_distribution<float> distY(-10.f, 10.f);       // Y range
-    std::uniform_real_distribution<float> distZ(-30.f, 30.f);       // Z range
-    std::uniform_real_distribution<float> distPhase(0.f, 2 * PI_F); // start angle
+    const Uint32 OldCount = m_InstanceCount;
+    if (NewCount == OldCount)
+        return;
+    Uint32 NumToPreserve = std::min(OldCount, NewCount); // slots whose spawn data is unchanged
 
-    // Populate per-instance data
-    for (Uint32 i = 0; i < m_InstanceCount; ++i)
+    if (NewCount < OldCount)
+    {
+        // Shrinking keeps all GPU allocations; trailing instances are simply not drawn
+        m_InstanceCount = NewCount;
+        m_InstanceCenters.resize(NewCount);
+        m_InstancePhases.resize(NewCount);
+        while (!m_Clusters.empty() && m_Clusters.back().FirstInstance >= NewCount)
+            m_Clusters.pop_back();
+        if (!m_Clusters.empty())
+            m_Clusters.back().NumInstances = NewCount - m_Clusters.back().FirstInstance;
+        m_FlockCPUAgents.resize(NewCount);
+        ++m_SwarmVersion;
+    }
+    else
     {
-        // Random 3D spawn point
-        float cx = distX(rng);
-        float cy = distY(rng);
-        float cz = distZ(rng);
-        m_InstanceCenters.emplace_back(cx, cy, cz);
+        // Existing instances keep their spawn data and GPU contents; only the new ones are generated
+        AppendInstances(NewCount - OldCount);
+
+        // Every grow adds its own clusters, so a cell can end up split into one cluster per
+        // grow. Once there are kMaxClusterFragmentation times as many clusters as the last
+        // full clustering had, the swarm is respawned in one pass as spawn indices
+        // [0, NewCount), exactly what a reset to NewCount would give. Without a shrink in
+        // between those are the instances already alive, only in new slots. Flocking and
+        // playback do not cull by cluster and keep their slots.
+        const bool ClusterCulling = m_SimulationMode == SIMULATION_MODE_ORBITS || m_SimulationMode == SIMULATION_MODE_ANALYTIC_VS;
+        if (ClusterCulling && m_Clusters.size() > size_t{kMaxClusterFragmentation} * std::max(m_NumCompactClusters, 1u))
+        {
+            m_InstanceCount  = 0;
+            m_NextSpawnIndex = 0;
+            m_Clusters.clear();
+            AppendInstances(NewCount);
+            NumToPreserve = 0;
+        }
 
-        // Random initial phase around orbit
-        m_InstancePhases.push_back(distPhase(rng));
+        if (NewCount > m_InstanceCapacity)
+        {
+            // Grow geometrically so that ramping the count up does not reallocate every frame
+            m_InstanceCapacity = std::max(NewCount, m_InstanceCapacity * 2);
+            CreateInstanceBuffer(NumToPreserve);
+            if (m_pDevice->GetDeviceInfo().Features.ComputeShaders)
+            {
+                CreateFlockingBuffers(NumToPreserve);
+                CreateInstanceSortBuffers();
+            }
+        }
+        if (m_pDevice->GetDeviceInfo().Features.ComputeShaders)
+            InitFlockingAgents(NumToPreserve);
     }
+
+    m_InstanceDirty.Resize(m_InstanceCount);
+    CreateInstanceParamsBuffer(NumToPreserve);
 }
 
 void Tutorial03_Texturing::CreateVertexBuffer()
@@ -293,166 +941,2747 @@ void Tutorial03_Texturing::CreateIndexBuffer()
     m_pDevice->CreateBuffer(IndBuffDesc, &IBData, &m_ButterflyIndexBuffer);
 }
 
-void Tutorial03_Texturing::GenerateInstanceData(float Time)
+RefCntAutoPtr<IBuffer> Tutorial03_Texturing::CreateInstanceIndexBuffer(IRenderDevice* pDevice, const char* Name, Uint32 NumInstances)
 {
-    // Prepare output container
-    m_InstanceWorlds.clear();
-    m_InstanceWorlds.reserve(m_InstanceCount);
+    // Element i holds i. Per-instance attributes are fetched at FirstInstanceLocation + SV_InstanceID
+    // on every backend, so this stream gives cube.vsh the absolute instance index of a partial draw.
+    std::vector<Uint32> Indices(NumInstances);
+    std::iota(Indices.begin(), Indices.end(), 0u);
 
-    // Compute vertical bob offset once per frame
-    float bobPhase  = Time * kBobFreq * 2.0f * PI_F;
-    float bobOffset = kBobAmp * (0.6f * std::sin(bobPhase) + 0.4f * std::sin(bobPhase * 2.3f));
-
-    // Build world matrix for each butterfly
-    for (Uint32 i = 0; i < m_InstanceCount; ++i)
-    {
-        // 1) Compute orbit angle: startPhase + global speed*time
-        float theta = m_InstancePhases[i] + Time * kSpeed;
-
-        // 2) Position on horizontal circle + vertical bob
-        const auto& C = m_InstanceCenters[i];
-        float       x = C.x + kRadius * std::cos(theta);
-        float       y = C.y + bobOffset;
-        float       z = C.z + kRadius * std::sin(theta);
-
-        // 3) Compute forward vector tangent to the circle
-        float3 forward = normalize(float3{
-            -kRadius * std::sin(theta), // dx/dθ
-            0.0f,
-            kRadius * std::cos(theta) // dz/dθ
-        });
+    BufferDesc BuffDesc;
+    BuffDesc.Name      = Name;
+    BuffDesc.Usage     = USAGE_IMMUTABLE;
+    BuffDesc.BindFlags = BIND_VERTEX_BUFFER;
+    BuffDesc.Size      = sizeof(Uint32) * NumInstances;
 
-        // 4) Assemble world matrix and store
-        m_InstanceWorlds.push_back(
-            MakeWorld({x, y, z}, forward, float3{0, 1, 0}));
-    }
+    BufferData             InitData{Indices.data(), BuffDesc.Size};
+    RefCntAutoPtr<IBuffer> pBuffer;
+    pDevice->CreateBuffer(BuffDesc, &InitData, &pBuffer);
+    return pBuffer;
 }
 
-void Tutorial03_Texturing::DrawButterflies()
+void Tutorial03_Texturing::CreateInstanceBuffer(Uint32 NumToPreserve)
 {
-    // Compute common wing flap angle for all butterflies this frame
-    const float wingAng = std::sin(m_PathTime * 2.f * PI_F * kWingFactor) * kWingAmp;
+    // Structured buffer of world matrices, indexed by the instance index in cube.vsh.
+    // Filled with UpdateBuffer in orbit mode or written directly by Flocking.csh.
+    // Sized for m_InstanceCapacity so that the swarm can grow without reallocating.
+    BufferDesc InstBuffDesc;
+    InstBuffDesc.Name              = "Butterfly instance buffer";
+    InstBuffDesc.Usage             = USAGE_DEFAULT;
+    InstBuffDesc.BindFlags         = BIND_SHADER_RESOURCE;
+    InstBuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+    InstBuffDesc.ElementByteStride = sizeof(float4x4);
+    InstBuffDesc.Size              = sizeof(float4x4) * m_InstanceCapacity;
+    if (m_pDevice->GetDeviceInfo().Features.ComputeShaders)
+        InstBuffDesc.BindFlags |= BIND_UNORDERED_ACCESS;
 
-    // Setup draw parameters (same index buffer for every instance)
-    DrawIndexedAttribs Attribs;
-    Attribs.IndexType  = VT_UINT32;
-    Attribs.NumIndices = Butterfly::ButterflyIndexCount;
-    Attribs.Flags      = DRAW_FLAG_VERIFY_ALL;
+    RefCntAutoPtr<IBuffer> pOldBuffer{m_InstanceBuffer};
+    m_InstanceBuffer.Release();
+    m_pDevice->CreateBuffer(InstBuffDesc, nullptr, &m_InstanceBuffer);
 
-    // Loop through each instance world matrix
-    for (Uint32 i = 0; i < m_InstanceWorlds.size(); ++i)
+    // Carry over the transforms that are still valid when growing
+    if (pOldBuffer && NumToPreserve > 0)
     {
-        // 1) Compute World×ViewProj for this instance
-        float4x4 wvp = m_InstanceWorlds[i] * m_WorldViewProj;
-
-        // 2) Map the VS constant buffer (discard old), write new constants
-        MapHelper<VSConstants> CB(m_pImmediateContext, m_VSConstants,
-                                  MAP_WRITE, MAP_FLAG_DISCARD);
-        CB->WorldViewProj = wvp;     // per-instance transform
-        CB->WingAngle     = wingAng; // common flap angle
-
-        // 3) Draw the indexed mesh for this butterfly
-        m_pImmediateContext->DrawIndexed(Attribs);
+        m_pImmediateContext->CopyBuffer(pOldBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                        m_InstanceBuffer, 0, sizeof(float4x4) * NumToPreserve,
+                                        RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     }
-}
 
-void Tutorial03_Texturing::LoadTexture()
-{
-    // Configure texture loading as sRGB
-    TextureLoadInfo loadInfo;
-    loadInfo.IsSRGB = true;
+    // One staging buffer per frame slot for large dirty ranges, see UploadDirtyInstances()
+    BufferDesc StagingDesc;
+    StagingDesc.Name           = "Butterfly instance staging buffer";
+    StagingDesc.Usage          = USAGE_STAGING;
+    StagingDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    StagingDesc.Size           = InstBuffDesc.Size;
+    for (auto& pStaging : m_InstanceStaging)
+    {
+        pStaging.Release();
+        m_pDevice->CreateBuffer(StagingDesc, nullptr, &pStaging);
+    }
 
-    // Load texture from file
-    RefCntAutoPtr<ITexture> Tex;
-    CreateTextureFromFile("try.png", loadInfo, m_pDevice, &Tex);
+    // The index stream only depends on the capacity
+    m_InstanceIndexBuffer = CreateInstanceIndexBuffer(m_pDevice, "Butterfly instance indices", m_InstanceCapacity);
 
-    // Obtain SRV for use in the pixel shader
-    m_TextureSRV = Tex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    // Contents past NumToPreserve are undefined until uploaded
+    m_InstanceDirty.Resize(m_InstanceCount);
+    if (NumToPreserve == 0)
+        m_InstanceDirty.MarkAllDirty();
 
-    // Bind the texture SRV to the shader variable "g_Texture"
-    m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV);
+    // The buffer is recreated whenever the swarm is reset or outgrows it, so allow rebinding
+    m_SRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_Instances")->Set(m_InstanceBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+    if (m_SortedSRB)
+        m_SortedSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_Instances")->Set(m_InstanceBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
 }
 
-void Tutorial03_Texturing::Initialize(const SampleInitInfo& InitInfo)
+void Tutorial03_Texturing::CreateInstanceParamsBuffer(Uint32 NumToPreserve)
 {
-    // 1) Base class initialization (window, swap chain, input, etc.)
-    SampleBase::Initialize(InitInfo);
+    // Per-instance orbit parameters for the analytic VS: xyz - centre, w - start phase.
+    // Existing instances never change their spawn data, so like the instance buffer this one
+    // is sized for m_InstanceCapacity and only the instances past NumToPreserve are uploaded.
+    const Uint64 Size = sizeof(float4) * Uint64{m_InstanceCapacity};
+    if (!m_InstanceParamsBuffer || m_InstanceParamsBuffer->GetDesc().Size != Size)
+    {
+        BufferDesc ParamsDesc;
+        ParamsDesc.Name              = "Butterfly instance params";
+        ParamsDesc.Usage             = USAGE_DEFAULT;
+        ParamsDesc.BindFlags         = BIND_SHADER_RESOURCE;
+        ParamsDesc.Mode              = BUFFER_MODE_STRUCTURED;
+        ParamsDesc.ElementByteStride = sizeof(float4);
+        ParamsDesc.Size              = Size;
 
-    // 2) Configure camera position, orientation, and projection
-    const auto SCDesc = m_pSwapChain->GetDesc();
-    m_Camera.SetPos(float3{0.f, 0.f, -30.f}); // move camera back
-    m_Camera.SetRotation(0.f, 0.f);
-    m_Camera.SetMoveSpeed(4.f);
-    m_Camera.SetRotationSpeed(0.006f);
-    m_Camera.SetProjAttribs(
-        0.1f, 100.f,
-        static_cast<float>(SCDesc.Width) / SCDesc.Height,
-        PI_F / 4,
-        SCDesc.PreTransform,
-        m_pDevice->GetDeviceInfo().IsGLDevice());
+        RefCntAutoPtr<IBuffer> pOldBuffer{m_InstanceParamsBuffer};
+        m_InstanceParamsBuffer.Release();
+        m_pDevice->CreateBuffer(ParamsDesc, nullptr, &m_InstanceParamsBuffer);
 
-    // 3) Create rendering pipeline, mesh buffers, and sky sphere
-    CreatePipelineState();
-    CreateVertexBuffer();
-    CreateIndexBuffer();
-    LoadTexture();
-    CreateSkySphere();
+        if (pOldBuffer && NumToPreserve > 0)
+        {
+            m_pImmediateContext->CopyBuffer(pOldBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                            m_InstanceParamsBuffer, 0, sizeof(float4) * NumToPreserve,
+                                            RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
+        m_AnalyticSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_InstanceParams")->Set(m_InstanceParamsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+    }
 
-    // 4) Set up butterfly instance centers & phases, and generate initial worlds
-    InitInstanceData();
-    GenerateInstanceData(0.0f);
+    if (NumToPreserve >= m_InstanceCount)
+        return;
+
+    std::vector<float4> InstanceParams(m_InstanceCount - NumToPreserve);
+    for (Uint32 i = NumToPreserve; i < m_InstanceCount; ++i)
+        InstanceParams[i - NumToPreserve] = float4{m_InstanceCenters[i], m_InstancePhases[i]};
+    m_pImmediateContext->UpdateBuffer(m_InstanceParamsBuffer, sizeof(float4) * NumToPreserve, sizeof(float4) * static_cast<Uint64>(InstanceParams.size()),
+                                      InstanceParams.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 }
 
-void Tutorial03_Texturing::Render()
+OrbitParams Tutorial03_Texturing::GetOrbitParams() const
 {
-    // 1) Acquire back buffer and depth-stencil views
-    auto* pRTV = m_pSwapChain->GetCurrentBackBufferRTV();
-    auto* pDSV = m_pSwapChain->GetDepthBufferDSV();
+    OrbitParams Params;
+    Params.Radius  = m_Swarm.Radius;
+    Params.Speed   = m_Swarm.Speed;
+    Params.BobAmp  = m_Swarm.BobAmp;
+    Params.BobFreq = m_Swarm.BobFreq;
+    return Params;
+}
+
+float4x4 Tutorial03_Texturing::EvaluateInstance(Uint32 i, float Time, float BobOffset)
+{
+    // The orbit math is shared with the simulation thread, see SwarmSimulation.cpp
+    return EvaluateOrbit(m_InstanceCenters[i], m_InstancePhases[i], Time, BobOffset, GetOrbitParams());
+}
+
+void Tutorial03_Texturing::GenerateInstanceData(float Time)
+{
+    ALLOCATION_SCOPE("GenerateInstanceData");
+
+    // Instance worlds are updated in place; Render uploads only dirty chunks
+    m_InstanceWorlds.resize(m_InstanceCount);
+    m_NumInstancesUpdated = 0;
+
+    // Compute vertical bob offset once per frame
+    const float bobOffset = ComputeBobOffset(Time, GetOrbitParams());
+
+    auto UpdateRange = [&](Uint32 First, Uint32 Count) {
+        for (Uint32 i = First; i < First + Count; ++i)
+            m_InstanceWorlds[i] = EvaluateInstance(i, Time, bobOffset);
+        m_InstanceDirty.MarkDirty(First, Count);
+        m_NumInstancesUpdated += Count;
+    };
+
+    if (!m_LazyInstanceUpdates)
+    {
+        UpdateRange(0, m_InstanceCount);
+        return;
+    }
+
+    // Visibility comes from CullClusters, which tests every cluster against all views
+    // once per frame. Clusters it has not seen yet (the swarm just grew) count as visible.
+    const Uint32 AllViews = (1u << static_cast<Uint32>(m_NumViews)) - 1u;
+    const float3 Extent{m_Swarm.Radius + kMeshRadius, m_Swarm.BobAmp + kMeshRadius, m_Swarm.Radius + kMeshRadius};
+
+    for (Uint32 c = 0; c < m_Clusters.size(); ++c)
+    {
+        InstanceCluster& Cluster  = m_Clusters[c];
+        const Uint32     ViewMask = c < m_ClusterViews.size() ? m_ClusterViews[c] : AllViews;
+        const bool       Visible  = ViewMask != 0;
+        const float3     Center   = (Cluster.CenterBounds.Min + Cluster.CenterBounds.Max) * 0.5f;
+
+        // The nearest view that sees the cluster sets the refresh rate
+        float Dist = FLT_MAX;
+        for (Uint32 View = 0; View < kMaxViews; ++View)
+        {
+            if (ViewMask & (1u << View))
+                Dist = std::min(Dist, length(Center - m_Views[View].CamPos));
+        }
+
+        const bool BecameVisible = Visible && !Cluster.WasVisible;
+        Cluster.WasVisible       = Visible;
+
+        // Off-screen clusters keep their last transforms until they come into view
+        if (!Visible && Cluster.IsValid)
+            continue;
+
+        // Distant clusters refresh at a reduced, staggered rate. Motion is a
+        // closed-form function of Time, so skipped frames never accumulate drift.
+        const Uint32 Interval = Dist < kFullRateDistance ? 1u : (Dist < 2.0f * kFullRateDistance ? 2u : 4u);
+        if (!Cluster.IsValid || BecameVisible || (m_FrameIndex + c) % Interval == 0)
+        {
+            UpdateRange(Cluster.FirstInstance, Cluster.NumInstances);
+            Cluster.IsValid = true;
+        }
+    }
+}
+
+void Tutorial03_Texturing::CullClusters()
+{
+    ALLOCATION_SCOPE("CullClusters");
+
+    // Cluster bounds enclose the orbits, so they hold for the CPU, simulation-thread and
+    // analytic VS orbits. Playback and flocking move the instances elsewhere and draw all of them.
+    m_DrawRangesValid = m_SimulationMode == SIMULATION_MODE_ORBITS || m_SimulationMode == SIMULATION_MODE_ANALYTIC_VS;
+    m_ClusterViews.clear();
+    m_NumClustersVisible = 0;
+    m_ViewClustersVisible.fill(0);
+    for (auto& Ranges : m_ViewDrawRanges)
+        Ranges.clear();
+    if (!m_DrawRangesValid)
+        return;
+
+    const Uint32 NumViews = static_cast<Uint32>(m_NumViews);
+    ViewFrustum  Frustums[kMaxViews];
+    for (Uint32 View = 0; View < NumViews; ++View)
+        ExtractViewFrustumPlanesFromMatrix(m_Views[View].ViewProj, Frustums[View], m_pDevice->GetDeviceInfo().IsGLDevice());
+
+    // Clusters are in instance order, so ranges only ever grow at the back
+    auto AddRange = [&](Uint32 Slot, const InstanceCluster& Cluster) {
+        auto& Ranges = m_ViewDrawRanges[Slot];
+        if (!Ranges.empty() && Cluster.FirstInstance - (Ranges.back().FirstInstance + Ranges.back().NumInstances) <= kDrawRangeMergeGap)
+            Ranges.back().NumInstances = Cluster.FirstInstance + Cluster.NumInstances - Ranges.back().FirstInstance;
+        else
+            Ranges.push_back({Cluster.FirstInstance, Cluster.NumInstances});
+    };
+
+    // Conservative per-instance extent: full orbit, bob, plus the mesh itself.
+    // Recomputed every frame since radius and bob amplitude are tunable.
+    const float3 Extent{m_Swarm.Radius + kMeshRadius, m_Swarm.BobAmp + kMeshRadius, m_Swarm.Radius + kMeshRadius};
+
+    // All views are culled in the same pass over the clusters
+    for (const InstanceCluster& Cluster : m_Clusters)
+    {
+        const BoundBox Bounds{Cluster.CenterBounds.Min - Extent, Cluster.CenterBounds.Max + Extent};
+
+        Uint8 ViewMask = 0;
+        for (Uint32 View = 0; View < NumViews; ++View)
+        {
+            if (GetBoxVisibility(Frustums[View], Bounds) == BoxVisibility::Invisible)
+                continue;
+            ViewMask |= static_cast<Uint8>(1u << View);
+            ++m_ViewClustersVisible[View];
+            AddRange(View, Cluster);
+        }
+        if (ViewMask != 0)
+        {
+            ++m_NumClustersVisible;
+            AddRange(kMaxViews, Cluster);
+        }
+        m_ClusterViews.push_back(ViewMask);
+    }
+}
+
+void Tutorial03_Texturing::UploadDirtyInstances()
+{
+    ALLOCATION_SCOPE("UploadDirtyInstances");
+
+    m_UploadStats                 = {};
+    m_UploadStats.FullUploadBytes = sizeof(float4x4) * m_RenderFrame.NumInstances;
+
+    // A version that has been uploaded already carries nothing new. Otherwise every
+    // range of it is uploaded below, so Update can stop resending them.
+    const InstanceExchange::Version* pVersion = m_pRenderInstances;
+    if (pVersion == nullptr || pVersion->Epoch == m_InstanceEpochUploaded.load(std::memory_order_relaxed))
+        return;
+    const InstanceFrame& Frame = pVersion->Value;
+    m_InstanceEpochUploaded.store(pVersion->Epoch, std::memory_order_release);
+
+    // Small ranges go through UpdateBuffer, which copies through the driver's
+    // upload heap. Large ones are written straight into a staging buffer and
+    // copied on the GPU, saving the extra CPU-side copy. Frame.Worlds holds the
+    // ranges back to back; Packed is where the current one starts.
+    struct StagedRange
+    {
+        Uint32 FirstInstance;
+        Uint32 NumInstances;
+        Uint32 Packed;
+    };
+    ArenaArray<StagedRange> StagedRanges{GetFrameArena()};
+    Uint32                  Packed = 0;
+    for (const InstanceRange& Range : Frame.DirtyRanges)
+    {
+        const Uint32 First = Range.FirstInstance;
+        const Uint64 Size  = sizeof(float4x4) * Range.NumInstances;
+        if (Size < kStagedUploadThreshold)
+        {
+            m_pImmediateContext->UpdateBuffer(m_InstanceBuffer, sizeof(float4x4) * First, Size,
+                                              &Frame.Worlds[Packed], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            m_UploadStats.UpdateBufferBytes += Size;
+            ++m_UploadStats.NumUpdateBufferCalls;
+        }
+        else
+        {
+            StagedRanges.push_back({First, Range.NumInstances, Packed});
+        }
+        Packed += Range.NumInstances;
+    }
+
+    if (StagedRanges.empty())
+        return;
+
+    // BeginFrame has waited for the frame that last used this slot's staging buffer
+    IBuffer* pStaging = m_InstanceStaging[m_FrameSlot];
+
+    // Ranges keep their offsets in the staging buffer, so one map covers all of them
+    {
+        MapHelper<float4x4> Staging(m_pImmediateContext, pStaging, MAP_WRITE, MAP_FLAG_NONE);
+        float4x4*           pDst = Staging;
+        for (const StagedRange& Range : StagedRanges)
+            std::copy_n(&Frame.Worlds[Range.Packed], Range.NumInstances, pDst + Range.FirstInstance);
+    }
+    for (const StagedRange& Range : StagedRanges)
+    {
+        const Uint64 Offset = sizeof(float4x4) * Range.FirstInstance;
+        const Uint64 Size   = sizeof(float4x4) * Range.NumInstances;
+        m_pImmediateContext->CopyBuffer(pStaging, Offset, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                        m_InstanceBuffer, Offset, Size, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_UploadStats.StagedBytes += Size;
+        ++m_UploadStats.NumStagedCopies;
+    }
+}
+
+void Tutorial03_Texturing::UpdateSimThread()
+{
+    ALLOCATION_SCOPE("UpdateSimThread");
+
+    // 1) (Re)start the thread with a copy of the current spawn data whenever the swarm
+    //    or the tick rate changed
+    if (!m_SimThread.IsRunning() || m_SimThreadVersion != m_SwarmVersion || m_SimThread.GetTickRate() != static_cast<float>(m_SimTickRate))
+    {
+        m_SimThread.Start(m_InstanceCenters, m_InstancePhases, GetOrbitParams(), m_PathTime, static_cast<float>(m_SimTickRate));
+        m_SimThreadVersion = m_SwarmVersion;
+    }
+
+    // 2) Slider changes reach the simulation from its next tick
+    m_SimThread.SetParams(GetOrbitParams());
+
+    // 3) Until the first snapshot arrives, evaluate the frame here
+    float SimTime = 0;
+    if (!m_SimThread.Interpolate(m_InstanceWorlds, SimTime))
+    {
+        GenerateInstanceData(m_PathTime);
+        return;
+    }
+    m_InstanceDirty.MarkAllDirty();
+    m_NumInstancesUpdated = m_InstanceCount;
+}
+
+void Tutorial03_Texturing::UpdatePlayback(float ElapsedTime)
+{
+    ALLOCATION_SCOPE("UpdatePlayback");
+
+    // The instance count follows the file, whatever the UI requested
+    const Uint32 NumInstances = m_Trajectory.GetHeader().NumInstances;
+    if (m_InstanceCount != NumInstances)
+        ResizeSwarm(NumInstances);
+
+    // Take the decoded frame if it is ready; otherwise keep drawing the previous one
+    m_PlaybackTime += ElapsedTime;
+    const Uint32 Frame = m_Trajectory.GetFrameAt(m_PlaybackTime);
+    if (m_Trajectory.FetchFrame(Frame, m_InstanceWorlds))
+    {
+        m_PlaybackFrame = Frame;
+        m_InstanceDirty.MarkAllDirty();
+    }
+    else if (Frame != m_PlaybackFrame)
+    {
+        ++m_PlaybackLateFrames;
+    }
+}
+
+void Tutorial03_Texturing::StartTrajectoryRecording(float Seconds)
+{
+    if (m_PendingRecord.valid())
+        return;
+
+    // The CPU orbits are a closed-form function of time, so the worker only needs a copy
+    // of the spawn data and never touches the live swarm
+    m_RecordNumFrames = static_cast<Uint32>(Seconds * kRecordFrameRate);
+    m_RecordProgress.store(0);
+    m_StopRecord.store(false);
+    m_PendingRecord = std::async(std::launch::async,
+                                 [this, Path = m_TrajectoryPath, Centers = m_InstanceCenters, Phases = m_InstancePhases,
+                                  Params = GetOrbitParams(), StartTime = m_PathTime, NumFrames = m_RecordNumFrames]() {
+                                     return RecordTrajectory(Path.c_str(), Centers, Phases, Params, StartTime, NumFrames);
+                                 });
+}
+
+bool Tutorial03_Texturing::RecordTrajectory(const char* Path, const std::vector<float3>& Centers, const std::vector<float>& Phases,
+                                            const OrbitParams& Params, float StartTime, Uint32 NumFrames)
+{
+    // Worker thread: reads nothing but its arguments and reports through m_RecordProgress
+    const Uint32 NumInstances = static_cast<Uint32>(Centers.size());
+    const float  Margin       = Params.Radius + Params.BobAmp;
+
+    float3 BoundsMin{-Margin, -Margin, -Margin};
+    float3 BoundsMax{Margin, Margin, Margin};
+    if (!Centers.empty())
+    {
+        BoundsMin = BoundsMax = Centers[0];
+        for (const float3& C : Centers)
+        {
+            BoundsMin = std::min(BoundsMin, C);
+            BoundsMax = std::max(BoundsMax, C);
+        }
+        BoundsMin -= float3{Margin, Margin, Margin};
+        BoundsMax += float3{Margin, Margin, Margin};
+    }
+
+    SwarmTrajectoryWriter Writer;
+    if (!Writer.Begin(Path, NumInstances, kRecordFrameRate, BoundsMin, BoundsMax))
+        return false;
+
+    std::vector<float4> PosYaw(NumInstances);
+    for (Uint32 f = 0; f < NumFrames; ++f)
+    {
+        if (m_StopRecord.load())
+        {
+            LOG_WARNING_MESSAGE("Trajectory recording to ", Path, " was cancelled after ", f, " frames");
+            return false;
+        }
+
+        const float Time      = StartTime + f / kRecordFrameRate;
+        const float BobOffset = ComputeBobOffset(Time, Params);
+        for (Uint32 i = 0; i < NumInstances; ++i)
+        {
+            // Forward is the negated third basis vector, see MakeYawWorld
+            const float4x4 World = EvaluateOrbit(Centers[i], Phases[i], Time, BobOffset, Params);
+            PosYaw[i]            = float4{World._41, World._42, World._43, std::atan2(-World._13, -World._33)};
+        }
+        if (!Writer.AddFrame(PosYaw.data()))
+            return false;
+        m_RecordProgress.store(f + 1);
+    }
+    if (!Writer.Finish())
+        return false;
+
+    LOG_INFO_MESSAGE("Recorded ", NumFrames, " frames of ", NumInstances, " instances to ", Path);
+    return true;
+}
+
+void Tutorial03_Texturing::DrawButterflies(bool MultiView, bool Sorted, ITextureView* pRTV)
+{
+    ALLOCATION_SCOPE("DrawButterflies");
+
+    // Compute common wing flap angle for all butterflies this frame
+    const float wingAng = std::sin(m_RenderFrame.PathTime * 2.f * PI_F * m_RenderFrame.WingFactor) * m_RenderFrame.WingAmp;
+
+    // 1) Map the VS constant buffer (discard old), write per-frame constants.
+    //    Per-instance transforms come from m_InstanceBuffer, or are evaluated
+    //    in the VS from m_InstanceParamsBuffer and the motion constants below.
+    auto WriteConstants = [&](const float4x4& ViewProj) {
+        MapHelper<VSConstants> CB(m_pImmediateContext, m_VSConstants,
+                                  MAP_WRITE, MAP_FLAG_DISCARD);
+        CB->ViewProj   = ViewProj;
+        CB->WingAngle  = wingAng; // common flap angle
+        CB->Time       = m_RenderFrame.PathTime;
+        CB->Radius     = m_RenderFrame.Orbit.Radius;
+        CB->Speed      = m_RenderFrame.Orbit.Speed;
+        CB->BobAmp     = m_RenderFrame.Orbit.BobAmp;
+        CB->BobFreq    = m_RenderFrame.Orbit.BobFreq;
+        CB->WingFactor = m_RenderFrame.WingFactor;
+        CB->WingAmp    = m_RenderFrame.WingAmp;
+        CB->WingSinCos = float2{std::sin(wingAng), std::cos(wingAng)};
+        CB->NumSpecies = m_RenderFrame.NumSpecies;
+    };
+    WriteConstants(m_RenderFrame.ViewProj);
+
+    DrawIndexedAttribs Attribs;
+    Attribs.IndexType  = VT_UINT32;
+    Attribs.NumIndices = Butterfly::ButterflyIndexCount;
+    Attribs.Flags      = DRAW_FLAG_VERIFY_ALL;
+
+    // Draws the instance ranges of the clusters visible in Slot. Sorted draws read the
+    // instances in depth order, which does not follow the clusters, so they draw everything.
+    const InstanceFrame* pFrame = m_pRenderInstances != nullptr ? &m_pRenderInstances->Value : nullptr;
+    const bool           Cull   = m_CullDraws && pFrame != nullptr && pFrame->DrawRangesValid && !Sorted;
+    const Uint32         Count  = m_RenderFrame.NumInstances;
+    m_ViewDrawStats.fill({});
+    auto DrawInstances = [&](Uint32 Slot) {
+        InstanceDrawStats& Stats = m_ViewDrawStats[Slot];
+        if (!Cull)
+        {
+            Attribs.FirstInstanceLocation = 0;
+            Attribs.NumInstances          = Count;
+            m_pImmediateContext->DrawIndexed(Attribs);
+            Stats = {Count, 1};
+            return;
+        }
+        for (const InstanceRange& Range : pFrame->DrawRanges[Slot])
+        {
+            Attribs.FirstInstanceLocation = Range.FirstInstance;
+            Attribs.NumInstances          = Range.NumInstances;
+            m_pImmediateContext->DrawIndexed(Attribs);
+            Stats.NumInstances += Range.NumInstances;
+            ++Stats.NumDraws;
+        }
+    };
+
+    const Uint32 NumViews = m_RenderFrame.NumViews;
+    Viewport     Viewports[kMaxViews];
+    for (Uint32 View = 0; View < NumViews; ++View)
+        Viewports[View] = GetViewport(View, pRTV);
+
+    // 2a) MULTI_VIEW pipeline: instanced calls for the clusters any view sees draw every
+    //     view. The VS runs once per vertex and the GS projects each triangle into every viewport.
+    if (MultiView)
+    {
+        {
+            MapHelper<MultiViewConstants> CB(m_pImmediateContext, m_MultiViewCB, MAP_WRITE, MAP_FLAG_DISCARD);
+            for (Uint32 View = 0; View < NumViews; ++View)
+                CB->ViewProj[View] = m_RenderFrame.Views[View].ViewProj;
+            CB->NumViews = NumViews;
+        }
+        m_pImmediateContext->SetViewports(NumViews, Viewports, 0, 0);
+        DrawInstances(kMaxViews);
+        return;
+    }
+
+    // 2b) Otherwise instanced calls per view for the clusters that view sees
+    for (Uint32 View = 0; View < NumViews; ++View)
+    {
+        if (View > 0)
+            WriteConstants(m_RenderFrame.Views[View].ViewProj);
+        m_pImmediateContext->SetViewports(1, &Viewports[View], 0, 0);
+        DrawInstances(View);
+    }
+}
+
+Viewport Tutorial03_Texturing::GetViewport(Uint32 View, ITextureView* pRTV) const
+{
+    // Edges are snapped to whole pixels so that neighbouring views neither overlap nor leave gaps
+    const TextureDesc& Desc = pRTV->GetTexture()->GetDesc();
+    const float4&      Rect = m_RenderFrame.Views[View].Rect;
+    const float        W    = static_cast<float>(Desc.Width);
+    const float        H    = static_cast<float>(Desc.Height);
+    const float        X0   = std::floor(Rect.x * W);
+    const float        Y0   = std::floor(Rect.y * H);
+    const float        X1   = std::floor((Rect.x + Rect.z) * W);
+    const float        Y1   = std::floor((Rect.y + Rect.w) * H);
+    return Viewport{X0, Y0, X1 - X0, Y1 - Y0};
+}
+
+IShaderResourceBinding* Tutorial03_Texturing::GetMultiViewSRB(IPipelineState* pPSO, bool Analytic, bool Sorted)
+{
+    // The geometry shader makes MULTI_VIEW pipelines incompatible with the regular SRBs,
+    // so they have their own. Instance buffers are recreated when the swarm grows, so
+    // the bindings are refreshed on every use; unchanged ones are skipped.
+    auto& pSRB = m_MultiViewSRBs[Analytic ? 1 : (Sorted ? 2 : 0)];
+    if (!pSRB)
+        pPSO->CreateShaderResourceBinding(&pSRB, true);
+
+    auto Bind = [&](SHADER_TYPE Stage, const char* Name, IDeviceObject* pObject) {
+        IShaderResourceVariable* pVar = pSRB->GetVariableByName(Stage, Name);
+        if (pVar != nullptr && pVar->Get() != pObject)
+            pVar->Set(pObject, SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+    };
+    Bind(SHADER_TYPE_PIXEL, "g_Texture", m_TextureSRV);
+    if (Analytic)
+    {
+        Bind(SHADER_TYPE_VERTEX, "g_InstanceParams", m_InstanceParamsBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    }
+    else
+    {
+        Bind(SHADER_TYPE_VERTEX, "g_Instances", m_InstanceBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+        if (Sorted)
+            Bind(SHADER_TYPE_VERTEX, "g_InstanceOrder", m_InstanceOrder->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    }
+    return pSRB;
+}
+
+void Tutorial03_Texturing::BakeWingVAT()
+{
+    // One row per frame and one texel per vertex, so the VS addresses it with
+    // (SV_VertexID, frame) and never needs a sampler
+    m_WingVATDesc.NumFrames = kWingVATFrames;
+    m_WingVATDesc.FlapAmp   = m_Swarm.WingAmp;
+
+    std::vector<float4> Offsets;
+    WingAnimation::Bake(m_WingVATDesc, Offsets);
+
+    TextureSubResData SubresData{Offsets.data(), Uint64{Butterfly::ButterflyVertexCount} * sizeof(float4)};
+    if (!m_WingVATTex)
+    {
+        TextureDesc TexDesc;
+        TexDesc.Name      = "Wing vertex animation";
+        TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+        TexDesc.Width     = Butterfly::ButterflyVertexCount;
+        TexDesc.Height    = kWingVATFrames;
+        TexDesc.Format    = TEX_FORMAT_RGBA32_FLOAT;
+        TexDesc.Usage     = USAGE_DEFAULT;
+        TexDesc.BindFlags = BIND_SHADER_RESOURCE;
+
+        TextureData InitData{&SubresData, 1};
+        m_pDevice->CreateTexture(TexDesc, &InitData, &m_WingVATTex);
+        return;
+    }
+
+    Box FullBox;
+    FullBox.MaxX = Butterfly::ButterflyVertexCount;
+    FullBox.MaxY = kWingVATFrames;
+    m_pImmediateContext->UpdateTexture(m_WingVATTex, 0, 0, FullBox, SubresData,
+                                       RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                       RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+void Tutorial03_Texturing::RunWingVSBenchmark()
+{
+    // 1) Two back-buffer permutations that differ only in BRANCHLESS_WING. The pixel
+    //    work is kept negligible by the tiny target, so the timings compare vertex shading.
+    using Cache                  = ShaderPermutationCache;
+    const PermutationKey BaseKey = GetButterflyKey(RENDER_TARGET_BACK_BUFFER, false, false, false, false) &
+        ~(Cache::Encode(BUTTERFLY_PERM_WING_VAT, 1) | Cache::Encode(BUTTERFLY_PERM_BRANCHLESS_WING, 1));
+    std::array<IPipelineState*, 2> PSOs = {}; // [BRANCHLESS_WING]
+    for (Uint32 Branchless = 0; Branchless < 2; ++Branchless)
+    {
+        PSOs[Branchless] = m_ButterflyPermutations->Get(BaseKey | Cache::Encode(BUTTERFLY_PERM_BRANCHLESS_WING, Branchless));
+        if (PSOs[Branchless] == nullptr)
+            return;
+    }
+
+    const TEXTURE_FORMAT ColorFormat = GetTargetFormat(RENDER_TARGET_BACK_BUFFER);
+    const TEXTURE_FORMAT DepthFormat = m_pSwapChain->GetDesc().DepthBufferFormat;
+
+    // 2) A dedicated swarm so that the result does not depend on the current instance count.
+    //    Butterflies are spread over a grid in front of the camera; where they land on
+    //    screen barely matters since every vertex is shaded either way.
+    std::vector<float4x4> Worlds(kWingBenchInstances);
+    for (Uint32 i = 0; i < kWingBenchInstances; ++i)
+        Worlds[i] = float4x4::Translation(static_cast<float>(i % 128) * 0.2f - 12.8f, static_cast<float>((i / 128) % 128) * 0.2f - 12.8f, static_cast<float>(i / (128 * 128)));
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name              = "Wing benchmark instances";
+    BuffDesc.Usage             = USAGE_IMMUTABLE;
+    BuffDesc.BindFlags         = BIND_SHADER_RESOURCE;
+    BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+    BuffDesc.ElementByteStride = sizeof(float4x4);
+    BuffDesc.Size              = sizeof(float4x4) * kWingBenchInstances;
+
+    RefCntAutoPtr<IBuffer> pInstances;
+    RefCntAutoPtr<IBuffer> pIndices = CreateInstanceIndexBuffer(m_pDevice, "Wing benchmark instance indices", kWingBenchInstances);
+    BufferData             InstData{Worlds.data(), BuffDesc.Size};
+    m_pDevice->CreateBuffer(BuffDesc, &InstData, &pInstances);
+
+    RefCntAutoPtr<IShaderResourceBinding> pSRB;
+    PSOs[0]->CreateShaderResourceBinding(&pSRB, true);
+    pSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV);
+    pSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_Instances")->Set(pInstances->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+
+    TextureDesc TexDesc;
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = kWingBenchSize;
+    TexDesc.Height    = kWingBenchSize;
+    TexDesc.Name      = "Wing benchmark color";
+    TexDesc.Format    = ColorFormat;
+    TexDesc.BindFlags = BIND_RENDER_TARGET;
+    RefCntAutoPtr<ITexture> pColor, pDepth;
+    m_pDevice->CreateTexture(TexDesc, nullptr, &pColor);
+    TexDesc.Name      = "Wing benchmark depth";
+    TexDesc.Format    = DepthFormat;
+    TexDesc.BindFlags = BIND_DEPTH_STENCIL;
+    m_pDevice->CreateTexture(TexDesc, nullptr, &pDepth);
+
+    RefCntAutoPtr<IQuery> pDuration;
+    if (m_pDevice->GetDeviceInfo().Features.DurationQueries)
+    {
+        QueryDesc Desc;
+        Desc.Name = "Wing benchmark duration";
+        Desc.Type = QUERY_TYPE_DURATION;
+        m_pDevice->CreateQuery(Desc, &pDuration);
+    }
+
+    // 3) Time kWingBenchIters draws of each variant. The flap angle is mid-stroke so
+    //    that both paths do the full rotation.
+    {
+        const float WingAngle = 0.5f * m_Swarm.WingAmp;
+
+        MapHelper<VSConstants> CB(m_pImmediateContext, m_VSConstants, MAP_WRITE, MAP_FLAG_DISCARD);
+        CB->ViewProj   = float4x4::Translation(0.0f, 0.0f, 30.0f) * m_Camera.GetProjMatrix();
+        CB->WingAngle  = WingAngle;
+        CB->WingSinCos = float2{std::sin(WingAngle), std::cos(WingAngle)};
+        CB->NumSpecies = 1;
+    }
+
+    ITextureView*         pRTV         = pColor->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+    ITextureView*         pDSV         = pDepth->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL);
+    IBuffer*              pVBs[]       = {m_ButterflyVertexBuffer, pIndices};
+    const float           ClearColor[] = {0.0f, 0.0f, 0.0f, 0.0f};
+    std::array<double, 2> Ms           = {};
+    for (Uint32 Branchless = 0; Branchless < 2; ++Branchless)
+    {
+        m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->ClearRenderTarget(pRTV, ClearColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->ClearDepthStencil(pDSV, CLEAR_DEPTH_FLAG, 1.0f, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->SetVertexBuffers(0, _countof(pVBs), pVBs, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION, SET_VERTEX_BUFFERS_FLAG_RESET);
+        m_pImmediateContext->SetIndexBuffer(m_ButterflyIndexBuffer, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->SetPipelineState(PSOs[Branchless]);
+        m_pImmediateContext->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+        DrawIndexedAttribs Attribs;
+        Attribs.IndexType    = VT_UINT32;
+        Attribs.NumIndices   = Butterfly::ButterflyIndexCount;
+        Attribs.NumInstances = kWingBenchInstances;
+        Attribs.Flags        = DRAW_FLAG_VERIFY_ALL;
+
+        // Warm-up draw so that pipeline creation on first use is not timed
+        m_pImmediateContext->DrawIndexed(Attribs);
+        m_pImmediateContext->WaitForIdle();
+
+        const auto Start = std::chrono::high_resolution_clock::now();
+        if (pDuration)
+            m_pImmediateContext->BeginQuery(pDuration);
+        for (Uint32 Iter = 0; Iter < kWingBenchIters; ++Iter)
+            m_pImmediateContext->DrawIndexed(Attribs);
+        if (pDuration)
+            m_pImmediateContext->EndQuery(pDuration);
+        m_pImmediateContext->WaitForIdle();
+
+        QueryDataDuration Duration;
+        if (pDuration && pDuration->GetData(&Duration, sizeof(Duration), true) && Duration.Frequency > 0)
+            Ms[Branchless] = 1000.0 * Duration.Duration / Duration.Frequency / kWingBenchIters;
+        else // wall-clock fallback, includes submission
+            Ms[Branchless] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count() / kWingBenchIters;
+    }
+
+    m_WingBenchResult.BranchMs     = Ms[0];
+    m_WingBenchResult.BranchlessMs = Ms[1];
+    LOG_INFO_MESSAGE("Wing VS benchmark, ", kWingBenchInstances, " instances x ", Butterfly::ButterflyVertexCount, " vertices at ",
+                     kWingBenchSize, "x", kWingBenchSize, ": branch + sin/cos ", Ms[0], " ms, branch-free ", Ms[1], " ms");
+}
+
+void Tutorial03_Texturing::CreateFlockingPipelines()
+{
+    // Every stage of the simulation is a separate entry point in Flocking.csh
+    static constexpr const char* EntryPoints[FLOCK_PASS_COUNT] =
+        {
+            "ClearCells",
+            "BinAgents",
+            "ScanBlocks",
+            "ScanBlockSums",
+            "AddBlockOffsets",
+            "ScatterAgents",
+            "Integrate",
+        };
+
+    BufferDesc CBDesc;
+    CBDesc.Name           = "Flocking constants";
+    CBDesc.Size           = sizeof(FlockConstants);
+    CBDesc.Usage          = USAGE_DYNAMIC;
+    CBDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_FlockCB);
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage                  = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+    ShaderCI.CompileFlags                    = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR; // same layout as cube.vsh
+    ShaderCI.FilePath                        = "Flocking.csh";
+
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(m_ShaderSearchPath.c_str(), &pShaderSourceFactory);
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    for (Uint32 Pass = 0; Pass < FLOCK_PASS_COUNT; ++Pass)
+    {
+        RefCntAutoPtr<IShader> pCS;
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.Desc.Name       = EntryPoints[Pass];
+        ShaderCI.EntryPoint      = EntryPoints[Pass];
+        m_pDevice->CreateShader(ShaderCI, &pCS);
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name         = EntryPoints[Pass];
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.pCS                  = pCS;
+
+        // All buffers are mutable so that they can be recreated when the swarm is resized
+        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+
+        ShaderResourceVariableDesc Vars[] =
+            {
+                {SHADER_TYPE_COMPUTE, "FlockConstants", SHADER_RESOURCE_VARIABLE_TYPE_STATIC}};
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_FlockPSOs[Pass]);
+        m_FlockPSOs[Pass]->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "FlockConstants")->Set(m_FlockCB);
+    }
+
+    // Grid covering the spawn volume plus orbit radius with generous margin.
+    // Agents outside are clamped into the border cells.
+    const float NeighborRadius = 2.0f;
+
+    m_FlockConsts.CellSize         = NeighborRadius;
+    m_FlockConsts.GridDimX         = 64;
+    m_FlockConsts.GridDimY         = 32;
+    m_FlockConsts.GridDimZ         = 64;
+    m_FlockConsts.GridOrigin       = float3{-32.f, -16.f, -32.f} * m_FlockConsts.CellSize;
+    m_FlockConsts.NeighborRadius   = NeighborRadius;
+    m_FlockConsts.SeparationWeight = 1.5f;
+    m_FlockConsts.AlignmentWeight  = 1.0f;
+    m_FlockConsts.CohesionWeight   = 0.6f;
+    m_FlockConsts.HomeWeight       = 0.05f;
+    m_FlockConsts.MinSpeed         = 1.5f;
+    m_FlockConsts.MaxSpeed         = 6.0f;
+
+    VERIFY(m_FlockConsts.GridDimX * m_FlockConsts.GridDimY * m_FlockConsts.GridDimZ <= kScanBlockSize * kScanBlockSize,
+           "Two-level scan in Flocking.csh cannot handle this many cells");
+}
+
+void Tutorial03_Texturing::CreateFlockingBuffers(Uint32 NumToPreserve)
+{
+    const Uint32 NumAgents = std::max(m_InstanceCapacity, 1u);
+    const Uint32 NumCells  = m_FlockConsts.GridDimX * m_FlockConsts.GridDimY * m_FlockConsts.GridDimZ;
+    const Uint32 NumBlocks = (NumCells + kScanBlockSize - 1) / kScanBlockSize;
+
+    auto CreateRWBuffer = [&](const char* Name, Uint32 Stride, Uint32 Count, RefCntAutoPtr<IBuffer>& pBuffer) {
+        BufferDesc Desc;
+        Desc.Name              = Name;
+        Desc.Usage             = USAGE_DEFAULT;
+        Desc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+        Desc.Mode              = BUFFER_MODE_STRUCTURED;
+        Desc.ElementByteStride = Stride;
+        Desc.Size              = Uint64{Stride} * Count;
+        pBuffer.Release();
+        m_pDevice->CreateBuffer(Desc, nullptr, &pBuffer);
+    };
+    RefCntAutoPtr<IBuffer> pOldAgents{m_FlockAgents};
+    CreateRWBuffer("Flock agents", sizeof(FlockAgent), NumAgents, m_FlockAgents);
+    if (pOldAgents && NumToPreserve > 0)
+    {
+        // Keep the simulated state of existing agents when the swarm grows
+        m_pImmediateContext->CopyBuffer(pOldAgents, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                        m_FlockAgents, 0, sizeof(FlockAgent) * NumToPreserve,
+                                        RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+
+    CreateRWBuffer("Flock sorted agents", sizeof(FlockAgent), NumAgents, m_FlockSortedAgents);
+    CreateRWBuffer("Flock agent cell", sizeof(Uint32) * 2, NumAgents, m_FlockAgentCell);
+    CreateRWBuffer("Flock cell counts", sizeof(Uint32), NumCells, m_FlockCellCounts);
+    CreateRWBuffer("Flock cell start", sizeof(Uint32), NumCells, m_FlockCellStart);
+    CreateRWBuffer("Flock block sums", sizeof(Uint32), NumBlocks, m_FlockBlockSums);
+
+    BufferDesc ReadbackDesc;
+    ReadbackDesc.Name           = "Flock agents readback";
+    ReadbackDesc.Usage          = USAGE_STAGING;
+    ReadbackDesc.CPUAccessFlags = CPU_ACCESS_READ;
+    ReadbackDesc.Size           = sizeof(FlockAgent) * NumAgents;
+    m_FlockReadback.Release();
+    m_pDevice->CreateBuffer(ReadbackDesc, nullptr, &m_FlockReadback);
+
+    // Every pass only declares the buffers it touches
+    const std::pair<const char*, IBuffer*> Bindings[] =
+        {
+            {"g_Agents", m_FlockAgents},
+            {"g_SortedAgents", m_FlockSortedAgents},
+            {"g_AgentCell", m_FlockAgentCell},
+            {"g_CellCounts", m_FlockCellCounts},
+            {"g_CellStart", m_FlockCellStart},
+            {"g_BlockSums", m_FlockBlockSums},
+            {"g_Instances", m_InstanceBuffer},
+        };
+    for (Uint32 Pass = 0; Pass < FLOCK_PASS_COUNT; ++Pass)
+    {
+        m_FlockSRBs[Pass].Release();
+        m_FlockPSOs[Pass]->CreateShaderResourceBinding(&m_FlockSRBs[Pass], true);
+        for (const auto& Binding : Bindings)
+        {
+            if (IShaderResourceVariable* pVar = m_FlockSRBs[Pass]->GetVariableByName(SHADER_TYPE_COMPUTE, Binding.first))
+                pVar->Set(Binding.second->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+        }
+    }
+}
+
+void Tutorial03_Texturing::InitFlockingAgents(Uint32 FirstAgent)
+{
+    // Start every agent on its orbit so that switching modes is seamless
+    m_FlockCPUAgents.resize(m_InstanceCount);
+    for (Uint32 i = FirstAgent; i < m_InstanceCount; ++i)
+    {
+        const float3& C     = m_InstanceCenters[i];
+        const float   theta = m_InstancePhases[i];
+
+        FlockAgent& Agent = m_FlockCPUAgents[i];
+        Agent.Pos         = float4{C.x + m_Swarm.Radius * std::cos(theta), C.y, C.z + m_Swarm.Radius * std::sin(theta), 1.0f};
+        Agent.Vel         = float4{-std::sin(theta), 0.0f, std::cos(theta), 0.0f} * (m_Swarm.Radius * m_Swarm.Speed);
+        Agent.Home        = float4{C, 0.0f};
+    }
+
+    if (FirstAgent < m_InstanceCount)
+    {
+        m_pImmediateContext->UpdateBuffer(m_FlockAgents, sizeof(FlockAgent) * FirstAgent, sizeof(FlockAgent) * (m_InstanceCount - FirstAgent),
+                                          &m_FlockCPUAgents[FirstAgent], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+}
+
+void Tutorial03_Texturing::DispatchFlocking(float DeltaTime)
+{
+    ALLOCATION_SCOPE("DispatchFlocking");
+
+    const Uint32 NumAgents = m_RenderFrame.NumInstances;
+    if (NumAgents == 0)
+        return;
+
+    // Clamp the step to keep the integration stable after hitches
+    m_FlockConsts.DeltaTime = std::min(DeltaTime, 1.0f / 30.0f);
+    m_FlockConsts.NumAgents = NumAgents;
+    {
+        MapHelper<FlockConstants> CB(m_pImmediateContext, m_FlockCB, MAP_WRITE, MAP_FLAG_DISCARD);
+        *CB = m_FlockConsts;
+    }
+
+    // In compare mode the GPU restarts from the CPU reference state every frame,
+    // so that only a single step is compared and chaotic divergence does not accumulate.
+    if (m_FlockCompare)
+    {
+        m_pImmediateContext->UpdateBuffer(m_FlockAgents, 0, sizeof(FlockAgent) * m_FlockCPUAgents.size(),
+                                          m_FlockCPUAgents.data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+
+    auto Dispatch = [&](FLOCK_PASS Pass, Uint32 GroupsX, Uint32 GroupsY = 1, Uint32 GroupsZ = 1) {
+        m_pImmediateContext->SetPipelineState(m_FlockPSOs[Pass]);
+        m_pImmediateContext->CommitShaderResources(m_FlockSRBs[Pass], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->DispatchCompute(DispatchComputeAttribs{GroupsX, GroupsY, GroupsZ});
+    };
+
+    const Uint32 NumCells       = m_FlockConsts.GridDimX * m_FlockConsts.GridDimY * m_FlockConsts.GridDimZ;
+    const Uint32 NumAgentGroups = (NumAgents + kFlockGroupSize - 1) / kFlockGroupSize;
+    const Uint32 NumCellGroups  = (NumCells + kScanGroupSize - 1) / kScanGroupSize;
+    const Uint32 NumScanBlocks  = (NumCells + kScanBlockSize - 1) / kScanBlockSize;
+
+    Dispatch(FLOCK_PASS_CLEAR_CELLS, NumCellGroups);
+    Dispatch(FLOCK_PASS_BIN_AGENTS, NumAgentGroups);
+    Dispatch(FLOCK_PASS_SCAN_BLOCKS, NumScanBlocks);
+    Dispatch(FLOCK_PASS_SCAN_BLOCK_SUMS, 1);
+    Dispatch(FLOCK_PASS_ADD_BLOCK_OFFSETS, NumCellGroups);
+    Dispatch(FLOCK_PASS_SCATTER_AGENTS, NumAgentGroups);
+    // One group per grid cell; empty cells exit immediately
+    Dispatch(FLOCK_PASS_INTEGRATE, m_FlockConsts.GridDimX, m_FlockConsts.GridDimY, m_FlockConsts.GridDimZ);
+
+    if (m_FlockCompare)
+        CompareFlockingWithReference();
+}
+
+void Tutorial03_Texturing::CompareFlockingWithReference()
+{
+    const Uint64 DataSize = sizeof(FlockAgent) * m_FlockCPUAgents.size();
+
+    // Read back the GPU result. Compare mode is a debugging aid, so a full stall is fine.
+    m_pImmediateContext->CopyBuffer(m_FlockAgents, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                    m_FlockReadback, 0, DataSize, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->WaitForIdle();
+
+    // Advance the CPU reference from the same starting state
+    m_FlockReference.Step(m_FlockCPUAgents, m_FlockConsts);
+
+    MapHelper<FlockAgent> Mapped(m_pImmediateContext, m_FlockReadback, MAP_READ, MAP_FLAG_NONE);
+    const FlockAgent*     pGPUAgents = Mapped;
+
+    m_FlockMaxPosError = 0;
+    m_FlockMaxVelError = 0;
+    for (size_t i = 0; i < m_FlockCPUAgents.size(); ++i)
+    {
+        m_FlockMaxPosError = std::max(m_FlockMaxPosError, length(pGPUAgents[i].Pos - m_FlockCPUAgents[i].Pos));
+        m_FlockMaxVelError = std::max(m_FlockMaxVelError, length(pGPUAgents[i].Vel - m_FlockCPUAgents[i].Vel));
+    }
+
+    if (m_FlockMaxPosError > kFlockCompareTol || m_FlockMaxVelError > kFlockCompareTol)
+    {
+        LOG_WARNING_MESSAGE("GPU flocking diverges from the CPU reference: max position error ", m_FlockMaxPosError,
+                            ", max velocity error ", m_FlockMaxVelError);
+    }
+}
+
+void Tutorial03_Texturing::CreateInstanceSort()
+{
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(m_ShaderSearchPath.c_str(), &pShaderSourceFactory);
+    m_RadixSort.reset(new GPURadixSort{m_pDevice, pShaderSourceFactory});
+
+    BufferDesc CBDesc;
+    CBDesc.Name           = "Sort key constants";
+    CBDesc.Size           = sizeof(SortKeyConstants);
+    CBDesc.Usage          = USAGE_DYNAMIC;
+    CBDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_SortKeyCB);
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage             = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.CompileFlags               = SHADER_COMPILE_FLAG_PACK_MATRIX_ROW_MAJOR; // same layout as cube.vsh
+    ShaderCI.FilePath                   = "SortKeys.csh";
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    RefCntAutoPtr<IShader> pCS;
+    ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+    ShaderCI.Desc.Name       = "BuildSortKeys";
+    ShaderCI.EntryPoint      = "BuildSortKeys";
+    m_pDevice->CreateShader(ShaderCI, &pCS);
+
+    ComputePipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.Name         = "BuildSortKeys";
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+    PSOCreateInfo.pCS                  = pCS;
+
+    // The instance and key buffers are recreated when the swarm grows
+    PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+
+    ShaderResourceVariableDesc Vars[] =
+        {
+            {SHADER_TYPE_COMPUTE, "SortKeyConstants", SHADER_RESOURCE_VARIABLE_TYPE_STATIC}};
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_SortKeyPSO);
+    m_SortKeyPSO->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "SortKeyConstants")->Set(m_SortKeyCB);
+}
+
+void Tutorial03_Texturing::CreateInstanceSortBuffers()
+{
+    if (!m_RadixSort)
+        return;
+
+    // Larger swarms are drawn unsorted, see CanSortInstances()
+    const Uint32 SortCapacity = std::min(std::max(m_InstanceCapacity, 1u), GPURadixSort::kMaxKeys);
+
+    BufferDesc Desc;
+    Desc.Usage             = USAGE_DEFAULT;
+    Desc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+    Desc.Mode              = BUFFER_MODE_STRUCTURED;
+    Desc.ElementByteStride = sizeof(Uint32);
+    Desc.Size              = sizeof(Uint32) * SortCapacity;
+
+    Desc.Name = "Instance sort keys";
+    m_SortKeys.Release();
+    m_pDevice->CreateBuffer(Desc, nullptr, &m_SortKeys);
+
+    Desc.Name = "Instance order";
+    m_InstanceOrder.Release();
+    m_pDevice->CreateBuffer(Desc, nullptr, &m_InstanceOrder);
+
+    // Allocate the scratch buffers now rather than on the first sorted frame
+    m_RadixSort->Reserve(SortCapacity);
+
+    m_SortKeySRB.Release();
+    m_SortKeyPSO->CreateShaderResourceBinding(&m_SortKeySRB, true);
+    m_SortKeySRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Instances")->Set(m_InstanceBuffer->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE));
+    m_SortKeySRB->GetVariableByName(SHADER_TYPE_COMPUTE, "g_SortKeys")->Set(m_SortKeys->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+
+    m_SortedSRB->GetVariableByName(SHADER_TYPE_VERTEX, "g_InstanceOrder")->Set(m_InstanceOrder->GetDefaultView(BUFFER_VIEW_SHADER_RESOURCE), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+}
+
+bool Tutorial03_Texturing::CanSortInstances(Uint32 NumInstances) const
+{
+    // The two-level scan of GPURadixSort has a fixed key limit
+    return m_RadixSort && NumInstances <= GPURadixSort::kMaxKeys;
+}
+
+bool Tutorial03_Texturing::SortInstances()
+{
+    ALLOCATION_SCOPE("SortInstances");
+
+    const Uint32 NumInstances = m_RenderFrame.NumInstances;
+    if (NumInstances == 0)
+        return true;
+
+    {
+        MapHelper<SortKeyConstants> CB(m_pImmediateContext, m_SortKeyCB, MAP_WRITE, MAP_FLAG_DISCARD);
+        CB->View         = m_RenderFrame.View;
+        CB->NearZ        = m_RenderFrame.NearZ;
+        CB->FarZ         = m_RenderFrame.FarZ;
+        CB->NumInstances = NumInstances;
+        CB->BackToFront  = m_InstanceSort == INSTANCE_SORT_BACK_TO_FRONT ? 1 : 0;
+        CB->NumSpecies   = m_RenderFrame.NumSpecies;
+    }
+
+    m_pImmediateContext->SetPipelineState(m_SortKeyPSO);
+    m_pImmediateContext->CommitShaderResources(m_SortKeySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->DispatchCompute(DispatchComputeAttribs{(NumInstances + kSortKeyGroupSize - 1) / kSortKeyGroupSize, 1, 1});
+
+    // Only sort the key bits that can be non-zero: with few species this saves whole digit passes
+    Uint32 SpeciesBits = 0;
+    while ((1u << SpeciesBits) < m_RenderFrame.NumSpecies)
+        ++SpeciesBits;
+    return m_RadixSort->Sort(m_pImmediateContext, m_SortKeys, m_InstanceOrder, NumInstances, /*InitValues = */ true, kSortKeyDepthBits + SpeciesBits);
+}
+
+void Tutorial03_Texturing::RunRadixSortTest()
+{
+    // Sizes cover a single key, a partial block, several blocks with a partial
+    // tail and the largest swarm the UI allows
+    static constexpr Uint32 TestSizes[] = {1, 200, 4096 + 17, 65536, 1u << 20};
+
+    RefCntAutoPtr<IQuery> pDuration;
+    if (m_pDevice->GetDeviceInfo().Features.DurationQueries)
+    {
+        QueryDesc Desc;
+        Desc.Name = "Radix sort duration";
+        Desc.Type = QUERY_TYPE_DURATION;
+        m_pDevice->CreateQuery(Desc, &pDuration);
+    }
+
+    std::mt19937 Rng{kRadixSortTestSeed};
+    m_RadixSortTestResults.clear();
+    for (const Uint32 NumKeys : TestSizes)
+    {
+        // Every other key repeats its predecessor so that stability is observable
+        std::vector<Uint32> Keys(NumKeys);
+        for (Uint32 i = 0; i < NumKeys; ++i)
+            Keys[i] = (i & 1) != 0 ? Keys[i - 1] : static_cast<Uint32>(Rng());
+
+        BufferDesc Desc;
+        Desc.Name              = "Radix sort test keys";
+        Desc.Usage             = USAGE_DEFAULT;
+        Desc.BindFlags         = BIND_UNORDERED_ACCESS | BIND_SHADER_RESOURCE;
+        Desc.Mode              = BUFFER_MODE_STRUCTURED;
+        Desc.ElementByteStride = sizeof(Uint32);
+        Desc.Size              = sizeof(Uint32) * NumKeys;
+
+        RefCntAutoPtr<IBuffer> pKeys, pValues, pReadback;
+        BufferData             KeyData{Keys.data(), Desc.Size};
+        m_pDevice->CreateBuffer(Desc, &KeyData, &pKeys);
+        Desc.Name = "Radix sort test values";
+        m_pDevice->CreateBuffer(Desc, nullptr, &pValues);
+
+        BufferDesc ReadbackDesc;
+        ReadbackDesc.Name           = "Radix sort test readback";
+        ReadbackDesc.Usage          = USAGE_STAGING;
+        ReadbackDesc.CPUAccessFlags = CPU_ACCESS_READ;
+        ReadbackDesc.Size           = Desc.Size * 2;
+        m_pDevice->CreateBuffer(ReadbackDesc, nullptr, &pReadback);
+
+        // 1) Correctness: sort once and compare keys and permutation with the reference
+        m_RadixSort->Sort(m_pImmediateContext, pKeys, pValues, NumKeys, /*InitValues = */ true);
+        m_pImmediateContext->CopyBuffer(pKeys, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                        pReadback, 0, Desc.Size, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->CopyBuffer(pValues, 0, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                        pReadback, Desc.Size, Desc.Size, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        m_pImmediateContext->WaitForIdle();
+
+        std::vector<Uint32> RefKeys = Keys;
+        std::vector<Uint32> RefValues(NumKeys);
+        for (Uint32 i = 0; i < NumKeys; ++i)
+            RefValues[i] = i;
+        GPURadixSort::SortReference(RefKeys, RefValues);
+
+        RadixSortTestResult Result;
+        Result.NumKeys = NumKeys;
+        {
+            MapHelper<Uint32> Mapped(m_pImmediateContext, pReadback, MAP_READ, MAP_FLAG_NONE);
+            const Uint32*     pGPUKeys   = Mapped;
+            const Uint32*     pGPUValues = pGPUKeys + NumKeys;
+            Result.Passed                = std::is_sorted(RefKeys.begin(), RefKeys.end()) &&
+                std::equal(RefKeys.begin(), RefKeys.end(), pGPUKeys, pGPUKeys + NumKeys) &&
+                std::equal(RefValues.begin(), RefValues.end(), pGPUValues, pGPUValues + NumKeys);
+        }
+
+        // 2) GPU throughput. The sort does the same work for any input, so the
+        //    already sorted buffer is simply sorted again.
+        const auto GPUStart = std::chrono::high_resolution_clock::now();
+        if (pDuration)
+            m_pImmediateContext->BeginQuery(pDuration);
+        for (Uint32 Iter = 0; Iter < kRadixSortTestIters; ++Iter)
+            m_RadixSort->Sort(m_pImmediateContext, pKeys, pValues, NumKeys, /*InitValues = */ true);
+        if (pDuration)
+            m_pImmediateContext->EndQuery(pDuration);
+        m_pImmediateContext->WaitForIdle();
+
+        QueryDataDuration Duration;
+        if (pDuration && pDuration->GetData(&Duration, sizeof(Duration), true) && Duration.Frequency > 0)
+            Result.GPUMs = 1000.0 * Duration.Duration / Duration.Frequency / kRadixSortTestIters;
+        else // wall-clock fallback, includes submission
+            Result.GPUMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - GPUStart).count() / kRadixSortTestIters;
+
+        // 3) CPU baseline: what sorting the instance list with std::sort would cost
+        std::vector<std::pair<Uint32, Uint32>> Pairs(NumKeys);
+        for (Uint32 i = 0; i < NumKeys; ++i)
+            Pairs[i] = {Keys[i], i};
+        const auto CPUStart = std::chrono::high_resolution_clock::now();
+        std::sort(Pairs.begin(), Pairs.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+        Result.CPUMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - CPUStart).count();
+
+        m_RadixSortTestResults.push_back(Result);
+        if (Result.Passed)
+        {
+            LOG_INFO_MESSAGE("Radix sort ", NumKeys, " keys: passed, GPU ", Result.GPUMs, " ms (",
+                             Result.GPUMs > 0 ? NumKeys / Result.GPUMs / 1000.0 : 0.0, " Mkeys/s), std::sort ", Result.CPUMs, " ms");
+        }
+        else
+        {
+            LOG_ERROR_MESSAGE("Radix sort ", NumKeys, " keys: GPU result does not match the CPU reference");
+        }
+    }
+}
+
+ITextureView* Tutorial03_Texturing::GetSkyLowResRTV(TEXTURE_FORMAT Format)
+{
+    // Recreated lazily whenever the window, the resolution mode or the target format changes
+    const auto&  SCDesc = m_pSwapChain->GetDesc();
+    const Uint32 Width  = std::max(SCDesc.Width >> m_SkyResolution, 1u);
+    const Uint32 Height = std::max(SCDesc.Height >> m_SkyResolution, 1u);
+    if (m_SkyLowRes)
+    {
+        const TextureDesc& Desc = m_SkyLowRes->GetDesc();
+        if (Desc.Width == Width && Desc.Height == Height && Desc.Format == Format)
+            return m_SkyLowRes->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+    }
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = "Reduced-resolution sky";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = Width;
+    TexDesc.Height    = Height;
+    TexDesc.Format    = Format;
+    TexDesc.Usage     = USAGE_DEFAULT;
+    TexDesc.BindFlags = BIND_RENDER_TARGET | BIND_SHADER_RESOURCE;
+    m_SkyLowRes.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_SkyLowRes);
+
+    m_SkyUpsampleSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_SkyLowRes")->Set(m_SkyLowRes->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+    return m_SkyLowRes->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET);
+}
+
+TEXTURE_FORMAT Tutorial03_Texturing::GetTargetFormat(Uint32 Target) const
+{
+    return IsHDRTarget(Target) ? kHDRFormat : m_pSwapChain->GetDesc().ColorBufferFormat;
+}
+
+bool Tutorial03_Texturing::IsTargetSupported(Uint32 Target) const
+{
+    if (!IsMSAATarget(Target))
+        return true;
+
+    // Both the colour and the depth format must support the sample count.
+    // SAMPLE_COUNT flags are equal to the counts they stand for.
+    const auto Samples = static_cast<SAMPLE_COUNT>(kMSAASampleCount);
+    const auto Color   = m_pDevice->GetTextureFormatInfoExt(GetTargetFormat(Target));
+    const auto Depth   = m_pDevice->GetTextureFormatInfoExt(m_pSwapChain->GetDesc().DepthBufferFormat);
+    return (Color.BindFlags & BIND_RENDER_TARGET) != 0 && (Color.SampleCounts & Samples) != 0 && (Depth.SampleCounts & Samples) != 0;
+}
+
+bool Tutorial03_Texturing::PrepareMSAATargets(TEXTURE_FORMAT Format)
+{
+    // Created on first use and recreated whenever the window or the target format changes
+    const auto& SCDesc = m_pSwapChain->GetDesc();
+    if (m_MSAAColor && m_MSAADepth)
+    {
+        const TextureDesc& Desc = m_MSAAColor->GetDesc();
+        if (Desc.Width == SCDesc.Width && Desc.Height == SCDesc.Height && Desc.Format == Format)
+            return true;
+    }
+
+    TextureDesc TexDesc;
+    TexDesc.Name        = "MSAA colour";
+    TexDesc.Type        = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width       = SCDesc.Width;
+    TexDesc.Height      = SCDesc.Height;
+    TexDesc.Format      = Format;
+    TexDesc.SampleCount = kMSAASampleCount;
+    TexDesc.Usage       = USAGE_DEFAULT;
+    TexDesc.BindFlags   = BIND_RENDER_TARGET;
+    m_MSAAColor.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_MSAAColor);
+
+    TexDesc.Name      = "MSAA depth";
+    TexDesc.Format    = SCDesc.DepthBufferFormat;
+    TexDesc.BindFlags = BIND_DEPTH_STENCIL;
+    m_MSAADepth.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_MSAADepth);
+
+    return m_MSAAColor && m_MSAADepth;
+}
+
+void Tutorial03_Texturing::PrepareOITTargets()
+{
+    const auto& SCDesc = m_pSwapChain->GetDesc();
+    if (m_OITAccum)
+    {
+        const TextureDesc& Desc = m_OITAccum->GetDesc();
+        if (Desc.Width == SCDesc.Width && Desc.Height == SCDesc.Height)
+            return;
+    }
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = "OIT accumulation";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = SCDesc.Width;
+    TexDesc.Height    = SCDesc.Height;
+    TexDesc.Format    = kOITAccumFormat;
+    TexDesc.Usage     = USAGE_DEFAULT;
+    TexDesc.BindFlags = BIND_RENDER_TARGET | BIND_SHADER_RESOURCE;
+    m_OITAccum.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_OITAccum);
+
+    TexDesc.Name   = "OIT revealage";
+    TexDesc.Format = kOITRevealFormat;
+    m_OITReveal.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_OITReveal);
+
+    m_OITCompositeSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_OITAccum")->Set(m_OITAccum->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+    m_OITCompositeSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_OITReveal")->Set(m_OITReveal->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+}
+
+void Tutorial03_Texturing::CreateOITComposite()
+{
+    // Full-screen pass that blends the normalized OIT accumulation over the scene
+    GraphicsPipelineStateCreateInfo PSOCreateInfo;
+    PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_GRAPHICS;
+
+    PSOCreateInfo.GraphicsPipeline.NumRenderTargets             = 1;
+    PSOCreateInfo.GraphicsPipeline.DSVFormat                    = TEX_FORMAT_UNKNOWN;
+    PSOCreateInfo.GraphicsPipeline.PrimitiveTopology            = PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    PSOCreateInfo.GraphicsPipeline.RasterizerDesc.CullMode      = CULL_MODE_NONE;
+    PSOCreateInfo.GraphicsPipeline.DepthStencilDesc.DepthEnable = False;
+
+    auto& RT0          = PSOCreateInfo.GraphicsPipeline.BlendDesc.RenderTargets[0];
+    RT0.BlendEnable    = True;
+    RT0.SrcBlend       = BLEND_FACTOR_SRC_ALPHA;
+    RT0.DestBlend      = BLEND_FACTOR_INV_SRC_ALPHA;
+    RT0.SrcBlendAlpha  = BLEND_FACTOR_ONE;
+    RT0.DestBlendAlpha = BLEND_FACTOR_INV_SRC_ALPHA;
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.FilePath       = "WeightedOIT.hlsl";
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(m_ShaderSearchPath.c_str(), &ShaderCI.pShaderSourceStreamFactory);
+
+    RefCntAutoPtr<IShader> vs;
+    ShaderCI.Desc       = {"OIT composite VS", SHADER_TYPE_VERTEX, true};
+    ShaderCI.EntryPoint = "CompositeVS";
+    m_pDevice->CreateShader(ShaderCI, &vs);
+    PSOCreateInfo.pVS = vs;
+
+    ShaderResourceVariableDesc Vars[] =
+        {
+            {SHADER_TYPE_PIXEL, "g_OITAccum", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE},
+            {SHADER_TYPE_PIXEL, "g_OITReveal", SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE}};
+    PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+    PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+    // OIT only runs on single-sample targets; the back buffer may need gamma conversion
+    for (Uint32 Target = RENDER_TARGET_BACK_BUFFER; Target <= RENDER_TARGET_HDR; ++Target)
+    {
+        const bool  ToGamma  = !IsHDRTarget(Target) && m_ConvertPSOutputToGamma;
+        ShaderMacro Macros[] = {{"CONVERT_PS_OUTPUT_TO_GAMMA", ToGamma ? "1" : "0"}};
+        ShaderCI.Macros      = {Macros, _countof(Macros)};
+
+        RefCntAutoPtr<IShader> ps;
+        ShaderCI.Desc       = {"OIT composite PS", SHADER_TYPE_PIXEL, true};
+        ShaderCI.EntryPoint = "CompositePS";
+        m_pDevice->CreateShader(ShaderCI, &ps);
+
+        PSOCreateInfo.PSODesc.Name                   = "OIT composite PSO";
+        PSOCreateInfo.GraphicsPipeline.RTVFormats[0] = GetTargetFormat(Target);
+        PSOCreateInfo.pPS                            = ps;
+        m_pDevice->CreateGraphicsPipelineState(PSOCreateInfo, &m_OITCompositePSO[Target]);
+    }
+    m_OITCompositePSO[RENDER_TARGET_BACK_BUFFER]->CreateShaderResourceBinding(&m_OITCompositeSRB, true);
+}
+
+void Tutorial03_Texturing::CreateToneMapping()
+{
+    // The fused resolve writes a UAV that is then copied to the back buffer. Swap
+    // chain images cannot be UAVs, so the UAV uses the linear twin of the back-buffer
+    // format (the copy only needs the same bit layout) and the shader encodes sRGB.
+    TEXTURE_FORMAT LDRFormat = TEX_FORMAT_UNKNOWN;
+    switch (m_pSwapChain->GetDesc().ColorBufferFormat)
+    {
+        case TEX_FORMAT_RGBA8_UNORM:
+        case TEX_FORMAT_RGBA8_UNORM_SRGB: LDRFormat = TEX_FORMAT_RGBA8_UNORM; break;
+        case TEX_FORMAT_BGRA8_UNORM:
+        case TEX_FORMAT_BGRA8_UNORM_SRGB: LDRFormat = TEX_FORMAT_BGRA8_UNORM; break;
+        default: break;
+    }
+    if (LDRFormat == TEX_FORMAT_UNKNOWN ||
+        !m_pDevice->GetDeviceInfo().Features.ComputeShaders ||
+        (m_pDevice->GetTextureFormatInfoExt(LDRFormat).BindFlags & BIND_UNORDERED_ACCESS) == 0)
+    {
+        LOG_INFO_MESSAGE("HDR rendering is unavailable: needs compute shaders and a UAV-capable linear twin of the back-buffer format");
+        return;
+    }
+    m_ToneMapLDRFormat = LDRFormat;
+
+    BufferDesc CBDesc;
+    CBDesc.Name           = "Tone mapping constants";
+    CBDesc.Size           = sizeof(ToneMapConstants);
+    CBDesc.Usage          = USAGE_DYNAMIC;
+    CBDesc.BindFlags      = BIND_UNIFORM_BUFFER;
+    CBDesc.CPUAccessFlags = CPU_ACCESS_WRITE;
+    m_pDevice->CreateBuffer(CBDesc, nullptr, &m_ToneMapCB);
+
+    // Histogram is cleared by ComputeExposure after every use, so it starts zeroed
+    std::array<Uint32, kHistogramBins> Zeros = {};
+    BufferData                         HistData{Zeros.data(), sizeof(Zeros)};
+
+    BufferDesc BuffDesc;
+    BuffDesc.Name              = "Luminance histogram";
+    BuffDesc.Usage             = USAGE_DEFAULT;
+    BuffDesc.BindFlags         = BIND_UNORDERED_ACCESS;
+    BuffDesc.Mode              = BUFFER_MODE_STRUCTURED;
+    BuffDesc.ElementByteStride = sizeof(Uint32);
+    BuffDesc.Size              = sizeof(Zeros);
+    m_pDevice->CreateBuffer(BuffDesc, &HistData, &m_LumHistogram);
+
+    // x - exposure multiplier applied by ToneMap, y - adapted average luminance
+    const float ExposureInit[] = {1.0f, 0.18f};
+    BufferData  ExposureData{ExposureInit, sizeof(ExposureInit)};
+    BuffDesc.Name              = "Exposure";
+    BuffDesc.ElementByteStride = sizeof(float);
+    BuffDesc.Size              = sizeof(ExposureInit);
+    m_pDevice->CreateBuffer(BuffDesc, &ExposureData, &m_Exposure);
+
+    ShaderCreateInfo ShaderCI;
+    ShaderCI.SourceLanguage                  = SHADER_SOURCE_LANGUAGE_HLSL;
+    ShaderCI.Desc.UseCombinedTextureSamplers = true;
+    ShaderCI.FilePath                        = "ToneMap.csh";
+
+    RefCntAutoPtr<IShaderSourceInputStreamFactory> pShaderSourceFactory;
+    m_pEngineFactory->CreateDefaultShaderSourceStreamFactory(m_ShaderSearchPath.c_str(), &pShaderSourceFactory);
+    ShaderCI.pShaderSourceStreamFactory = pShaderSourceFactory;
+
+    for (Uint32 Pass = 0; Pass < TONEMAP_PASS_COUNT; ++Pass)
+    {
+        const char* EntryPoint = Pass == TONEMAP_PASS_RESOLVE ? "ToneMap" : "ComputeExposure";
+
+        RefCntAutoPtr<IShader> pCS;
+        ShaderCI.Desc.ShaderType = SHADER_TYPE_COMPUTE;
+        ShaderCI.Desc.Name       = EntryPoint;
+        ShaderCI.EntryPoint      = EntryPoint;
+        m_pDevice->CreateShader(ShaderCI, &pCS);
+
+        ComputePipelineStateCreateInfo PSOCreateInfo;
+        PSOCreateInfo.PSODesc.Name         = EntryPoint;
+        PSOCreateInfo.PSODesc.PipelineType = PIPELINE_TYPE_COMPUTE;
+        PSOCreateInfo.pCS                  = pCS;
+
+        // Targets are recreated on resize, so everything but the constants is mutable
+        PSOCreateInfo.PSODesc.ResourceLayout.DefaultVariableType = SHADER_RESOURCE_VARIABLE_TYPE_MUTABLE;
+
+        ShaderResourceVariableDesc Vars[] =
+            {
+                {SHADER_TYPE_COMPUTE, "ToneMapConstants", SHADER_RESOURCE_VARIABLE_TYPE_STATIC}};
+        PSOCreateInfo.PSODesc.ResourceLayout.Variables    = Vars;
+        PSOCreateInfo.PSODesc.ResourceLayout.NumVariables = _countof(Vars);
+
+        m_pDevice->CreateComputePipelineState(PSOCreateInfo, &m_ToneMapPSOs[Pass]);
+        m_ToneMapPSOs[Pass]->GetStaticVariableByName(SHADER_TYPE_COMPUTE, "ToneMapConstants")->Set(m_ToneMapCB);
+        m_ToneMapPSOs[Pass]->CreateShaderResourceBinding(&m_ToneMapSRBs[Pass], true);
+        m_ToneMapSRBs[Pass]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Histogram")->Set(m_LumHistogram->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+        m_ToneMapSRBs[Pass]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_Exposure")->Set(m_Exposure->GetDefaultView(BUFFER_VIEW_UNORDERED_ACCESS));
+    }
+
+    CreateHDRTargets();
+}
+
+void Tutorial03_Texturing::CreateHDRTargets()
+{
+    if (!m_ToneMapPSOs[TONEMAP_PASS_RESOLVE])
+        return;
+
+    const auto& SCDesc = m_pSwapChain->GetDesc();
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = "HDR colour";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = SCDesc.Width;
+    TexDesc.Height    = SCDesc.Height;
+    TexDesc.Format    = kHDRFormat;
+    TexDesc.Usage     = USAGE_DEFAULT;
+    TexDesc.BindFlags = BIND_RENDER_TARGET | BIND_SHADER_RESOURCE;
+    m_HDRColor.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_HDRColor);
+
+    TexDesc.Name      = "Tone mapped colour";
+    TexDesc.Format    = m_ToneMapLDRFormat;
+    TexDesc.BindFlags = BIND_UNORDERED_ACCESS;
+    m_ToneMapped.Release();
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_ToneMapped);
+
+    auto* pResolveVar = m_ToneMapSRBs[TONEMAP_PASS_RESOLVE]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_HDRColor");
+    pResolveVar->Set(m_HDRColor->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+    pResolveVar = m_ToneMapSRBs[TONEMAP_PASS_RESOLVE]->GetVariableByName(SHADER_TYPE_COMPUTE, "g_LDRColor");
+    pResolveVar->Set(m_ToneMapped->GetDefaultView(TEXTURE_VIEW_UNORDERED_ACCESS), SET_SHADER_RESOURCE_FLAG_ALLOW_OVERWRITE);
+}
+
+bool Tutorial03_Texturing::LoadHDRSky()
+{
+    auto TryLoad = [&](const char* Path) {
+        if (std::FILE* pFile = std::fopen(Path, "rb"))
+            std::fclose(pFile);
+        else
+            return false;
+
+        RefCntAutoPtr<ITexture> SkyTex;
+        CreateTextureFromFile(Path, TextureLoadInfo{}, m_pDevice, &SkyTex);
+        if (!SkyTex)
+            return false;
+
+        m_HDRSkySource = Path;
+        m_HDRSkySRB.Release();
+        m_SkyPSO[RENDER_TARGET_HDR]->CreateShaderResourceBinding(&m_HDRSkySRB, true);
+        m_HDRSkySRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_SkyTex")->Set(SkyTex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE));
+        return true;
+    };
+
+    // 1) Half-float DDS or RGBE .hdr, whichever ships next to the PNG, then a previous bake
+    static constexpr const char* Candidates[] = {"hdrHigh.dds", "hdrHigh.hdr", kHDRSkyFile};
+    for (const char* Path : Candidates)
+    {
+        if (TryLoad(Path))
+            return true;
+    }
+
+    // 2) Otherwise expand the PNG into a half-float sky once, like the sky tile file
+    LOG_INFO_MESSAGE("No half-float or RGBE sky found (hdrHigh.dds / hdrHigh.hdr); baking '", kHDRSkyFile, "' from hdrHigh.png");
+    RefCntAutoPtr<Image> pImage;
+    CreateImageFromFile("hdrHigh.png", &pImage);
+    if (pImage && pImage->GetDesc().ComponentType == VT_UINT8)
+    {
+        const ImageDesc& ImgDesc = pImage->GetDesc();
+        if (SkyHDRBaker::Bake(static_cast<const Uint8*>(pImage->GetData()->GetConstDataPtr()),
+                              ImgDesc.Width, ImgDesc.Height, ImgDesc.NumComponents, ImgDesc.RowStride,
+                              kHDRSkyMaxWidth, kHDRSkyPeak, kHDRSkyFile) &&
+            TryLoad(kHDRSkyFile))
+            return true;
+    }
+
+    // Without an HDR source the 8-bit sky is rendered as is, i.e. with radiance in [0, 1]
+    LOG_WARNING_MESSAGE("Failed to bake '", kHDRSkyFile, "'; HDR mode uses the 8-bit sky");
+    m_HDRSkySource = "hdrHigh.png (8-bit)";
+    return false;
+}
+
+void Tutorial03_Texturing::ToneMapHDR(ITextureView* pBackBufferRTV)
+{
+    ALLOCATION_SCOPE("ToneMapHDR");
+
+    const auto& SCDesc = m_pSwapChain->GetDesc();
+
+    // Log-luminance range covered by the histogram: 2^-10 .. 2^6 cd/m²-ish scene units
+    ToneMapConstants Consts;
+    Consts.Width                = SCDesc.Width;
+    Consts.Height               = SCDesc.Height;
+    Consts.MinLogLum            = -10.0f;
+    Consts.LogLumRange          = 16.0f;
+    Consts.AdaptationRate       = 1.0f - std::exp(-m_RenderFrame.FrameTime * m_ExposureAdaptSpeed);
+    Consts.ExposureCompensation = m_ExposureCompensation;
+    Consts.NumPixels            = SCDesc.Width * SCDesc.Height;
+    {
+        MapHelper<ToneMapConstants> CB(m_pImmediateContext, m_ToneMapCB, MAP_WRITE, MAP_FLAG_DISCARD);
+        *CB = Consts;
+    }
+
+    // 1) Fused resolve: exposure (from last frame's histogram) + tone curve + sRGB
+    //    encode, while accumulating this frame's histogram from the same read
+    m_pImmediateContext->SetPipelineState(m_ToneMapPSOs[TONEMAP_PASS_RESOLVE]);
+    m_pImmediateContext->CommitShaderResources(m_ToneMapSRBs[TONEMAP_PASS_RESOLVE], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->DispatchCompute(DispatchComputeAttribs{(Consts.Width + kToneMapGroupSize - 1) / kToneMapGroupSize,
+                                                                (Consts.Height + kToneMapGroupSize - 1) / kToneMapGroupSize, 1});
+
+    // 2) One group turns the histogram into next frame's exposure and clears it
+    m_pImmediateContext->SetPipelineState(m_ToneMapPSOs[TONEMAP_PASS_EXPOSURE]);
+    m_pImmediateContext->CommitShaderResources(m_ToneMapSRBs[TONEMAP_PASS_EXPOSURE], RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    m_pImmediateContext->DispatchCompute(DispatchComputeAttribs{1, 1, 1});
+
+    // 3) Same bit layout, so a plain copy puts the result in the back buffer
+    CopyTextureAttribs CopyAttribs{m_ToneMapped, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                   pBackBufferRTV->GetTexture(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION};
+    m_pImmediateContext->CopyTexture(CopyAttribs);
+
+    // The UI is drawn after Render() into whatever is bound, so restore the back buffer
+    ITextureView* pRTVs[] = {pBackBufferRTV};
+    m_pImmediateContext->SetRenderTargets(1, pRTVs, m_pSwapChain->GetDepthBufferDSV(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+}
+
+void Tutorial03_Texturing::LoadTexture()
+{
+    // All species live in one Texture2DArray that cube.psh indexes with the per-instance
+    // species, so any number of species is still one instanced draw with one SRB.
+    // Slice 0 is try.png. Slice N is species_NN.png when it exists and has the same size,
+    // otherwise a hue-rotated copy of try.png so that every slice is distinguishable.
+    RefCntAutoPtr<Image> pBaseImage;
+    CreateImageFromFile("try.png", &pBaseImage);
+    if (!pBaseImage || pBaseImage->GetDesc().ComponentType != VT_UINT8 || pBaseImage->GetDesc().NumComponents < 3)
+    {
+        LOG_ERROR_MESSAGE("Failed to load try.png as an 8-bit RGB(A) image");
+        return;
+    }
+
+    const Uint32 Width  = pBaseImage->GetDesc().Width;
+    const Uint32 Height = pBaseImage->GetDesc().Height;
+
+    // 1) Expand every source image to tightly packed RGBA8
+    const auto ToRGBA8 = [&](const Image& Img, Uint8* pDst) {
+        const ImageDesc& Desc = Img.GetDesc();
+        const Uint8*     pSrc = static_cast<const Uint8*>(Img.GetData()->GetConstDataPtr());
+        for (Uint32 y = 0; y < Height; ++y)
+        {
+            const Uint8* pRow = pSrc + size_t{y} * Desc.RowStride;
+            for (Uint32 x = 0; x < Width; ++x, pDst += 4)
+            {
+                const Uint8* pTexel = pRow + size_t{x} * Desc.NumComponents;
+                pDst[0]             = pTexel[0];
+                pDst[1]             = pTexel[1];
+                pDst[2]             = pTexel[2];
+                pDst[3]             = Desc.NumComponents == 4 ? pTexel[3] : 255;
+            }
+        }
+    };
+
+    const size_t       SliceSize = size_t{Width} * Height * 4;
+    std::vector<Uint8> Texels(SliceSize * kMaxSpecies);
+    ToRGBA8(*pBaseImage, Texels.data());
+
+    for (Uint32 Slice = 1; Slice < kMaxSpecies; ++Slice)
+    {
+        Uint8* pSlice = &Texels[SliceSize * Slice];
+
+        std::string Path = "species_";
+        Path += static_cast<char>('0' + Slice / 10);
+        Path += static_cast<char>('0' + Slice % 10);
+        Path += ".png";
+
+        RefCntAutoPtr<Image> pImage;
+        if (std::FILE* pFile = std::fopen(Path.c_str(), "rb"))
+        {
+            std::fclose(pFile);
+            CreateImageFromFile(Path.c_str(), &pImage);
+        }
+        if (pImage != nullptr)
+        {
+            const ImageDesc& Desc = pImage->GetDesc();
+            if (Desc.Width == Width && Desc.Height == Height && Desc.ComponentType == VT_UINT8 && Desc.NumComponents >= 3)
+            {
+                ToRGBA8(*pImage, pSlice);
+                continue;
+            }
+            LOG_WARNING_MESSAGE("'", Path, "' must be an 8-bit RGB(A) image of the same size as try.png; using a tinted copy instead");
+        }
+
+        // Rotate the hue about the grey axis (Rodrigues' formula) by golden-angle steps
+        // so that consecutive species are far apart on the colour wheel
+        const float Angle = static_cast<float>(Slice) * 2.39996323f;
+        const float c     = std::cos(Angle);
+        const float s     = std::sin(Angle) / std::sqrt(3.0f);
+        const float k     = (1.0f - c) / 3.0f;
+        const float Diag  = c + k;
+        const float Plus  = k + s;
+        const float Minus = k - s;
+        for (size_t i = 0; i < SliceSize; i += 4)
+        {
+            const float r = Texels[i + 0];
+            const float g = Texels[i + 1];
+            const float b = Texels[i + 2];
+
+            const float Rotated[3] = {
+                Diag * r + Minus * g + Plus * b,
+                Plus * r + Diag * g + Minus * b,
+                Minus * r + Plus * g + Diag * b,
+            };
+            for (Uint32 ch = 0; ch < 3; ++ch)
+                pSlice[i + ch] = static_cast<Uint8>(std::min(std::max(Rotated[ch] + 0.5f, 0.0f), 255.0f));
+            pSlice[i + 3] = Texels[i + 3];
+        }
+    }
+
+    // 2) Create the array with a full mip chain and generate the mips on the GPU
+    TextureDesc TexDesc;
+    TexDesc.Name      = "Butterfly species array";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D_ARRAY;
+    TexDesc.Width     = Width;
+    TexDesc.Height    = Height;
+    TexDesc.ArraySize = kMaxSpecies;
+    TexDesc.MipLevels = 0; // full chain
+    TexDesc.Format    = TEX_FORMAT_RGBA8_UNORM_SRGB;
+    TexDesc.Usage     = USAGE_DEFAULT;
+    TexDesc.BindFlags = BIND_SHADER_RESOURCE | BIND_RENDER_TARGET;
+    TexDesc.MiscFlags = MISC_TEXTURE_FLAG_GENERATE_MIPS;
+
+    RefCntAutoPtr<ITexture> Tex;
+    m_pDevice->CreateTexture(TexDesc, nullptr, &Tex);
+
+    Box SliceBox;
+    SliceBox.MaxX = Width;
+    SliceBox.MaxY = Height;
+    for (Uint32 Slice = 0; Slice < kMaxSpecies; ++Slice)
+    {
+        TextureSubResData SubresData{&Texels[SliceSize * Slice], Uint64{Width} * 4};
+        m_pImmediateContext->UpdateTexture(Tex, 0, Slice, SliceBox, SubresData,
+                                           RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                           RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
+
+    // Obtain SRV for use in the pixel shader
+    m_TextureSRV = Tex->GetDefaultView(TEXTURE_VIEW_SHADER_RESOURCE);
+    m_pImmediateContext->GenerateMips(m_TextureSRV);
+
+    // Bind the texture SRV to the shader variable "g_Texture"
+    m_SRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV);
+    m_AnalyticSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV);
+    if (m_SortedSRB)
+        m_SortedSRB->GetVariableByName(SHADER_TYPE_PIXEL, "g_Texture")->Set(m_TextureSRV);
+}
+
+void Tutorial03_Texturing::Initialize(const SampleInitInfo& InitInfo)
+{
+    // 1) Base class initialization (window, swap chain, input, etc.)
+    SampleBase::Initialize(InitInfo);
+
+    // 2) Configure camera position, orientation, and projection
+    const auto SCDesc = m_pSwapChain->GetDesc();
+    m_Camera.SetPos(float3{0.f, 0.f, -30.f}); // move camera back
+    m_Camera.SetRotation(0.f, 0.f);
+    m_Camera.SetMoveSpeed(4.f);
+    m_Camera.SetRotationSpeed(0.006f);
+    m_Camera.SetProjAttribs(
+        0.1f, 100.f,
+        static_cast<float>(SCDesc.Width) / SCDesc.Height,
+        PI_F / 4,
+        SCDesc.PreTransform,
+        m_pDevice->GetDeviceInfo().IsGLDevice());
+
+    // Regression frames are rendered offscreen at a fixed animation time
+    if (m_Regression.IsEnabled())
+    {
+        m_PathTime = kRegressionTime;
+        CreateRegressionTargets();
+    }
+
+    // Frame fence and per-slot GPU timestamps, see BeginFrame()
+    {
+        FenceDesc FncDesc;
+        FncDesc.Name = "Frame fence";
+        FncDesc.Type = FENCE_TYPE_CPU_WAIT_ONLY;
+        m_pDevice->CreateFence(FncDesc, &m_FrameFence);
+
+        if (m_pDevice->GetDeviceInfo().Features.TimestampQueries)
+        {
+            QueryDesc Desc;
+            Desc.Type = QUERY_TYPE_TIMESTAMP;
+            for (Uint32 Slot = 0; Slot < kMaxFramesInFlight; ++Slot)
+            {
+                Desc.Name = "Frame begin timestamp";
+                m_pDevice->CreateQuery(Desc, &m_FrameBeginQueries[Slot]);
+                Desc.Name = "Frame end timestamp";
+                m_pDevice->CreateQuery(Desc, &m_FrameEndQueries[Slot]);
+            }
+        }
+    }
+
+    // 3) Create rendering pipeline, mesh buffers, and sky sphere.
+    //    The wing animation texture is a static PSO resource, so it is baked first.
+    if (m_WingVAT)
+    {
+        if (Butterfly::ButterflyVertexCount <= m_pDevice->GetAdapterInfo().Texture.MaxTexture2DDimension)
+            BakeWingVAT();
+        else
+        {
+            LOG_WARNING_MESSAGE("The butterfly has more vertices than the widest supported texture; --wing_vat is ignored");
+            m_WingVAT = false;
+        }
+    }
+    CreatePipelineState();
+    CreateVertexBuffer();
+    CreateIndexBuffer();
+    LoadTexture();
+    CreateSkySphere();
+    CreateToneMapping();
+    CreateOITComposite();
+
+    // 4) GPU flocking and instance sorting are only available where compute shaders are
+    if (m_pDevice->GetDeviceInfo().Features.ComputeShaders)
+    {
+        CreateFlockingPipelines();
+        CreateInstanceSort();
+    }
+
+    // 5) Set up butterfly instance centers & phases, instance buffers, and initial worlds
+    m_InstanceReader = m_InstanceFrames.AddReader();
+    ResetSimulation();
+
+    if (m_RunRadixSortTest && m_RadixSort)
+        RunRadixSortTest();
+    if (m_RunStateExchangeTest)
+    {
+        // The primitives first, then the paths the application runs them through
+        const Uint32 NumReaders = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        const bool   Passed     = RunStateExchangeStressTest(NumReaders, 2.0) && RunSimulationStressTest(NumReaders, 2.0);
+        RequestExit(Passed);
+    }
+    if (m_RunWingBench)
+        RunWingVSBenchmark();
+
+    // 6) Watch the shader sources for hot reload in the directory the shader source
+    //    factories read them from. Regression frames must come from the shaders the
+    //    run started with.
+    if (!m_Regression.IsEnabled())
+        m_ShaderWatcher.Start(m_ShaderSearchPath.c_str(), {"cube.vsh", "cube.psh", "DepthGrid.hlsl", "Flocking.csh", "ToneMap.csh",
+                                    "WeightedOIT.hlsl", "RadixSort.csh", "SortKeys.csh"});
+}
+
+void Tutorial03_Texturing::CreateRegressionTargets()
+{
+    // Same size and formats as the swap chain so that all back-buffer pipelines and
+    // size-dependent targets are reused. Reading back a texture we own also works
+    // where the swap chain images cannot be copied from, e.g. on GL.
+    const SwapChainDesc& SCDesc = m_pSwapChain->GetDesc();
+
+    TextureDesc TexDesc;
+    TexDesc.Name      = "Regression color";
+    TexDesc.Type      = RESOURCE_DIM_TEX_2D;
+    TexDesc.Width     = SCDesc.Width;
+    TexDesc.Height    = SCDesc.Height;
+    TexDesc.Format    = SCDesc.ColorBufferFormat;
+    TexDesc.BindFlags = BIND_RENDER_TARGET;
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_RegressionColor);
+
+    TexDesc.Name      = "Regression depth";
+    TexDesc.Format    = SCDesc.DepthBufferFormat;
+    TexDesc.BindFlags = BIND_DEPTH_STENCIL;
+    m_pDevice->CreateTexture(TexDesc, nullptr, &m_RegressionDepth);
+}
+
+void Tutorial03_Texturing::FinishRegressionFrame()
+{
+    // 1) Copy the frame to a staging texture and wait for it
+    TextureDesc StagingDesc    = m_RegressionColor->GetDesc();
+    StagingDesc.Name           = "Regression readback";
+    StagingDesc.BindFlags      = BIND_NONE;
+    StagingDesc.Usage          = USAGE_STAGING;
+    StagingDesc.CPUAccessFlags = CPU_ACCESS_READ;
+
+    RefCntAutoPtr<ITexture> pStaging;
+    m_pDevice->CreateTexture(StagingDesc, nullptr, &pStaging);
+
+    CopyTextureAttribs CopyAttribs{m_RegressionColor, RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
+                                   pStaging, RESOURCE_STATE_TRANSITION_MODE_TRANSITION};
+    m_pImmediateContext->CopyTexture(CopyAttribs);
+    m_pImmediateContext->WaitForIdle();
+
+    // 2) Convert to tightly packed RGBA8, top row first. sRGB formats are written
+    //    as stored. GL textures are read back bottom row first.
+    const TEXTURE_FORMAT Format = StagingDesc.Format;
+    const bool           BGRA   = Format == TEX_FORMAT_BGRA8_UNORM || Format == TEX_FORMAT_BGRA8_UNORM_SRGB;
+    const bool           RGBA   = Format == TEX_FORMAT_RGBA8_UNORM || Format == TEX_FORMAT_RGBA8_UNORM_SRGB;
+    const bool           FlipY  = m_pDevice->GetDeviceInfo().IsGLDevice();
+
+    bool               Passed = BGRA || RGBA;
+    std::vector<Uint8> Pixels(size_t{StagingDesc.Width} * StagingDesc.Height * 4);
+    if (Passed)
+    {
+        MappedTextureSubresource Mapped;
+        m_pImmediateContext->MapTextureSubresource(pStaging, 0, 0, MAP_READ, MAP_FLAG_DO_NOT_WAIT, nullptr, Mapped);
+        for (Uint32 y = 0; y < StagingDesc.Height; ++y)
+        {
+            const Uint8* pSrc = static_cast<const Uint8*>(Mapped.pData) + size_t{FlipY ? StagingDesc.Height - 1 - y : y} * Mapped.Stride;
+            Uint8*       pDst = &Pixels[size_t{y} * StagingDesc.Width * 4];
+            for (Uint32 x = 0; x < StagingDesc.Width; ++x, pSrc += 4, pDst += 4)
+            {
+                pDst[0] = pSrc[BGRA ? 2 : 0];
+                pDst[1] = pSrc[1];
+                pDst[2] = pSrc[BGRA ? 0 : 2];
+                pDst[3] = pSrc[3];
+            }
+        }
+        m_pImmediateContext->UnmapTextureSubresource(pStaging, 0, 0);
+    }
+    else
+    {
+        LOG_ERROR_MESSAGE("Regression capture supports 8-bit RGBA/BGRA swap chains only, got ", GetTextureFormatAttribs(Format).Name);
+    }
+
+    // 3) Write the capture and compare against the golden image
+    if (Passed && !m_Regression.CapturePath.empty())
+    {
+        Passed = ImageDiff::SavePNG(m_Regression.CapturePath.c_str(), Pixels.data(), StagingDesc.Width, StagingDesc.Height);
+        if (Passed)
+            LOG_INFO_MESSAGE("Regression frame written to ", m_Regression.CapturePath);
+    }
+
+    if (Passed && !m_Regression.GoldenPath.empty())
+    {
+        std::vector<Uint8> Golden;
+        Uint32             GoldenWidth = 0, GoldenHeight = 0;
+        Passed = ImageDiff::LoadPNG(m_Regression.GoldenPath.c_str(), Golden, GoldenWidth, GoldenHeight);
+        if (Passed && (GoldenWidth != StagingDesc.Width || GoldenHeight != StagingDesc.Height))
+        {
+            LOG_ERROR_MESSAGE("Golden image is ", GoldenWidth, "x", GoldenHeight, ", the frame is ",
+                              StagingDesc.Width, "x", StagingDesc.Height);
+            Passed = false;
+        }
+        if (Passed)
+        {
+            const ImageDiffResult Diff = ImageDiff::Compare(Pixels.data(), Golden.data(), GoldenWidth, GoldenHeight);
+
+            Passed = Diff.PSNR >= m_Regression.MinPSNR && Diff.SSIM >= m_Regression.MinSSIM;
+            LOG_INFO_MESSAGE("Regression vs ", m_Regression.GoldenPath, ": PSNR ", Diff.PSNR, " dB (min ", m_Regression.MinPSNR,
+                             "), SSIM ", Diff.SSIM, " (min ", m_Regression.MinSSIM, "), max channel diff ", Diff.MaxDiff,
+                             Passed ? " - PASSED" : " - FAILED");
+        }
+    }
+
+    // 4) The harness is a one-shot check, so the exit code carries the verdict
+    RequestExit(Passed);
+}
+
+void Tutorial03_Texturing::RequestExit(bool Passed)
+{
+    if (m_ExitCode < 0)
+        m_ExitCode = Passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void Tutorial03_Texturing::StopWorkers()
+{
+    m_SimThread.Stop();
+    m_ShaderWatcher.Stop();
+    if (m_PendingReload.valid())
+        m_PendingReload.wait();
+    m_StopRecord.store(true);
+    if (m_PendingRecord.valid())
+        m_PendingRecord.wait();
+    m_Trajectory.Close();
+    m_SkyStreamer.Close();
+}
+
+Tutorial03_Texturing::~Tutorial03_Texturing()
+{
+    // Workers reference this object, so they are joined before any member is destroyed
+    StopWorkers();
+}
+
+void Tutorial03_Texturing::ResetSimulation()
+{
+    // Playback takes the instance count from the trajectory file, which must not be
+    // read while a recording is still writing it
+    m_Trajectory.Close();
+    if (m_SimulationMode == SIMULATION_MODE_PLAYBACK)
+    {
+        if (m_PendingRecord.valid())
+            m_PendingRecord.get();
+        if (m_Trajectory.Open(m_TrajectoryPath.c_str()))
+        {
+            m_Swarm.InstanceCount = m_Trajectory.GetHeader().NumInstances;
+            m_PlaybackTime        = 0;
+            m_PlaybackFrame       = 0;
+            m_PlaybackLateFrames  = 0;
+        }
+        else
+        {
+            LOG_WARNING_MESSAGE("Trajectory playback is unavailable, switching to CPU orbits");
+            m_SimulationMode = SIMULATION_MODE_ORBITS;
+        }
+    }
+
+    // Compare mode needs a reproducible swarm that the CPU reference can step every frame
+    const bool Compare = m_SimulationMode == SIMULATION_MODE_FLOCKING_GPU && m_FlockCompare;
+    if (Compare)
+        m_Swarm.InstanceCount = std::min(m_Swarm.InstanceCount, kFlockCompareMaxCount);
+    m_InstanceCount    = m_Swarm.InstanceCount;
+    m_InstanceCapacity = std::max(m_InstanceCount, 1u);
+
+    // A swarm seed of 0 picks a new layout on every reset
+    Uint32 Seed = m_Swarm.Seed != 0 ? m_Swarm.Seed : std::random_device{}();
+    if (Compare)
+        Seed = kFlockCompareSeed;
+    if (m_Regression.IsEnabled())
+        Seed = kRegressionSeed;
+    InitInstanceData(Seed);
+    CreateInstanceBuffer(0);
+    CreateInstanceParamsBuffer(0);
+    GenerateInstanceData(m_PathTime);
+
+    if (m_pDevice->GetDeviceInfo().Features.ComputeShaders)
+    {
+        CreateFlockingBuffers(0);
+        InitFlockingAgents(0);
+        CreateInstanceSortBuffers();
+    }
+}
+
+SampleBase::CommandLineStatus Tutorial03_Texturing::ProcessCommandLine(int argc, const char* const* argv)
+{
+    // Swarm options are --swarm_<name> <value> or --swarm_<name>=<value>.
+    // Everything else but the --radix_sort_test, --state_exchange_test, --zero_alloc_test,
+    // --shader_dir, --wing_vat, --wing_vs_bench, --trajectory, --frames_in_flight, --sim_thread,
+    // --views and --regression_* switches is left to the sample framework.
+    static constexpr char   Prefix[]  = "--swarm_";
+    static constexpr size_t PrefixLen = sizeof(Prefix) - 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string Arg = argv[i];
+        if (Arg == "--radix_sort_test")
+        {
+            // Runs the GPU radix sort self-test once at startup and logs the results
+            m_RunRadixSortTest = true;
+            continue;
+        }
+        if (Arg == "--zero_alloc_test")
+        {
+            // Fails unless the frames after warm-up make no heap allocations on the render thread
+            if (!AllocationTracker::IsEnabled())
+            {
+                LOG_ERROR_MESSAGE("--zero_alloc_test requires the allocation tracker (TUTORIAL03_TRACK_ALLOCATIONS)");
+                return CommandLineStatus::Error;
+            }
+            m_ZeroAllocTest.NumFrames = 100;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                m_ZeroAllocTest.NumFrames = static_cast<Uint32>(std::max(std::atoi(argv[++i]), 1));
+            continue;
+        }
+        if (Arg == "--state_exchange_test")
+        {
+            // Stress-tests the lock-free state exchange at startup and quits with the result
+            m_RunStateExchangeTest = true;
+            continue;
+        }
+        if (Arg == "--shader_dir" && i + 1 < argc)
+        {
+            // Directory to load shaders from and to watch for hot reload
+            m_ShaderSearchPath = argv[++i];
+            continue;
+        }
+        if (Arg == "--wing_vat")
+        {
+            // Animates the wings from the baked vertex animation texture
+            m_WingVAT = true;
+            continue;
+        }
+        if (Arg == "--wing_vs_bench")
+        {
+            // Runs the wing rotation VS microbenchmark once at startup and logs the results
+            m_RunWingBench = true;
+            continue;
+        }
+        if (Arg == "--trajectory" && i + 1 < argc)
+        {
+            // Starts in trajectory playback mode; also the file that Record trajectory writes
+            m_TrajectoryPath = argv[++i];
+            m_SimulationMode = SIMULATION_MODE_PLAYBACK;
+            continue;
+        }
+        if (Arg == "--sim_thread" && i + 1 < argc)
+        {
+            // Evaluates CPU orbits on a separate thread at the given tick rate in Hz
+            m_SimThreadEnabled = true;
+            m_SimTickRate      = std::clamp(std::atoi(argv[++i]), 10, 240);
+            continue;
+        }
+        if (Arg == "--frames_in_flight" && i + 1 < argc)
+        {
+            m_FramesInFlight = std::clamp(std::atoi(argv[++i]), 1, static_cast<int>(kMaxFramesInFlight));
+            continue;
+        }
+        if (Arg == "--views" && i + 1 < argc)
+        {
+            // Split-screen views: the camera plus up to three map cameras, see VIEW_CAMERA
+            m_NumViews = std::clamp(std::atoi(argv[++i]), 1, static_cast<int>(kMaxViews));
+            continue;
+        }
+        if (Arg.compare(0, 13, "--regression_") == 0)
+        {
+            // Render regression harness: --regression_capture <png>, --regression_golden <png>,
+            // --regression_psnr <dB> and --regression_ssim <0..1>
+            if (i + 1 >= argc)
+            {
+                LOG_ERROR_MESSAGE(Arg, " requires a value");
+                return CommandLineStatus::Error;
+            }
+            const char* Value = argv[++i];
+
+            // Thresholds must be complete, finite numbers within [Min, Max]
+            auto ParseThreshold = [&](float Min, float Max, float& Threshold) {
+                char*       pEnd = nullptr;
+                const float f    = std::strtof(Value, &pEnd);
+                if (pEnd == Value || *pEnd != '\0' || !std::isfinite(f) || f < Min || f > Max)
+                {
+                    LOG_ERROR_MESSAGE(Arg, ": '", Value, "' is not a number in [", Min, ", ", Max, "]");
+                    return false;
+                }
+                Threshold = f;
+                return true;
+            };
+
+            if (Arg == "--regression_capture")
+                m_Regression.CapturePath = Value;
+            else if (Arg == "--regression_golden")
+                m_Regression.GoldenPath = Value;
+            else if (Arg == "--regression_psnr")
+            {
+                if (!ParseThreshold(0.0f, 1000.0f, m_Regression.MinPSNR))
+                    return CommandLineStatus::Error;
+            }
+            else if (Arg == "--regression_ssim")
+            {
+                if (!ParseThreshold(-1.0f, 1.0f, m_Regression.MinSSIM))
+                    return CommandLineStatus::Error;
+            }
+            else
+            {
+                LOG_ERROR_MESSAGE("Unknown regression option: ", Arg);
+                return CommandLineStatus::Error;
+            }
+            continue;
+        }
+        if (Arg.compare(0, PrefixLen, Prefix) != 0)
+            continue;
+        Arg.erase(0, PrefixLen);
+
+        std::string  Value;
+        const size_t Eq = Arg.find('=');
+        if (Eq != std::string::npos)
+        {
+            Value = Arg.substr(Eq + 1);
+            Arg.erase(Eq);
+        }
+        else if (i + 1 < argc)
+        {
+            Value = argv[++i];
+        }
+
+        if (Arg == "config")
+        {
+            if (!m_Swarm.LoadFromFile(Value.c_str()))
+                return CommandLineStatus::Error;
+            m_SwarmConfigPath = Value;
+        }
+        else if (!m_Swarm.SetValue(Arg, Value))
+        {
+            LOG_ERROR_MESSAGE("Unknown swarm option or invalid value: --swarm_", Arg, " '", Value, "'");
+            return CommandLineStatus::Error;
+        }
+    }
+    return CommandLineStatus::OK;
+}
+
+void Tutorial03_Texturing::UpdateUI()
+{
+    ALLOCATION_SCOPE("UpdateUI");
+
+    ImGui::SetNextWindowPos(ImVec2(10, 10), ImGuiCond_FirstUseEver);
+    if (ImGui::Begin("Settings", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+    {
+        ImGui::Text("Frame time: %.2f ms", m_FrameTime * 1000.0f);
+
+        // More frames in flight trade latency for throughput: the CPU can run further ahead
+        ImGui::SliderInt("Frames in flight", &m_FramesInFlight, 1, static_cast<int>(kMaxFramesInFlight));
+        ImGui::Text("CPU wait: %.2f ms", m_FramePacing.CPUWaitMs);
+        {
+            const LinearArena& Arena = m_FrameArenas[m_FrameSlot];
+            ImGui::Text("Frame arena: %.1f / %.1f KB, peak %.1f KB", Arena.GetUsed() / 1024.0, Arena.GetCapacity() / 1024.0, Arena.GetPeak() / 1024.0);
+            ImGui::Text("Heap allocations: %llu per frame", static_cast<unsigned long long>(m_FrameHeapAllocs));
+            if (AllocationTracker::IsEnabled() && ImGui::TreeNode("Allocations by scope"))
+            {
+                for (const AllocationTracker::ScopeStats* pScope = AllocationTracker::GetFirstScope(); pScope != nullptr; pScope = pScope->pNext)
+                {
+                    ImGui::Text("%s: %llu (%.1f KB)", pScope->Name, static_cast<unsigned long long>(pScope->NumAllocations.load()),
+                                pScope->BytesAllocated.load() / 1024.0);
+                }
+                ImGui::TreePop();
+            }
+        }
+        if (m_FrameEndQueries[0])
+            ImGui::Text("GPU idle: %.2f ms  (GPU frame %.2f ms)", m_FramePacing.GPUIdleMs, m_FramePacing.GPUFrameMs);
+
+        if (ImGui::CollapsingHeader("Swarm", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            // Resizing is incremental: existing instances are kept and GPU buffers grow geometrically
+            int NumInstances = static_cast<int>(m_Swarm.InstanceCount);
+            if (ImGui::SliderInt("Instances", &NumInstances, 0, 1 << 20, "%d", ImGuiSliderFlags_Logarithmic))
+                ResizeSwarm(static_cast<Uint32>(std::max(NumInstances, 0)));
+
+            ImGui::SliderFloat("Radius", &m_Swarm.Radius, 0.5f, 20.0f);
+            ImGui::SliderFloat("Speed", &m_Swarm.Speed, 0.0f, 3.0f);
+            ImGui::SliderFloat("Bob amplitude", &m_Swarm.BobAmp, 0.0f, 2.0f);
+            ImGui::SliderFloat("Bob frequency", &m_Swarm.BobFreq, 0.0f, 4.0f);
+            ImGui::SliderFloat("Wing factor", &m_Swarm.WingFactor, 0.0f, 20.0f);
+            ImGui::SliderFloat("Wing amplitude", &m_Swarm.WingAmp, 0.0f, 1.5f);
+
+            // Species only change the instance -> slice mapping, which the shaders compute from
+            // the instance index; the texture array always holds all of them
+            int NumSpecies = static_cast<int>(m_Swarm.NumSpecies);
+            if (ImGui::SliderInt("Species", &NumSpecies, 1, static_cast<int>(kMaxSpecies)))
+                m_Swarm.NumSpecies = static_cast<Uint32>(NumSpecies);
+
+            // Spawn layout. The seed in use is shown so that a random layout can be reproduced.
+            int Spawn = InstanceGenerator::FindDistribution(m_Swarm.Spawn);
+            if (ImGui::Combo("Spawn", &Spawn, "Uniform box\0Poisson disk\0Clustered\0File (spawn_file)\0\0"))
+                m_Swarm.Spawn = InstanceGenerator::GetDistributionName(static_cast<SPAWN_DISTRIBUTION>(Spawn));
+            if (Spawn == SPAWN_DISTRIBUTION_POISSON_DISK)
+            {
+                ImGui::SliderFloat("Min distance", &m_Swarm.MinDistance, 0.1f, 5.0f);
+                if (m_InstanceGenerator.GetDesc().Distribution == SPAWN_DISTRIBUTION_POISSON_DISK &&
+                    m_InstanceGenerator.GetMinDistance() < m_InstanceGenerator.GetDesc().MinDistance)
+                    ImGui::TextDisabled("Reduced to %.3f to fit the swarm", m_InstanceGenerator.GetMinDistance());
+            }
+            else if (Spawn == SPAWN_DISTRIBUTION_CLUSTERED)
+            {
+                int NumClusters = static_cast<int>(m_Swarm.NumClusters);
+                if (ImGui::SliderInt("Clusters", &NumClusters, 1, 64))
+                    m_Swarm.NumClusters = static_cast<Uint32>(std::max(NumClusters, 1));
+                ImGui::SliderFloat("Cluster radius", &m_Swarm.ClusterRadius, 0.0f, 10.0f);
+            }
+            int Seed = static_cast<int>(m_Swarm.Seed);
+            if (ImGui::InputInt("Seed (0 - random)", &Seed))
+                m_Swarm.Seed = static_cast<Uint32>(std::max(Seed, 0));
+            if (ImGui::Button("Respawn"))
+                ResetSimulation();
+            ImGui::SameLine();
+            ImGui::Text("Current seed: %u", static_cast<Uint32>(m_InstanceGenerator.GetDesc().Seed));
+
+            ImGui::Text("Config: %s", m_SwarmConfigPath.c_str());
+            if (ImGui::Button("Save"))
+                m_Swarm.SaveToFile(m_SwarmConfigPath.c_str());
+            ImGui::SameLine();
+            if (ImGui::Button("Load") && m_Swarm.LoadFromFile(m_SwarmConfigPath.c_str()))
+            {
+                const Uint32 NewCount = m_Swarm.InstanceCount;
+                m_Swarm.InstanceCount = m_InstanceCount;
+                if (NewCount != m_InstanceCount)
+                    ResizeSwarm(NewCount);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("HDR"))
+        {
+            if (m_ToneMapPSOs[TONEMAP_PASS_RESOLVE])
+            {
+                // The float sky is loaded on first use only; it is large
+                if (ImGui::Checkbox("HDR rendering (RGBA16F + tone mapping)", &m_HDR) && m_HDR && m_HDRSkySource.empty())
+                    LoadHDRSky();
+                ImGui::SliderFloat("Exposure compensation (EV)", &m_ExposureCompensation, -4.0f, 4.0f);
+                ImGui::SliderFloat("Adaptation speed", &m_ExposureAdaptSpeed, 0.1f, 10.0f);
+                if (m_HDR)
+                    ImGui::Text("Sky source: %s", m_HDRSkySource.c_str());
+            }
+            else
+            {
+                ImGui::TextDisabled("HDR unavailable on this device");
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Wings"))
+        {
+            ImGui::Combo("Transparency", &m_WingMode, "Opaque\0Alpha to coverage (4x MSAA)\0Weighted blended OIT\0\0");
+            if (m_WingMode != m_RenderedWingMode)
+                ImGui::TextDisabled("Mode unavailable, rendering opaque wings");
+            if (m_WingVAT)
+                ImGui::Text("Motion: baked VAT, %u frames x %u vertices", kWingVATFrames, Butterfly::ButterflyVertexCount);
+            else
+                ImGui::TextDisabled("Motion: hinge rotation (--wing_vat for the baked cycle)");
+
+            ImGui::Text("Butterfly permutations: %u PSOs, %u shaders compiled",
+                        m_ButterflyPermutations->GetNumPSOs(), m_ButterflyPermutations->GetNumShaders());
+            if (m_PendingReload.valid())
+                ImGui::TextDisabled("Recompiling shaders...");
+            else if (!m_ShaderReloadStatus.empty())
+                ImGui::TextDisabled("%s", m_ShaderReloadStatus.c_str());
+
+            if (ImGui::Button("Run wing VS benchmark"))
+                RunWingVSBenchmark();
+            if (m_WingBenchResult.BranchMs > 0 && m_WingBenchResult.BranchlessMs > 0)
+            {
+                const double NumVerts = static_cast<double>(kWingBenchInstances) * Butterfly::ButterflyVertexCount;
+                ImGui::Text("Branch + sin/cos: %.3f ms (%.2f Gverts/s)", m_WingBenchResult.BranchMs, NumVerts / m_WingBenchResult.BranchMs / 1e6);
+                ImGui::Text("Branch-free:      %.3f ms (%.2f Gverts/s, %.0f%% faster)", m_WingBenchResult.BranchlessMs,
+                            NumVerts / m_WingBenchResult.BranchlessMs / 1e6, (m_WingBenchResult.BranchMs / m_WingBenchResult.BranchlessMs - 1.0) * 100.0);
+            }
+
+            // Each mode is timed while it is active; switch between them to fill in the table
+            static const char* const ModeNames[] = {"Opaque", "Alpha to coverage", "Weighted OIT"};
+            const float              OpaqueMs    = m_WingModeFrameMs[WING_MODE_OPAQUE];
+            for (int Mode = 0; Mode < WING_MODE_COUNT; ++Mode)
+            {
+                const float Ms = m_WingModeFrameMs[Mode];
+                if (Ms <= 0.0f)
+                    ImGui::TextDisabled("%-18s not measured", ModeNames[Mode]);
+                else if (Mode != WING_MODE_OPAQUE && OpaqueMs > 0.0f)
+                    ImGui::Text("%-18s %.2f ms (%+.2f ms, %+.0f%%)", ModeNames[Mode], Ms, Ms - OpaqueMs, (Ms / OpaqueMs - 1.0f) * 100.0f);
+                else
+                    ImGui::Text("%-18s %.2f ms", ModeNames[Mode], Ms);
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Instance sort"))
+        {
+            if (m_RadixSort)
+            {
+                const bool TooMany = !CanSortInstances(m_InstanceCount);
+                ImGui::BeginDisabled(TooMany);
+                ImGui::Combo("Draw order", &m_InstanceSort, "Instance order\0Front to back\0Back to front\0\0");
+                ImGui::EndDisabled();
+                if (TooMany)
+                    ImGui::TextDisabled("Sorting supports up to %u instances, drawing in instance order", GPURadixSort::kMaxKeys);
+                else if (m_InstanceSort != INSTANCE_SORT_OFF && m_SimulationMode == SIMULATION_MODE_ANALYTIC_VS)
+                    ImGui::TextDisabled("Analytic VS mode always draws in instance order");
+
+                if (ImGui::Button("Run radix sort self-test"))
+                    RunRadixSortTest();
+                for (const RadixSortTestResult& Result : m_RadixSortTestResults)
+                {
+                    ImGui::Text("%8u keys: %s  GPU %.3f ms (%.0f Mkeys/s)  std::sort %.3f ms", Result.NumKeys,
+                                Result.Passed ? "OK  " : "FAIL", Result.GPUMs,
+                                Result.GPUMs > 0 ? Result.NumKeys / Result.GPUMs / 1000.0 : 0.0, Result.CPUMs);
+                }
+            }
+            else
+            {
+                ImGui::TextDisabled("GPU sorting requires compute shaders");
+            }
+        }
+
+        if (ImGui::CollapsingHeader("Views"))
+        {
+            ImGui::SliderInt("Views", &m_NumViews, 1, static_cast<int>(kMaxViews));
+            if (m_MultiViewSupported)
+                ImGui::Checkbox("Draw all views at once", &m_MultiViewDraw);
+            else
+                ImGui::TextDisabled("Single-pass multi-view needs geometry shaders and multiple viewports");
+
+            // Instances the GPU actually drew last frame, per view or once for all of them
+            ImGui::Checkbox("Cull draws per view", &m_CullDraws);
+            if (!m_DrawRangesValid)
+                ImGui::TextDisabled("Playback and flocking draw every instance");
+            static const char* const ViewNames[] = {"Camera", "Overhead map", "Side", "Orbit"};
+            const bool               OneDraw     = m_ViewDrawStats[kMaxViews].NumDraws > 0;
+            const Uint32             FirstSlot   = OneDraw ? kMaxViews : 0;
+            const Uint32             EndSlot     = OneDraw ? kMaxViews + 1 : static_cast<Uint32>(m_NumViews);
+            Uint32                   NumDrawn    = 0;
+            for (Uint32 Slot = FirstSlot; Slot < EndSlot; ++Slot)
+            {
+                const InstanceDrawStats& Stats = m_ViewDrawStats[Slot];
+                ImGui::Text("%-13s %u / %u instances, %u draws", Slot == kMaxViews ? "All views" : ViewNames[Slot],
+                            Stats.NumInstances, m_InstanceCount, Stats.NumDraws);
+                if (m_DrawRangesValid && Slot < kMaxViews)
+                    ImGui::Text("%-13s %u / %u clusters", "", m_ViewClustersVisible[Slot], static_cast<Uint32>(m_Clusters.size()));
+                NumDrawn += Stats.NumInstances;
+            }
+            const Uint32 NumFull = m_InstanceCount * (OneDraw ? 1u : static_cast<Uint32>(m_NumViews));
+            if (NumFull > 0)
+                ImGui::Text("Vertex work: %.0f%% of drawing every instance", 100.0 * NumDrawn / NumFull);
+        }
+
+        if (ImGui::CollapsingHeader("Sky"))
+        {
+            ImGui::Combo("Sky resolution", &m_SkyResolution, "Full\0Half\0Quarter\0\0");
+            if (m_SkyVRSSupported)
+                ImGui::Checkbox("Use variable-rate shading", &m_SkyUseVRS);
+            else
+                ImGui::TextDisabled("Variable-rate shading unsupported");
+
+            if (m_SkyStatsQuery && m_SkyStatsPixels > 0)
+            {
+                // Measured at the current size. PS cost scales with pixel count, so the
+                // 1080p and 4K figures are projections of the measured ratios, not measurements.
+                const double Pixels        = static_cast<double>(m_SkyStatsPixels);
+                const double SkyRatio      = static_cast<double>(m_SkyPSInvocations) / Pixels;
+                const double UpsampleRatio = static_cast<double>(m_SkyUpsamplePSInvocations) / Pixels;
+                ImGui::Text("Sky PS invocations: %llu (%.0f%% of full rate)", static_cast<unsigned long long>(m_SkyPSInvocations), SkyRatio * 100.0);
+                if (m_SkyUpsamplePSInvocations > 0)
+                    ImGui::Text("Upsample PS invocations: %llu (%.0f%%)", static_cast<unsigned long long>(m_SkyUpsamplePSInvocations), UpsampleRatio * 100.0);
+                ImGui::Text("  1080p (projected): %.2fM sky + %.2fM upsample vs %.2fM full", SkyRatio * 1920 * 1080 / 1e6, UpsampleRatio * 1920 * 1080 / 1e6, 1920 * 1080 / 1e6);
+                ImGui::Text("  4K (projected):    %.2fM sky + %.2fM upsample vs %.2fM full", SkyRatio * 3840 * 2160 / 1e6, UpsampleRatio * 3840 * 2160 / 1e6, 3840 * 2160 / 1e6);
+            }
+
+            if (m_SkyStreamer.IsOpen())
+            {
+                // Turning streaming off loads the full texture; turning it on releases it again
+                if (ImGui::Checkbox("Stream sky tiles", &m_SkyStreaming))
+                {
+                    if (m_SkyStreaming)
+                    {
+                        m_SkySRB.Release();
+                        m_SkySRV.Release();
+                    }
+                    else
+                    {
+                        LoadSkyTexture();
+                    }
+                }
+
+                const SkyTileFileHeader& Header  = m_SkyStreamer.GetHeader();
+                const double             CacheMB = double{m_SkyStreamer.GetNumSlots()} * m_SkyStreamer.GetTileBytes() / (1 << 20);
+                const double             FullMB  = double{Header.Width} * Header.Height * 4 * 4 / 3 / (1 << 20);
+                ImGui::Text("Cache: %u / %u tiles, %.1f MB (full texture %.1f MB)", m_SkyStreamer.GetNumResidentTiles(),
+                            m_SkyStreamer.GetNumSlots(), CacheMB, FullMB);
+                ImGui::Text("Requested: %u tiles, uploaded: %u", m_SkyStreamer.GetNumRequestedTiles(), m_SkyTilesUploaded);
+            }
+            else
+            {
+                ImGui::TextDisabled("Tile streaming unavailable");
+            }
+        }
+
+        // Flocking is the last mode and is only listed where compute shaders are available
+        const int NumModes = m_pDevice->GetDeviceInfo().Features.ComputeShaders ? 4 : 3;
+        if (ImGui::Combo("Simulation", &m_SimulationMode, "Orbits (CPU)\0Orbits (analytic VS)\0Trajectory playback\0Flocking (GPU)\0\0", NumModes))
+            ResetSimulation();
+
+        if (m_SimulationMode == SIMULATION_MODE_ORBITS)
+        {
+            ImGui::Checkbox("Simulation thread", &m_SimThreadEnabled);
+            if (m_SimThreadEnabled)
+            {
+                ImGui::SliderInt("Tick rate", &m_SimTickRate, 10, 240, "%d Hz");
+                const SwarmSimThread::Stats SimStats = m_SimThread.GetStats();
+                ImGui::Text("Tick: %.2f ms, %.1f ticks/s", SimStats.TickMs, SimStats.TicksPerSec);
+                ImGui::Text("Ticks: %llu, dropped %llu", static_cast<unsigned long long>(SimStats.NumTicks),
+                            static_cast<unsigned long long>(SimStats.DroppedTicks));
+            }
+            else
+            {
+                ImGui::Checkbox("Lazy instance updates", &m_LazyInstanceUpdates);
+            }
+            ImGui::Text("Updated: %u / %u instances", m_NumInstancesUpdated, m_InstanceCount);
+            ImGui::Text("Visible clusters: %u / %u", m_NumClustersVisible, static_cast<Uint32>(m_Clusters.size()));
+
+            const Uint64 Uploaded = m_UploadStats.UpdateBufferBytes + m_UploadStats.StagedBytes;
+            ImGui::Text("Uploaded: %.1f / %.1f KB (%.0f%%)", Uploaded / 1024.0, m_UploadStats.FullUploadBytes / 1024.0,
+                        m_UploadStats.FullUploadBytes > 0 ? 100.0 * Uploaded / m_UploadStats.FullUploadBytes : 0.0);
+            ImGui::Text("  UpdateBuffer: %u calls, %.1f KB", m_UploadStats.NumUpdateBufferCalls, m_UploadStats.UpdateBufferBytes / 1024.0);
+            ImGui::Text("  Staged copy:  %u calls, %.1f KB", m_UploadStats.NumStagedCopies, m_UploadStats.StagedBytes / 1024.0);
+
+            // Recording runs in the background; the result is logged by RecordTrajectory()
+            if (m_PendingRecord.valid() && m_PendingRecord.wait_for(std::chrono::seconds{0}) == std::future_status::ready)
+                m_PendingRecord.get();
+            if (m_PendingRecord.valid())
+            {
+                const Uint32 Progress = m_RecordProgress.load();
+                ImGui::ProgressBar(m_RecordNumFrames > 0 ? static_cast<float>(Progress) / m_RecordNumFrames : 1.0f, ImVec2{0, 0});
+            }
+            else if (ImGui::Button("Record trajectory"))
+            {
+                StartTrajectoryRecording(kRecordSeconds);
+            }
+            ImGui::SameLine();
+            ImGui::Text("%.0f s to %s", kRecordSeconds, m_TrajectoryPath.c_str());
+        }
+
+        if (m_SimulationMode == SIMULATION_MODE_PLAYBACK)
+        {
+            const SwarmTrajectoryHeader& Header = m_Trajectory.GetHeader();
+            ImGui::Text("Trajectory: %s", m_TrajectoryPath.c_str());
+            ImGui::Text("Frame %u / %u at %.0f fps, %u instances", m_PlaybackFrame, Header.NumFrames, Header.FrameRate, Header.NumInstances);
+            ImGui::Text("Late frames: %u", m_PlaybackLateFrames);
+        }
+
+        if (m_SimulationMode == SIMULATION_MODE_FLOCKING_GPU)
+        {
+            ImGui::SliderFloat("Separation", &m_FlockConsts.SeparationWeight, 0.0f, 5.0f);
+            ImGui::SliderFloat("Alignment", &m_FlockConsts.AlignmentWeight, 0.0f, 5.0f);
+            ImGui::SliderFloat("Cohesion", &m_FlockConsts.CohesionWeight, 0.0f, 5.0f);
+            ImGui::SliderFloat("Home pull", &m_FlockConsts.HomeWeight, 0.0f, 1.0f);
+
+            if (ImGui::Checkbox("Compare with CPU reference", &m_FlockCompare))
+                ResetSimulation();
+            if (m_FlockCompare)
+            {
+                ImGui::Text("Agents: %u, seed: %u", m_InstanceCount, kFlockCompareSeed);
+                ImGui::Text("Max error: pos %.2e, vel %.2e", m_FlockMaxPosError, m_FlockMaxVelError);
+            }
+        }
+    }
+    ImGui::End();
+}
+
+void Tutorial03_Texturing::BeginFrame()
+{
+    // 1) Frame N reuses the slot of frame N - m_FramesInFlight. Also wait for that
+    //    frame itself: after the frame count is lowered, the slot may have been used
+    //    more recently than that, but never less.
+    const Uint64 Frame     = m_FrameFenceValue + 1;
+    const Uint64 FIF       = static_cast<Uint64>(m_FramesInFlight);
+    m_FrameSlot            = static_cast<Uint32>(Frame % FIF);
+    const Uint64 WaitValue = std::max(m_SlotFenceValues[m_FrameSlot], Frame > FIF ? Frame - FIF : Uint64{0});
+
+    float CPUWaitMs = 0;
+    if (m_FrameFence->GetCompletedValue() < WaitValue)
+    {
+        const auto WaitStart = std::chrono::high_resolution_clock::now();
+        // The signal may still be sitting in the context's command buffer
+        m_pImmediateContext->Flush();
+        m_FrameFence->Wait(WaitValue);
+        CPUWaitMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - WaitStart).count();
+    }
+
+    // The slot's previous frame is done with its transient data
+    m_FrameArenas[m_FrameSlot].Reset();
+
+    // Heap allocations made by the render thread during the previous frame. The test's
+    // own bookkeeping happens before the new base is taken, so it is not counted.
+    m_FrameHeapAllocs = AllocationTracker::GetThreadStats().NumAllocations - m_FrameHeapAllocsBase;
+    if (m_FrameFenceValue == kAllocWarmUpFrames)
+        LOG_INFO_MESSAGE("Steady-state frame: ", m_FrameHeapAllocs, " heap allocations on the render thread");
+    if (m_ZeroAllocTest.NumFrames > 0)
+        UpdateZeroAllocTest();
+    m_FrameHeapAllocsBase = AllocationTracker::GetThreadStats().NumAllocations;
+
+    // 2) The frame that used this slot has finished, so its timestamps are available
+    //    without stalling. GPU idle is the gap between the end of the previous frame's
+    //    work and the start of this one's.
+    float GPUIdleMs  = m_FramePacing.GPUIdleMs;
+    float GPUFrameMs = m_FramePacing.GPUFrameMs;
+    if (m_SlotHasTimestamps[m_FrameSlot])
+    {
+        QueryDataTimestamp Begin, End;
+        if (m_FrameBeginQueries[m_FrameSlot]->GetData(&Begin, sizeof(Begin)) &&
+            m_FrameEndQueries[m_FrameSlot]->GetData(&End, sizeof(End)) &&
+            Begin.Frequency != 0)
+        {
+            const double TicksToMs = 1000.0 / static_cast<double>(Begin.Frequency);
+            GPUFrameMs             = static_cast<float>((End.Counter - Begin.Counter) * TicksToMs);
+            if (m_LastGPUFrameEnd != 0)
+                GPUIdleMs = Begin.Counter > m_LastGPUFrameEnd ? static_cast<float>((Begin.Counter - m_LastGPUFrameEnd) * TicksToMs) : 0.0f;
+            m_LastGPUFrameEnd = End.Counter;
+        }
+        m_SlotHasTimestamps[m_FrameSlot] = false;
+    }
+
+    constexpr float Smoothing = 0.1f;
+    m_FramePacing.CPUWaitMs += (CPUWaitMs - m_FramePacing.CPUWaitMs) * Smoothing;
+    m_FramePacing.GPUIdleMs += (GPUIdleMs - m_FramePacing.GPUIdleMs) * Smoothing;
+    m_FramePacing.GPUFrameMs += (GPUFrameMs - m_FramePacing.GPUFrameMs) * Smoothing;
+}
+
+void Tutorial03_Texturing::UpdateZeroAllocTest()
+{
+    // m_FrameHeapAllocs covers frame m_FrameFenceValue
+    const Uint64 Frame = m_FrameFenceValue;
+    if (Frame < kAllocWarmUpFrames)
+        return;
+
+    // 1) Warm-up is over: remember where every scope stands
+    if (Frame == kAllocWarmUpFrames)
+    {
+        for (const AllocationTracker::ScopeStats* pScope = AllocationTracker::GetFirstScope(); pScope != nullptr; pScope = pScope->pNext)
+            m_ZeroAllocTest.ScopeBase.emplace_back(pScope, pScope->NumAllocations.load());
+        return;
+    }
+
+    // 2) Steady-state frames
+    m_ZeroAllocTest.NumAllocations += m_FrameHeapAllocs;
+    if (m_FrameHeapAllocs != 0)
+        ++m_ZeroAllocTest.NumFailedFrames;
+    if (Frame < kAllocWarmUpFrames + m_ZeroAllocTest.NumFrames)
+        return;
+
+    // 3) Report the scopes that allocated and quit with the result
+    if (m_ZeroAllocTest.NumFailedFrames == 0)
+    {
+        LOG_INFO_MESSAGE("Zero-allocation test: passed, no heap allocations in ", m_ZeroAllocTest.NumFrames, " frames",
+                         AllocationTracker::IsMallocInterposed() ? "" : " (operator new only)");
+        RequestExit(true);
+        return;
+    }
+
+    LOG_ERROR_MESSAGE("Zero-allocation test: ", m_ZeroAllocTest.NumAllocations, " heap allocations in ",
+                      m_ZeroAllocTest.NumFailedFrames, " of ", m_ZeroAllocTest.NumFrames, " frames");
+    for (const AllocationTracker::ScopeStats* pScope = AllocationTracker::GetFirstScope(); pScope != nullptr; pScope = pScope->pNext)
+    {
+        Uint64 Base = 0;
+        for (const auto& ScopeBase : m_ZeroAllocTest.ScopeBase)
+        {
+            if (ScopeBase.first == pScope)
+                Base = ScopeBase.second;
+        }
+        if (const Uint64 NumAllocs = pScope->NumAllocations.load() - Base)
+            LOG_ERROR_MESSAGE("  ", pScope->Name, ": ", NumAllocs);
+    }
+    RequestExit(false);
+}
+
+void Tutorial03_Texturing::EndFrame()
+{
+    if (m_FrameEndQueries[m_FrameSlot])
+    {
+        m_pImmediateContext->EndQuery(m_FrameEndQueries[m_FrameSlot]);
+        m_SlotHasTimestamps[m_FrameSlot] = true;
+    }
+
+    m_pImmediateContext->EnqueueSignal(m_FrameFence, ++m_FrameFenceValue);
+    m_SlotFenceValues[m_FrameSlot] = m_FrameFenceValue;
+}
+
+void Tutorial03_Texturing::Render()
+{
+    ALLOCATION_SCOPE("Render");
+
+    if (m_FrameBeginQueries[m_FrameSlot])
+        m_pImmediateContext->EndQuery(m_FrameBeginQueries[m_FrameSlot]);
+
+    // Everything below reads the view, timing and swarm state from this copy, and the
+    // instances from the version Update published last, held until EndFrame
+    m_RenderFrame      = m_FrameState.Read();
+    m_pRenderInstances = m_InstanceFrames.Acquire(m_InstanceReader);
+
+    // Swap in recompiled shaders before anything is recorded for this frame
+    UpdateShaderHotReload();
+
+    // 0) Bring the instance buffer up to date: either upload the CPU-built
+    //    transforms or let the flocking CS write them in place
+    if (m_SimulationMode == SIMULATION_MODE_FLOCKING_GPU)
+    {
+        DispatchFlocking(m_RenderFrame.FrameTime);
+    }
+    else if (m_SimulationMode == SIMULATION_MODE_ORBITS || m_SimulationMode == SIMULATION_MODE_PLAYBACK)
+    {
+        UploadDirtyInstances();
+    }
+    // SIMULATION_MODE_ANALYTIC_VS: nothing to do, the VS evaluates the motion from m_PathTime
 
-    // 2) Clear color & depth. Optionally convert clear color to sRGB
+    // Sorting reads the final transforms, so it runs after they are written. The analytic
+    // VS has no transforms to sort and always draws in instance order.
+    bool Sorted = m_InstanceSort != INSTANCE_SORT_OFF && CanSortInstances(m_RenderFrame.NumInstances) && m_SimulationMode != SIMULATION_MODE_ANALYTIC_VS;
+    if (Sorted)
+        Sorted = SortInstances();
+
+    // 1) Acquire back buffer and depth-stencil views. In HDR mode the scene goes
+    //    to the RGBA16F target and reaches the back buffer through ToneMapHDR().
+    const bool          HDR            = m_HDR && m_HDRColor;
+    const RENDER_TARGET Target         = HDR ? RENDER_TARGET_HDR : RENDER_TARGET_BACK_BUFFER;
+    auto*               pBackBufferRTV = m_RegressionColor ? m_RegressionColor->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET) : m_pSwapChain->GetCurrentBackBufferRTV();
+    auto*               pRTV           = HDR ? m_HDRColor->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET) : pBackBufferRTV;
+    auto*               pDSV           = m_RegressionDepth ? m_RegressionDepth->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL) : m_pSwapChain->GetDepthBufferDSV();
+
+    // Alpha to coverage renders the scene into an MSAA twin of the target and
+    // resolves it in step 5. Unsupported modes fall back to opaque wings.
+    const RENDER_TARGET MSAATarget  = HDR ? RENDER_TARGET_HDR_MSAA : RENDER_TARGET_BACK_BUFFER_MSAA;
+    const bool          MSAA        = m_WingMode == WING_MODE_ALPHA_TO_COVERAGE && IsTargetSupported(MSAATarget) && PrepareMSAATargets(GetTargetFormat(MSAATarget));
+    const bool          OIT         = m_WingMode == WING_MODE_WEIGHTED_OIT && m_OITCompositePSO[Target];
+    const RENDER_TARGET SceneTarget = MSAA ? MSAATarget : Target;
+    auto*               pSceneRTV   = MSAA ? m_MSAAColor->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET) : pRTV;
+    auto*               pSceneDSV   = MSAA ? m_MSAADepth->GetDefaultView(TEXTURE_VIEW_DEPTH_STENCIL) : pDSV;
+    m_RenderedWingMode              = MSAA ? WING_MODE_ALPHA_TO_COVERAGE : (OIT ? WING_MODE_WEIGHTED_OIT : WING_MODE_OPAQUE);
+    m_pImmediateContext->SetRenderTargets(1, &pSceneRTV, pSceneDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+    // 2) Clear color & depth. Optionally convert clear color to sRGB (the HDR target is linear)
     float4 Clear = {0.35f, 0.35f, 0.35f, 1.0f};
-    if (m_ConvertPSOutputToGamma)
+    if (m_ConvertPSOutputToGamma && !HDR)
     {
         // Linear→Gamma since some platforms lack hardware gamma-correct
         Clear = float4{LinearToSRGB(float3{Clear.r, Clear.g, Clear.b}), Clear.a};
     }
     m_pImmediateContext->ClearRenderTarget(
-        pRTV, Clear.Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        pSceneRTV, Clear.Data(), RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     m_pImmediateContext->ClearDepthStencil(
-        pDSV, CLEAR_DEPTH_FLAG, /* Depth = */ 1.0f, /* Stencil = */ 0,
+        pSceneDSV, CLEAR_DEPTH_FLAG, /* Depth = */ 1.0f, /* Stencil = */ 0,
         RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
     // --------------------------------------------------------------------------
-    // 3) Draw sky sphere (full-screen triangle) with its own PSO & SRB
+    // 3) Draw sky sphere (full-screen triangle per view) with its own PSO & SRB
     // --------------------------------------------------------------------------
     {
-        // Remove translation from view matrix for sky so it always surrounds camera
-        float4x4 ViewNoPos = m_Camera.GetViewMatrix();
-        ViewNoPos._41 = ViewNoPos._42 = ViewNoPos._43 = 0;
+        // Streaming: upload newly loaded tiles before the draw that samples them
+        if (m_SkyStreaming)
+            UpdateSkyStreaming();
 
-        // Compute inverse of (view × projection) and upload to CB
-        float4x4            InvRotProj = (ViewNoPos * m_Camera.GetProjMatrix()).Inverse();
-        MapHelper<float4x4> CB(m_pImmediateContext, m_SkyCB, MAP_WRITE, MAP_FLAG_DISCARD);
-        *CB = InvRotProj;
+        // Reduced shading rate: either per-draw VRS straight into the target, or an
+        // offscreen target at 1/2 or 1/4 resolution that is upsampled afterwards.
+        // The offscreen target is always single-sample.
+        const bool          UseVRS    = m_SkyResolution != SKY_RESOLUTION_FULL && m_SkyUseVRS && m_SkyVRSSupported;
+        const bool          UseLowRes = m_SkyResolution != SKY_RESOLUTION_FULL && !UseVRS;
+        const RENDER_TARGET SkyTarget = UseLowRes ? Target : SceneTarget;
+        ITextureView*       pSkyRTV   = UseLowRes ? GetSkyLowResRTV(pRTV->GetTexture()->GetDesc().Format) : pSceneRTV;
+        m_pImmediateContext->SetRenderTargets(1, &pSkyRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        if (UseVRS)
+        {
+            const SHADING_RATE Rate = m_SkyResolution == SKY_RESOLUTION_QUARTER && m_SkyVRS4x4Supported ? SHADING_RATE_4X4 : SHADING_RATE_2X2;
+            m_pImmediateContext->SetShadingRate(Rate, SHADING_RATE_COMBINER_PASSTHROUGH, SHADING_RATE_COMBINER_PASSTHROUGH);
+        }
+        if (m_SkyStatsQuery)
+            m_SkyStatsQuery->Begin(m_pImmediateContext);
 
-        // Set sky pipeline & resources, then draw full-screen tri
-        m_pImmediateContext->SetPipelineState(m_SkyPSO);
-        m_pImmediateContext->CommitShaderResources(m_SkySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        // Set sky pipeline & resources, then draw full-screen tri. A float sky
+        // source, when present, replaces the 8-bit sky in HDR mode.
+        if (HDR && m_HDRSkySRB)
+        {
+            m_pImmediateContext->SetPipelineState(m_SkyPSO[SkyTarget]);
+            m_pImmediateContext->CommitShaderResources(m_HDRSkySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
+        else
+        {
+            m_pImmediateContext->SetPipelineState(m_SkyStreaming ? m_SkyStreamPSO[SkyTarget] : m_SkyPSO[SkyTarget]);
+            m_pImmediateContext->CommitShaderResources(m_SkyStreaming ? m_SkyStreamSRB : m_SkySRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
         DrawAttribs DA;
         DA.NumVertices = 3;
         DA.Flags       = DRAW_FLAG_VERIFY_ALL;
-        m_pImmediateContext->Draw(DA);
+        for (Uint32 View = 0; View < m_RenderFrame.NumViews; ++View)
+        {
+            // Remove translation from view matrix for sky so it always surrounds camera
+            float4x4 ViewNoPos = m_RenderFrame.Views[View].View;
+            ViewNoPos._41 = ViewNoPos._42 = ViewNoPos._43 = 0;
+
+            // Compute inverse of (view × projection) and upload to CB
+            {
+                MapHelper<float4x4> CB(m_pImmediateContext, m_SkyCB, MAP_WRITE, MAP_FLAG_DISCARD);
+                *CB = (ViewNoPos * m_RenderFrame.Views[View].Proj).Inverse();
+            }
+
+            // The low-resolution target keeps the view layout, so one upsample covers every view
+            const Viewport VP = GetViewport(View, pSkyRTV);
+            m_pImmediateContext->SetViewports(1, &VP, 0, 0);
+            m_pImmediateContext->Draw(DA);
+        }
+
+        // The sky query covers the sky draws only; the upsample has its own below
+        QueryDataPipelineStatistics Stats;
+        if (m_SkyStatsQuery && m_SkyStatsQuery->End(m_pImmediateContext, &Stats, sizeof(Stats)))
+        {
+            m_SkyPSInvocations = Stats.PSInvocations;
+            m_SkyStatsPixels   = Uint64{pRTV->GetTexture()->GetDesc().Width} * pRTV->GetTexture()->GetDesc().Height;
+        }
+
+        if (UseVRS)
+            m_pImmediateContext->SetShadingRate(SHADING_RATE_1X1, SHADING_RATE_COMBINER_PASSTHROUGH, SHADING_RATE_COMBINER_PASSTHROUGH);
+        if (UseLowRes)
+        {
+            // Binding the target resets the viewport to all of it
+            m_pImmediateContext->SetRenderTargets(1, &pSceneRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            m_pImmediateContext->SetPipelineState(m_SkyUpsamplePSO[SceneTarget]);
+            m_pImmediateContext->CommitShaderResources(m_SkyUpsampleSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            if (m_SkyUpsampleStatsQuery)
+                m_SkyUpsampleStatsQuery->Begin(m_pImmediateContext);
+            m_pImmediateContext->Draw(DA);
+            if (m_SkyUpsampleStatsQuery && m_SkyUpsampleStatsQuery->End(m_pImmediateContext, &Stats, sizeof(Stats)))
+                m_SkyUpsamplePSInvocations = Stats.PSInvocations;
+        }
+        else
+        {
+            m_SkyUpsamplePSInvocations = 0;
+        }
+
+        if (m_SkyStreaming)
+            ReadBackSkyFeedback();
+
+        // Butterflies are depth tested
+        m_pImmediateContext->SetRenderTargets(1, &pSceneRTV, pSceneDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
     }
 
     // --------------------------------------------------------------------------
-    // 4) Draw all butterflies (CPU-instanced): bind mesh VB/IB, PSO, SRB, then loop draw
+    // 4) Draw all butterflies (GPU-instanced): bind mesh VB/IB, PSO, SRB, then one draw
     // --------------------------------------------------------------------------
     {
-        // Bind butterfly mesh vertex buffer (slot 0)
-        Uint64   offset = 0;
-        IBuffer* VBs[]  = {m_ButterflyVertexBuffer};
+        // Bind butterfly mesh vertex buffer (slot 0) and the instance index stream (slot 1)
+        Uint64   offsets[] = {0, 0};
+        IBuffer* VBs[]     = {m_ButterflyVertexBuffer, m_InstanceIndexBuffer};
         m_pImmediateContext->SetVertexBuffers(
-            /*StartSlot=*/0, /*NumBuffers=*/1, VBs, &offset,
+            /*StartSlot=*/0, /*NumBuffers=*/_countof(VBs), VBs, offsets,
             RESOURCE_STATE_TRANSITION_MODE_TRANSITION,
             SET_VERTEX_BUFFERS_FLAG_RESET);
 
@@ -461,58 +3690,428 @@ void Tutorial03_Texturing::Render()
             m_ButterflyIndexBuffer, /*ByteOffset=*/0,
             RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
 
-        // Set butterfly pipeline & commit texture SRV
-        m_pImmediateContext->SetPipelineState(m_pPSO);
-        m_pImmediateContext->CommitShaderResources(m_SRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        // Set butterfly pipeline & commit texture SRV. Weighted blended OIT first
+        // accumulates into its own targets, tested against the opaque depth.
+        // Several views use the MULTI_VIEW pipeline where it is available.
+        const bool      Analytic  = m_SimulationMode == SIMULATION_MODE_ANALYTIC_VS;
+        const bool      MultiView = m_RenderFrame.NumViews > 1 && m_MultiViewDraw && m_MultiViewSupported;
+        IPipelineState* pPSO      = m_ButterflyPermutations->Get(GetButterflyKey(SceneTarget, Analytic, Sorted, OIT, MultiView));
+        if (OIT)
+        {
+            PrepareOITTargets();
+            ITextureView* pOITRTVs[] = {m_OITAccum->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET),
+                                        m_OITReveal->GetDefaultView(TEXTURE_VIEW_RENDER_TARGET)};
+            m_pImmediateContext->SetRenderTargets(_countof(pOITRTVs), pOITRTVs, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+            const float AccumClear[]  = {0.0f, 0.0f, 0.0f, 0.0f};
+            const float RevealClear[] = {1.0f, 1.0f, 1.0f, 1.0f};
+            m_pImmediateContext->ClearRenderTarget(pOITRTVs[0], AccumClear, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            m_pImmediateContext->ClearRenderTarget(pOITRTVs[1], RevealClear, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
+        if (pPSO != nullptr)
+        {
+            IShaderResourceBinding* pSRB = MultiView ? GetMultiViewSRB(pPSO, Analytic, Sorted) :
+                                                       (Analytic ? m_AnalyticSRB : (Sorted ? m_SortedSRB : m_SRB)).RawPtr();
+            m_pImmediateContext->SetPipelineState(pPSO);
+            m_pImmediateContext->CommitShaderResources(pSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+            // Issue instanced draws for the visible clusters of every view
+            DrawButterflies(MultiView, Sorted, pSceneRTV);
+            m_pImmediateContext->SetViewports(1, nullptr, 0, 0);
+        }
 
-        // Issue draws for each instance
-        DrawButterflies();
+        // OIT: normalize the accumulation and blend it over the scene in one full-screen pass
+        if (OIT)
+        {
+            m_pImmediateContext->SetRenderTargets(1, &pRTV, nullptr, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+            m_pImmediateContext->SetPipelineState(m_OITCompositePSO[Target]);
+            m_pImmediateContext->CommitShaderResources(m_OITCompositeSRB, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+
+            DrawAttribs DA;
+            DA.NumVertices = 3;
+            DA.Flags       = DRAW_FLAG_VERIFY_ALL;
+            m_pImmediateContext->Draw(DA);
+            m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+        }
     }
-}
 
-float4x4 Tutorial03_Texturing::MakeWorld(const float3& Pos,
-                                         const float3& Forward,
-                                         const float3& Up)
-{
-    // Compute orthonormal basis
-    float3 Z = normalize(-Forward);     // Backward direction
-    float3 X = normalize(cross(Up, Z)); // Right direction
-    float3 Y = cross(Z, X);             // True up
+    // 5) Resolve the MSAA scene into the single-sample target
+    if (MSAA)
+    {
+        ResolveTextureSubresourceAttribs ResolveAttribs;
+        ResolveAttribs.SrcTextureTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        ResolveAttribs.DstTextureTransitionMode = RESOURCE_STATE_TRANSITION_MODE_TRANSITION;
+        m_pImmediateContext->ResolveTextureSubresource(m_MSAAColor, pRTV->GetTexture(), ResolveAttribs);
+        m_pImmediateContext->SetRenderTargets(1, &pRTV, pDSV, RESOURCE_STATE_TRANSITION_MODE_TRANSITION);
+    }
 
-    // Pack into row-major 4×4 (last row = translation)
-    return float4x4(
-        X.x, Y.x, Z.x, 0.0f,
-        X.y, Y.y, Z.y, 0.0f,
-        X.z, Y.z, Z.z, 0.0f,
-        Pos.x, Pos.y, Pos.z, 1.0f);
+    // 6) Resolve HDR to the back buffer
+    if (HDR)
+        ToneMapHDR(pBackBufferRTV);
+
+    // 7) Regression mode: read the frame back, check it and exit
+    if (m_RegressionColor)
+        FinishRegressionFrame();
+
+    m_InstanceFrames.Release(m_InstanceReader);
+    m_pRenderInstances = nullptr;
+
+    EndFrame();
 }
 
 void Tutorial03_Texturing::Update(double CurrTime, double ElapsedTime)
 {
+    ALLOCATION_SCOPE("Update");
+
+    // A test mode finished during the previous frame: shut down in order and leave
+    // with its verdict before recording anything else
+    if (m_ExitCode >= 0)
+    {
+        StopWorkers();
+        m_pImmediateContext->Flush();
+        m_pImmediateContext->WaitForIdle();
+        std::exit(m_ExitCode);
+    }
+
+    // Wait until the slot this frame writes to is free. Everything below runs while
+    // the GPU is still busy with up to m_FramesInFlight - 1 earlier frames.
+    BeginFrame();
+
     // Handle UI and internal timers
     SampleBase::Update(CurrTime, ElapsedTime);
+    UpdateUI();
+
+    // The regression frame is rendered at kRegressionTime from the initial camera
+    if (m_Regression.IsEnabled())
+        ElapsedTime = 0;
+
+    if (m_WingVAT && m_WingVATDesc.FlapAmp != m_Swarm.WingAmp)
+        BakeWingVAT();
 
     // Move the camera based on user input
     m_Camera.Update(m_InputController, static_cast<float>(ElapsedTime));
 
     // Advance global animation time (wing flop, bob, orbits)
-    m_PathTime += static_cast<float>(ElapsedTime);
+    m_FrameTime = static_cast<float>(ElapsedTime);
 
-    // Recompute butterfly instance transforms
-    GenerateInstanceData(m_PathTime);
+    // ElapsedTime covers the previous frame, so attribute it to the wing mode that frame used
+    float& ModeMs = m_WingModeFrameMs[m_RenderedWingMode];
+    ModeMs        = ModeMs > 0.0f ? ModeMs + (m_FrameTime * 1000.0f - ModeMs) * 0.05f : m_FrameTime * 1000.0f;
+    m_PathTime += m_FrameTime;
+    ++m_FrameIndex;
+
+    // Compute combined View×Proj of every view once per frame
+    ComputeViews();
+    m_WorldViewProj = m_Views[VIEW_CAMERA_MAIN].ViewProj;
+
+    PublishFrameState();
+
+    // Recompute butterfly instance transforms (flocking does this on the GPU in Render).
+    // Needs the view-projections above for cluster culling. The simulation thread only
+    // runs while it is needed.
+    const bool SimThread = m_SimThreadEnabled && m_SimulationMode == SIMULATION_MODE_ORBITS && !m_Regression.IsEnabled();
+    if (!SimThread)
+        m_SimThread.Stop();
 
-    // Compute combined View×Proj once per frame
-    // Surface pre-transform handles display rotation/orientation
-    const float4x4 SurfT = GetSurfacePretransformMatrix(float3{0, 0, 1});
-    m_WorldViewProj      = m_Camera.GetViewMatrix() *
-        SurfT *
-        m_Camera.GetProjMatrix();
+    // Per-view visible clusters select both the instances to refresh and the ranges to draw
+    CullClusters();
+
+    if (m_SimulationMode == SIMULATION_MODE_ORBITS)
+    {
+        if (SimThread)
+            UpdateSimThread();
+        else
+            GenerateInstanceData(m_PathTime);
+    }
+    else if (m_SimulationMode == SIMULATION_MODE_PLAYBACK)
+    {
+        UpdatePlayback(m_FrameTime);
+    }
+
+    PublishInstances();
+}
+
+void Tutorial03_Texturing::PublishFrameState()
+{
+    FrameState State;
+    State.ViewProj  = m_WorldViewProj;
+    State.View      = m_Views[VIEW_CAMERA_MAIN].View;
+    State.Proj      = m_Views[VIEW_CAMERA_MAIN].Proj;
+    State.NearZ     = m_Camera.GetProjAttribs().NearClipPlane;
+    State.FarZ      = m_Camera.GetProjAttribs().FarClipPlane;
+    State.PathTime  = m_PathTime;
+    State.FrameTime = m_FrameTime;
+    State.NumViews  = static_cast<Uint32>(m_NumViews);
+    State.Views     = m_Views;
+
+    State.NumInstances = m_InstanceCount;
+    State.NumSpecies   = std::min(std::max(m_Swarm.NumSpecies, 1u), kMaxSpecies); // the shaders divide by it
+    State.Orbit        = GetOrbitParams();
+    State.WingFactor   = m_Swarm.WingFactor;
+    State.WingAmp      = m_Swarm.WingAmp;
+    m_FrameState.Write(State);
+}
+
+void Tutorial03_Texturing::PublishInstances()
+{
+    ALLOCATION_SCOPE("PublishInstances");
+
+    // 1) Once Render has uploaded the last version, its ranges are on the GPU. Until then
+    //    they are sent again with this frame's, so a version Render skips loses nothing.
+    if (m_InstanceEpochUploaded.load(std::memory_order_acquire) == m_InstanceEpochPublished)
+        m_InstancePending.Clear();
+    m_InstancePending.Resize(m_InstanceCount);
+    m_InstanceDirty.ForEachRange([&](Uint32 First, Uint32 Count) {
+        m_InstancePending.MarkDirty(First, Count);
+    });
+    m_InstanceDirty.Clear();
+
+    // 2) Pack the pending ranges into the version, so it only holds what Render uploads.
+    //    Instances the current mode does not evaluate have no transforms to send.
+    InstanceFrame& Frame     = m_InstanceFrames.BeginWrite();
+    const Uint32   NumWorlds = static_cast<Uint32>(m_InstanceWorlds.size());
+    Frame.Worlds.clear();
+    Frame.DirtyRanges.clear();
+    m_InstancePending.ForEachRange([&](Uint32 First, Uint32 Count) {
+        if (First >= NumWorlds)
+            return;
+        Count = std::min(Count, NumWorlds - First);
+        Frame.Worlds.insert(Frame.Worlds.end(), m_InstanceWorlds.begin() + First, m_InstanceWorlds.begin() + First + Count);
+        Frame.DirtyRanges.push_back({First, Count});
+    });
+
+    // 3) Per-view draw ranges from CullClusters
+    Frame.DrawRanges      = m_ViewDrawRanges;
+    Frame.DrawRangesValid = m_DrawRangesValid;
+
+    m_InstanceFrames.Publish();
+    m_InstanceEpochPublished = m_InstanceFrames.GetEpoch();
+}
+
+bool Tutorial03_Texturing::RunSimulationStressTest(Uint32 NumReaders, double Seconds)
+{
+    // Drives the exchanges the application itself uses. This thread plays Update: views,
+    // frame state, the simulation thread and instance publishing. The readers play a
+    // renderer on another thread and check that whatever they get is consistent.
+    // Meant to be run under ThreadSanitizer as well, see TUTORIAL03_SANITIZER.
+    NumReaders = std::min(std::max(NumReaders, 1u), 4u);
+
+    // The orbit radius alternates between frames, so a snapshot mixing two ticks has
+    // instances at different distances from their centres. All instances of a snapshot
+    // or of an interpolated frame share the bob offset.
+    const Uint32 NumInstances = m_InstanceCount;
+    auto         IsConsistent = [&](const std::vector<float4x4>& Worlds, bool CheckRadius) {
+        if (Worlds.size() != NumInstances)
+            return false;
+        const Uint32 Step = std::max(NumInstances / 64u, 1u);
+        float        R0 = 0, Y0 = 0;
+        for (Uint32 i = 0; i < NumInstances; i += Step)
+        {
+            const float3& C = m_InstanceCenters[i];
+            const float   R = std::hypot(Worlds[i]._41 - C.x, Worlds[i]._43 - C.z);
+            const float   Y = Worlds[i]._42 - C.y;
+            if (i == 0)
+            {
+                R0 = R;
+                Y0 = Y;
+            }
+            else if ((CheckRadius && std::abs(R - R0) > 1e-2f) || std::abs(Y - Y0) > 1e-2f)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    const float Radius   = m_Swarm.Radius;
+    const float PathTime = m_PathTime;
+    ComputeViews();
+    m_WorldViewProj = m_Views[VIEW_CAMERA_MAIN].ViewProj;
+    PublishFrameState();
+    m_SimThread.Start(m_InstanceCenters, m_InstancePhases, GetOrbitParams(), m_PathTime, static_cast<float>(m_SimTickRate));
+    m_SimThreadVersion = m_SwarmVersion;
+
+    std::atomic<bool>        Stop{false};
+    std::atomic<Uint32>      NumErrors{0};
+    std::atomic<Uint64>      NumReads{0};
+    std::vector<std::thread> Readers;
+    for (Uint32 r = 0; r < NumReaders; ++r)
+    {
+        Readers.emplace_back([&]() {
+            const Uint32 SnapshotReader = m_SimThread.AddSnapshotReader();
+            const Uint32 InstanceReader = m_InstanceFrames.AddReader();
+            if (SnapshotReader == ~0u || InstanceReader == ~0u)
+            {
+                NumErrors.fetch_add(1);
+                return;
+            }
+
+            float LastPathTime = 0;
+            while (!Stop.load(std::memory_order_relaxed))
+            {
+                // One copy of what a single PublishFrameState() wrote
+                const FrameState State = m_FrameState.Read();
+                if (State.PathTime < LastPathTime || State.NumInstances != NumInstances ||
+                    std::memcmp(&State.ViewProj, &State.Views[VIEW_CAMERA_MAIN].ViewProj, sizeof(float4x4)) != 0)
+                    NumErrors.fetch_add(1);
+                LastPathTime = State.PathTime;
+
+                // A snapshot is one tick of the simulation thread
+                if (const auto* pSnapshot = m_SimThread.AcquireSnapshot(SnapshotReader))
+                {
+                    if (!IsConsistent(pSnapshot->Value.Worlds, true))
+                        NumErrors.fetch_add(1);
+                }
+
+                // Every version sent to a renderer that never uploads holds the whole swarm,
+                // packed as a single range
+                if (const auto* pVersion = m_InstanceFrames.Acquire(InstanceReader))
+                {
+                    const InstanceFrame& Frame = pVersion->Value;
+                    if (Frame.DirtyRanges.size() == 1 && Frame.DirtyRanges[0].NumInstances == NumInstances &&
+                        !IsConsistent(Frame.Worlds, false))
+                        NumErrors.fetch_add(1);
+                }
+                NumReads.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_SimThread.ReleaseSnapshot(SnapshotReader);
+            m_InstanceFrames.Release(InstanceReader);
+        });
+    }
+
+    Uint64     NumFrames = 0;
+    const auto Start     = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double>{std::chrono::steady_clock::now() - Start}.count() < Seconds)
+    {
+        m_Swarm.Radius = (NumFrames & 1) != 0 ? Radius * 0.5f : Radius;
+        m_FrameTime    = 1.0f / 60.0f;
+        m_PathTime += m_FrameTime;
+        ComputeViews();
+        m_WorldViewProj = m_Views[VIEW_CAMERA_MAIN].ViewProj;
+        PublishFrameState();
+        CullClusters();
+        UpdateSimThread();
+        PublishInstances();
+        ++NumFrames;
+    }
+    Stop.store(true);
+    for (std::thread& Reader : Readers)
+        Reader.join();
+
+    m_SimThread.Stop();
+    m_Swarm.Radius = Radius;
+    m_PathTime     = PathTime;
+
+    if (NumErrors.load() != 0)
+    {
+        LOG_ERROR_MESSAGE("Simulation stress test: ", NumErrors.load(), " inconsistent reads in ", NumReads.load(),
+                          " reads of ", NumFrames, " frames");
+        return false;
+    }
+    LOG_INFO_MESSAGE("Simulation stress test: passed, ", NumFrames, " frames, ", m_SimThread.GetStats().NumTicks,
+                     " simulation ticks, ", NumReads.load(), " reads by ", NumReaders, " readers");
+    return true;
+}
+
+float4 Tutorial03_Texturing::GetViewRect(Uint32 View, Uint32 NumViews)
+{
+    // Two views side by side; three - the camera on the left and the maps stacked
+    // on the right; four - a 2x2 grid
+    switch (NumViews)
+    {
+        case 1: return float4{0, 0, 1, 1};
+        case 2: return float4{0.5f * View, 0, 0.5f, 1};
+        case 3: return View == 0 ? float4{0, 0, 0.5f, 1} : float4{0.5f, 0.5f * (View - 1), 0.5f, 0.5f};
+        default: return float4{0.5f * (View % 2), 0.5f * (View / 2), 0.5f, 0.5f};
+    }
+}
+
+float4x4 Tutorial03_Texturing::MakeLookAt(const float3& Pos, const float3& Target, const float3& Up)
+{
+    // Left-handed view basis, the same convention as FirstPersonCamera: +Z looks at Target
+    const float3 Z = normalize(Target - Pos);
+    const float3 X = normalize(cross(Up, Z));
+    const float3 Y = cross(Z, X);
+
+    return float4x4(
+        X.x, Y.x, Z.x, 0.0f,
+        X.y, Y.y, Z.y, 0.0f,
+        X.z, Y.z, Z.z, 0.0f,
+        -dot(X, Pos), -dot(Y, Pos), -dot(Z, Pos), 1.0f);
+}
+
+void Tutorial03_Texturing::ComputeViews()
+{
+    const Uint32   NumViews = static_cast<Uint32>(m_NumViews);
+    const bool     IsGL     = m_pDevice->GetDeviceInfo().IsGLDevice();
+    const auto&    SCDesc   = m_pSwapChain->GetDesc();
+    const float4x4 SurfT    = GetSurfacePretransformMatrix(float3{0, 0, 1}); // display rotation/orientation
+
+    // The map cameras frame every orbit, see GenerateInstanceData for the extent
+    BoundBox Bounds{float3{-20, -5, -20}, float3{20, 5, 20}};
+    if (!m_Clusters.empty())
+    {
+        const float3 Extent{m_Swarm.Radius + kMeshRadius, m_Swarm.BobAmp + kMeshRadius, m_Swarm.Radius + kMeshRadius};
+        Bounds = m_Clusters.front().CenterBounds;
+        for (const InstanceCluster& Cluster : m_Clusters)
+        {
+            Bounds.Min = std::min(Bounds.Min, Cluster.CenterBounds.Min);
+            Bounds.Max = std::max(Bounds.Max, Cluster.CenterBounds.Max);
+        }
+        Bounds.Min -= Extent;
+        Bounds.Max += Extent;
+    }
+    const float3 Center = (Bounds.Min + Bounds.Max) * 0.5f;
+    const float3 Size   = Bounds.Max - Bounds.Min;
+    const float  Radius = length(Size) * 0.5f;
+
+    for (Uint32 View = 0; View < NumViews; ++View)
+    {
+        ViewState&   V      = m_Views[View];
+        const float4 Rect   = GetViewRect(View, NumViews);
+        const float  Aspect = (Rect.z * SCDesc.Width) / (Rect.w * SCDesc.Height);
+        V.Rect              = Rect;
+
+        switch (View)
+        {
+            case VIEW_CAMERA_MAIN:
+                V.CamPos = m_Camera.GetPos();
+                V.View   = m_Camera.GetViewMatrix();
+                V.Proj   = m_Camera.GetProjMatrix();
+                // The camera projection is set up for the whole window
+                if (NumViews > 1)
+                    V.Proj._11 *= m_Camera.GetProjAttribs().AspectRatio / Aspect;
+                break;
+
+            case VIEW_CAMERA_OVERHEAD:
+            {
+                const float Height = std::max(Size.z, Size.x / Aspect) * 1.1f;
+                V.CamPos           = float3{Center.x, Bounds.Max.y + 1.0f, Center.z};
+                V.View             = MakeLookAt(V.CamPos, Center, float3{0, 0, 1});
+                V.Proj             = float4x4::Ortho(Height * Aspect, Height, 0.1f, Size.y + 2.0f, IsGL);
+                break;
+            }
+
+            default:
+            {
+                // Far enough for the bounding sphere to fit into the vertical field of view
+                const float Dist  = Radius / std::sin(PI_F / 8);
+                const float Angle = View == VIEW_CAMERA_SIDE ? 0.0f : PI_F / 2 + m_PathTime * kOrbitViewSpeed;
+                V.CamPos          = Center + float3{-std::sin(Angle), 0.35f, -std::cos(Angle)} * Dist;
+                V.View            = MakeLookAt(V.CamPos, Center, float3{0, 1, 0});
+                V.Proj            = float4x4::Projection(PI_F / 4, Aspect, 0.1f, Dist + 2.0f * Radius, IsGL);
+                break;
+            }
+        }
+        V.ViewProj = V.View * SurfT * V.Proj;
+    }
 }
 
 void Tutorial03_Texturing::WindowResize(Uint32 W, Uint32 H)
 {
     // Resize default swap chain buffers, UI, etc.
     SampleBase::WindowResize(W, H);
+    CreateHDRTargets();
 
     // Update camera's projection parameters to new window dimensions
     m_Camera.SetProjAttribs(
@@ -27,9 +27,32 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "SampleBase.hpp"
 #include "BasicMath.hpp"
+#include "AdvancedMath.hpp"
 #include "FirstPersonCamera.hpp"
+#include "SwarmFlocking.hpp"
+#include "DirtyRangeTracker.hpp"
+#include "SwarmConfig.hpp"
+#include "InstanceGenerator.hpp"
+#include "SwarmTrajectory.hpp"
+#include "SwarmSimulation.hpp"
+#include "StateExchange.hpp"
+#include "FrameArena.hpp"
+#include "AllocationTracker.hpp"
+#include "SkyTileStreamer.hpp"
+#include "GPURadixSort.hpp"
+#include "WingAnimation.hpp"
+#include "ShaderPermutations.hpp"
+#include "ShaderFileWatcher.hpp"
+#include "ScopedQueryHelper.hpp"
 
 namespace Diligent
 {
@@ -37,6 +60,10 @@ namespace Diligent
 class Tutorial03_Texturing final : public SampleBase
 {
 public:
+    ~Tutorial03_Texturing();
+
+    virtual CommandLineStatus ProcessCommandLine(int argc, const char* const* argv) override final;
+
     virtual void Initialize(const SampleInitInfo& InitInfo) override final;
 
     virtual void Render() override final;
@@ -46,55 +73,756 @@ public:
 
     virtual void WindowResize(Uint32 Width, Uint32 Height) override;
 
-    virtual float4x4 MakeWorld(const float3& Pos, const float3& Forward, const float3& Up);
-
 private:
     void CreatePipelineState();
     void CreateVertexBuffer();
     void CreateIndexBuffer();
     void LoadTexture();
     void CreateSkySphere();
+    void UpdateShaderHotReload();
+    void CreateToneMapping();
+    void CreateHDRTargets();
+    bool LoadHDRSky();
+    void ToneMapHDR(ITextureView* pBackBufferRTV);
+    void LoadSkyTexture();
+    bool InitSkyStreaming();
+    void UpdateSkyStreaming();
+    void ReadBackSkyFeedback();
+    ITextureView* GetSkyLowResRTV(TEXTURE_FORMAT Format);
+    void CreateOITComposite();
+    bool PrepareMSAATargets(TEXTURE_FORMAT Format);
+    void PrepareOITTargets();
+    TEXTURE_FORMAT GetTargetFormat(Uint32 Target) const;
+    bool IsTargetSupported(Uint32 Target) const;
     void GenerateInstanceData(float Time);
-    void DrawButterflies();
-    void InitInstanceData();
+    void CullClusters();
+    void AppendInstances(Uint32 NumNew);
+    void BuildInstanceClusters(Uint32 FirstInstance, const std::vector<InstanceGenerator::CellRange>& Cells);
+    void ResizeSwarm(Uint32 NewCount);
+    float4x4 EvaluateInstance(Uint32 i, float Time, float BobOffset);
+    void DrawButterflies(bool MultiView, bool Sorted, ITextureView* pRTV);
+    void BakeWingVAT();
+    void RunWingVSBenchmark();
+    void CreateRegressionTargets();
+    void FinishRegressionFrame();
+    void InitInstanceData(Uint32 Seed);
+    void CreateInstanceBuffer(Uint32 NumToPreserve);
+    void CreateInstanceParamsBuffer(Uint32 NumToPreserve);
+    void UploadDirtyInstances();
+    void UpdatePlayback(float ElapsedTime);
+    void UpdateSimThread();
+    OrbitParams GetOrbitParams() const;
+    void StartTrajectoryRecording(float Seconds);
+    bool RecordTrajectory(const char* Path, const std::vector<float3>& Centers, const std::vector<float>& Phases,
+                          const OrbitParams& Params, float StartTime, Uint32 NumFrames);
+    void UpdateUI();
+    void ResetSimulation();
+
+    // GPU flocking
+    void CreateFlockingPipelines();
+    void CreateFlockingBuffers(Uint32 NumToPreserve);
+    void InitFlockingAgents(Uint32 FirstAgent);
+    void DispatchFlocking(float DeltaTime);
+    void CompareFlockingWithReference();
+
+    // GPU instance sorting
+    void CreateInstanceSort();
+    void CreateInstanceSortBuffers();
+    bool CanSortInstances(Uint32 NumInstances) const;
+    bool SortInstances();
+    void RunRadixSortTest();
+    void PublishFrameState();
+    void PublishInstances();
+    bool RunSimulationStressTest(Uint32 NumReaders, double Seconds);
+    void UpdateZeroAllocTest();
+
+    // Scene PSOs exist once per colour target; SRBs are shared between them.
+    // The MSAA targets are only used by WING_MODE_ALPHA_TO_COVERAGE and are
+    // resolved into their single-sample counterpart at the end of the frame.
+    enum RENDER_TARGET : Uint32
+    {
+        RENDER_TARGET_BACK_BUFFER = 0,  // swap-chain format
+        RENDER_TARGET_HDR,              // kHDRFormat, resolved by ToneMap.csh
+        RENDER_TARGET_BACK_BUFFER_MSAA, // swap-chain format, kMSAASampleCount samples
+        RENDER_TARGET_HDR_MSAA,         // kHDRFormat, kMSAASampleCount samples
+        RENDER_TARGET_COUNT
+    };
+    using TargetPSOs = std::array<RefCntAutoPtr<IPipelineState>, RENDER_TARGET_COUNT>;
+
+    static constexpr TEXTURE_FORMAT kHDRFormat       = TEX_FORMAT_RGBA16_FLOAT;
+    static constexpr Uint8          kMSAASampleCount = 4;
+
+    static bool IsHDRTarget(Uint32 Target) { return Target == RENDER_TARGET_HDR || Target == RENDER_TARGET_HDR_MSAA; }
+    static bool IsMSAATarget(Uint32 Target) { return Target >= RENDER_TARGET_BACK_BUFFER_MSAA; }
 
-    RefCntAutoPtr<IPipelineState>         m_pPSO;
     RefCntAutoPtr<IBuffer>                m_ButterflyVertexBuffer;
     RefCntAutoPtr<IBuffer>                m_ButterflyIndexBuffer;
     RefCntAutoPtr<IBuffer>                m_VSConstants;
-    RefCntAutoPtr<ITextureView>           m_TextureSRV;
+    RefCntAutoPtr<IBuffer>                m_InstanceBuffer;       // per-instance world matrices read by cube.vsh
+    RefCntAutoPtr<IBuffer>                m_InstanceIndexBuffer;  // per-instance vertex stream 0, 1, 2, ..., see CreateInstanceIndexBuffer()
+    RefCntAutoPtr<IBuffer>                m_InstanceParamsBuffer; // centre + phase for ANALYTIC_MOTION, sized for m_InstanceCapacity
+    RefCntAutoPtr<IShaderResourceBinding> m_AnalyticSRB;
+    RefCntAutoPtr<IShaderResourceBinding> m_SortedSRB; // SORTED_INSTANCES: matrices read through m_InstanceOrder
+    RefCntAutoPtr<ITextureView>           m_TextureSRV; // Texture2DArray, one slice per species
     RefCntAutoPtr<IShaderResourceBinding> m_SRB;
 
+    static constexpr Uint32 kMaxSpecies = 16;
+
+    // --- Butterfly permutations ------------------------------------------
+    // Every butterfly PSO is a permutation of cube.vsh/cube.psh created on first
+    // use by m_ButterflyPermutations. Values are the first bit of each field in
+    // the PermutationKey; fields without a macro only affect pipeline state.
+    enum BUTTERFLY_PERM : Uint32
+    {
+        BUTTERFLY_PERM_TARGET          = 0, // 2 bits, RENDER_TARGET (ignored by OIT)
+        BUTTERFLY_PERM_ANALYTIC        = 2, // ANALYTIC_MOTION
+        BUTTERFLY_PERM_SORTED          = 3, // SORTED_INSTANCES
+        BUTTERFLY_PERM_WING_VAT        = 4, // WING_VAT
+        BUTTERFLY_PERM_BRANCHLESS_WING = 5, // BRANCHLESS_WING
+        BUTTERFLY_PERM_WING_ALPHA_MODE = 6, // 2 bits, WING_ALPHA_MODE; 2 is the OIT accumulation pipeline
+        BUTTERFLY_PERM_GAMMA           = 8, // CONVERT_PS_OUTPUT_TO_GAMMA
+        BUTTERFLY_PERM_MULTI_VIEW      = 9, // MULTI_VIEW; adds MultiView.gsh to the pipeline
+    };
+    std::unique_ptr<ShaderPermutationCache> m_ButterflyPermutations;
+
+    // Target formats and resources that pipeline creation reads. Captured on the main thread,
+    // so that hot reload jobs never touch the swap chain or members the main thread replaces.
+    struct PipelineTargets
+    {
+        std::array<TEXTURE_FORMAT, RENDER_TARGET_COUNT> Formats     = {}; // TEX_FORMAT_UNKNOWN for unsupported targets
+        TEXTURE_FORMAT                                  DepthFormat = TEX_FORMAT_UNKNOWN;
+        RefCntAutoPtr<ITextureView>                     pWingVATSRV;
+    };
+    PipelineTargets CapturePipelineTargets() const;
+
+    PermutationKey GetButterflyKey(Uint32 Target, bool Analytic, bool Sorted, bool OIT, bool MultiView) const;
+    void           CreateButterflyPSO(const PipelineTargets& Targets, PermutationKey Key, IShader* pVS, IShader* pPS, IPipelineState** ppPSO);
+
+    // Sky, streaming sky and upsample pipelines built from DepthGrid.hlsl
+    struct SkyPipelines
+    {
+        TargetPSOs Sky;
+        TargetPSOs Stream;
+        TargetPSOs Upsample;
+    };
+    bool CreateSkyPipelines(const PipelineTargets& Targets, SkyPipelines& Out) const;
+
+    // --- Shader hot reload -----------------------------------------------
+    // m_ShaderWatcher reports saved shader files. Affected pipelines are recompiled
+    // by a background job and swapped in at the start of the next frame; if any
+    // of them fails to compile the previous pipelines stay in use.
+    struct ShaderReload
+    {
+        bool   Butterfly = false;
+        bool   Sky       = false;
+        bool   Succeeded = false;
+        double CompileMs = 0;
+
+        ShaderPermutationCache::Generation ButterflyPSOs;
+        SkyPipelines                       SkyPSOs;
+    };
+    std::string               m_ShaderSearchPath = "."; // --shader_dir; read by the source factories, watched by m_ShaderWatcher
+    ShaderFileWatcher         m_ShaderWatcher;
+    std::future<ShaderReload> m_PendingReload;
+    std::vector<std::string>  m_ChangedShaders;
+    bool                      m_ReloadButterfly = false; // change seen while a job was running
+    bool                      m_ReloadSky       = false;
+    std::string               m_ShaderReloadStatus;
+
     // --- PNG + depth grid -----------------------------------------------
-    RefCntAutoPtr<IPipelineState>         m_SkyPSO;
+    TargetPSOs                            m_SkyPSO;
     RefCntAutoPtr<IShaderResourceBinding> m_SkySRB;
     RefCntAutoPtr<IBuffer>                m_SkyCB;
-    RefCntAutoPtr<ITextureView>           m_SkySRV;
+    RefCntAutoPtr<ITextureView>           m_SkySRV; // full-resolution sky, only when not streaming
+
+    // --- Sky tile streaming ----------------------------------------------
+    // Only the tiles the sky PS asks for are kept in a fixed-size cache texture.
+    // Feedback is read back a few frames late and never waited on.
+    static constexpr const char* kSkyTileFile             = "hdrHigh.tiles";
+    static constexpr Uint32      kSkyTileSize             = 128;
+    static constexpr Uint32      kSkyTileBorder           = 1;        // apron for bilinear filtering
+    static constexpr Uint32      kSkyCacheBudget          = 16 << 20; // bytes of cache texture
+    static constexpr Uint32      kSkyMaxUploadsPerFrame   = 16;
+    static constexpr Uint32      kSkyFeedbackMask         = 3;        // one feedback write per 4x4 pixels
+    static constexpr Uint32      kNumSkyFeedbackReadbacks = 3;
+
+    // Must match SkyStreamingCB in DepthGrid.hlsl
+    struct SkyStreamingConstants
+    {
+        float2 VirtualSize;
+        float2 CacheSize;
+        float  TileSize;
+        float  TileBorder;
+        Uint32 SlotsPerRow;
+        Uint32 NumMips;
+        Uint32 FeedbackStamp;
+        Uint32 FeedbackMask;
+        Uint32 Padding[2];
+        uint4  MipFirstTile[SkyTileStreamer::kMaxMips];
+    };
+    static_assert(sizeof(SkyStreamingConstants) % 16 == 0, "CB size must be 16-byte aligned");
+
+    TargetPSOs                            m_SkyStreamPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_SkyStreamSRB;
+    RefCntAutoPtr<IBuffer>                m_SkyStreamCB;
+    RefCntAutoPtr<ITexture>               m_SkyCache;
+    RefCntAutoPtr<IBuffer>                m_SkyPageTable;
+    RefCntAutoPtr<IBuffer>                m_SkyFeedback;
+
+    std::array<RefCntAutoPtr<IBuffer>, kNumSkyFeedbackReadbacks> m_SkyFeedbackReadback;
+    std::array<Uint64, kNumSkyFeedbackReadbacks>                 m_SkyFeedbackFenceValues = {};
+    std::array<Uint32, kNumSkyFeedbackReadbacks>                 m_SkyFeedbackStamps      = {};
+    RefCntAutoPtr<IFence>                                        m_SkyFeedbackFence;
+    Uint64                                                       m_SkyFeedbackFenceValue = 0;
+    Uint32                                                       m_SkyFeedbackStamp      = 0;
+    Uint32                                                       m_SkyReadbackIndex      = 0;
+
+    SkyTileStreamer       m_SkyStreamer;
+    SkyStreamingConstants m_SkyStreamConsts  = {};
+    bool                  m_SkyStreaming     = false;
+    Uint32                m_SkyTilesUploaded = 0;
+
+    // --- Reduced-rate sky ------------------------------------------------
+    // The sky is low-frequency, so it can be shaded at 1/2 or 1/4 resolution,
+    // either with per-draw VRS or into an offscreen target that is upsampled.
+    enum SKY_RESOLUTION : int
+    {
+        SKY_RESOLUTION_FULL = 0,
+        SKY_RESOLUTION_HALF,
+        SKY_RESOLUTION_QUARTER,
+    };
+    int                                   m_SkyResolution      = SKY_RESOLUTION_FULL; // also the downscale shift
+    bool                                  m_SkyUseVRS          = true;
+    bool                                  m_SkyVRSSupported    = false;
+    bool                                  m_SkyVRS4x4Supported = false;
+    TargetPSOs                            m_SkyUpsamplePSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_SkyUpsampleSRB;
+    RefCntAutoPtr<ITexture>               m_SkyLowRes;
+    std::unique_ptr<ScopedQueryHelper>    m_SkyStatsQuery;         // the sky draws alone
+    std::unique_ptr<ScopedQueryHelper>    m_SkyUpsampleStatsQuery; // the full-resolution upsample of the low-res sky
+    Uint64                                m_SkyPSInvocations         = 0;
+    Uint64                                m_SkyUpsamplePSInvocations = 0; // 0 unless the sky is drawn at low resolution
+    Uint64                                m_SkyStatsPixels           = 0; // target pixels when the stats were captured
+
+    // --- HDR rendering ---------------------------------------------------
+    // The scene renders into an RGBA16F target; ToneMap.csh resolves it in one
+    // fused pass (exposure + tone curve + sRGB) that also builds the luminance
+    // histogram from which ComputeExposure derives next frame's exposure.
+    enum TONEMAP_PASS : Uint32
+    {
+        TONEMAP_PASS_RESOLVE = 0,
+        TONEMAP_PASS_EXPOSURE,
+        TONEMAP_PASS_COUNT
+    };
+    std::array<RefCntAutoPtr<IPipelineState>, TONEMAP_PASS_COUNT>         m_ToneMapPSOs;
+    std::array<RefCntAutoPtr<IShaderResourceBinding>, TONEMAP_PASS_COUNT> m_ToneMapSRBs;
+
+    RefCntAutoPtr<IBuffer>                m_ToneMapCB;
+    RefCntAutoPtr<IBuffer>                m_LumHistogram;
+    RefCntAutoPtr<IBuffer>                m_Exposure;
+    RefCntAutoPtr<ITexture>               m_HDRColor;
+    RefCntAutoPtr<ITexture>               m_ToneMapped; // linear twin of the back-buffer format, copied to it
+    RefCntAutoPtr<IShaderResourceBinding> m_HDRSkySRB;  // float sky source, if one was found
+    TEXTURE_FORMAT                        m_ToneMapLDRFormat = TEX_FORMAT_UNKNOWN;
+    std::string                           m_HDRSkySource;
+
+    // Baked from hdrHigh.png by SkyHDRBaker when no real HDR sky ships, see LoadHDRSky()
+    static constexpr const char* kHDRSkyFile     = "hdrHigh.expanded.dds";
+    static constexpr Uint32      kHDRSkyMaxWidth = 4096;
+    static constexpr float       kHDRSkyPeak     = 64.0f; // top of the tone mapper's histogram range
+
+    bool  m_HDR                  = false;
+    float m_ExposureCompensation = 0.0f; // EV
+    float m_ExposureAdaptSpeed   = 2.0f; // 1/s
+
+    static constexpr Uint32 kToneMapGroupSize = 16;  // TONEMAP_GROUP_SIZE in ToneMap.csh
+    static constexpr Uint32 kHistogramBins    = 256; // HISTOGRAM_BINS in ToneMap.csh
+
+    // Must match ToneMapConstants in ToneMap.csh
+    struct ToneMapConstants
+    {
+        Uint32 Width;
+        Uint32 Height;
+        float  MinLogLum;
+        float  LogLumRange;
+
+        float  AdaptationRate; // 1 - exp(-dt * speed)
+        float  ExposureCompensation;
+        Uint32 NumPixels;
+        Uint32 Padding = 0;
+    };
+    static_assert(sizeof(ToneMapConstants) % 16 == 0, "CB size must be 16-byte aligned");
+
+    // --- Wing transparency -----------------------------------------------
+    // Soft-edged wings without sorting the instances: alpha to coverage on a
+    // 4x MSAA target, or weighted blended OIT (WING_ALPHA_MODE 2 in cube.psh
+    // plus the composite in WeightedOIT.hlsl) on the single-sample target.
+    enum WING_MODE : int
+    {
+        WING_MODE_OPAQUE = 0,        // silhouettes from geometry only, texture alpha ignored
+        WING_MODE_ALPHA_TO_COVERAGE, // MSAA, alpha becomes the coverage mask
+        WING_MODE_WEIGHTED_OIT,      // accumulate + composite, order independent
+        WING_MODE_COUNT
+    };
+    int m_WingMode         = WING_MODE_OPAQUE;
+    int m_RenderedWingMode = WING_MODE_OPAQUE; // mode of the frame m_FrameTime was measured on
+
+    // Smoothed frame time of every mode, used to report the overhead against opaque
+    std::array<float, WING_MODE_COUNT> m_WingModeFrameMs = {};
+
+    static constexpr TEXTURE_FORMAT kOITAccumFormat  = TEX_FORMAT_RGBA16_FLOAT;
+    static constexpr TEXTURE_FORMAT kOITRevealFormat = TEX_FORMAT_R16_FLOAT;
+
+    TargetPSOs                            m_OITCompositePSO; // single-sample targets only
+    RefCntAutoPtr<IShaderResourceBinding> m_OITCompositeSRB;
+    RefCntAutoPtr<ITexture>               m_OITAccum;
+    RefCntAutoPtr<ITexture>               m_OITReveal;
+    RefCntAutoPtr<ITexture>               m_MSAAColor;
+    RefCntAutoPtr<ITexture>               m_MSAADepth;
+
+    // --- Baked wing animation --------------------------------------------
+    // With --wing_vat every butterfly VS variant is built with WING_VAT = 1 and
+    // reads the flap cycle baked by WingAnimation::Bake instead of rotating the
+    // wings analytically. The texture is rebaked when the wing amplitude changes.
+    static constexpr Uint32 kWingVATFrames = 32; // WING_VAT_FRAMES in cube.vsh
+
+    bool                    m_WingVAT = false;
+    WingAnimationDesc       m_WingVATDesc;
+    RefCntAutoPtr<ITexture> m_WingVATTex;
+
+    // VS-bound microbenchmark of the hinge rotation: the same instanced draw with
+    // BRANCHLESS_WING = 0 and 1 into a tiny target, so that vertex work dominates.
+    // Run from the UI or with --wing_vs_bench.
+    static constexpr Uint32 kWingBenchInstances = 1u << 15;
+    static constexpr Uint32 kWingBenchIters     = 4;
+    static constexpr Uint32 kWingBenchSize      = 64; // render target width and height
+
+    struct WingBenchResult
+    {
+        double BranchMs     = 0; // per draw, per-vertex sin/cos and branch
+        double BranchlessMs = 0; // per draw, per-frame sin/cos and flag arithmetic
+    };
+    WingBenchResult m_WingBenchResult;
+    bool            m_RunWingBench = false;
+
+    // --- Render regression harness ---------------------------------------
+    // With --regression_capture and/or --regression_golden the first frame is
+    // rendered with a fixed seed, time and camera into an offscreen copy of the
+    // back buffer, read back, written out and/or compared, and the sample exits
+    // with the verdict. The UI overlay is not part of the image.
+    static constexpr Uint32 kRegressionSeed = 1234;
+    static constexpr float  kRegressionTime = 2.5f; // m_PathTime of the captured frame
+
+    struct RegressionSettings
+    {
+        std::string CapturePath; // PNG written from the rendered frame
+        std::string GoldenPath;  // PNG the rendered frame is compared against
+        float       MinPSNR = 40.0f; // dB
+        float       MinSSIM = 0.98f;
+
+        bool IsEnabled() const { return !CapturePath.empty() || !GoldenPath.empty(); }
+    };
+    RegressionSettings      m_Regression;
+    RefCntAutoPtr<ITexture> m_RegressionColor;
+    RefCntAutoPtr<ITexture> m_RegressionDepth;
+
+    // One-shot test modes report their verdict through RequestExit(). The process ends
+    // at the start of the next Update, between frames, once StopWorkers() has joined
+    // every worker thread and the GPU is idle.
+    void RequestExit(bool Passed);
+    void StopWorkers();
+
+    int m_ExitCode = -1; // EXIT_SUCCESS or EXIT_FAILURE once requested
+
+    // --- GPU instance sorting --------------------------------------------
+    // BuildSortKeys (SortKeys.csh) writes a species + depth key per instance and
+    // GPURadixSort sorts them into m_InstanceOrder, the draw-order permutation
+    // that the SORTED_INSTANCES vertex shader reads. Compute shaders only.
+    enum INSTANCE_SORT : int
+    {
+        INSTANCE_SORT_OFF = 0,
+        INSTANCE_SORT_FRONT_TO_BACK, // nearest first, helps early depth rejection
+        INSTANCE_SORT_BACK_TO_FRONT, // farthest first, for order-dependent blending
+    };
+    int m_InstanceSort = INSTANCE_SORT_OFF;
+
+    static constexpr Uint32 kSortKeyGroupSize   = 256; // SORT_KEY_GROUP_SIZE in SortKeys.csh
+    static constexpr Uint32 kSortKeyDepthBits   = 24;  // DEPTH_BITS in SortKeys.csh
+    static constexpr Uint32 kRadixSortTestSeed  = 4321;
+    static constexpr Uint32 kRadixSortTestIters = 10;
+
+    // Must match SortKeyConstants in SortKeys.csh
+    struct SortKeyConstants
+    {
+        float4x4 View;
+
+        float  NearZ;
+        float  FarZ;
+        Uint32 NumInstances;
+        Uint32 BackToFront;
+        Uint32 NumSpecies;
+        Uint32 Padding[3];
+    };
+    static_assert(sizeof(SortKeyConstants) % 16 == 0, "CB size must be 16-byte aligned");
+
+    std::unique_ptr<GPURadixSort>         m_RadixSort;
+    RefCntAutoPtr<IPipelineState>         m_SortKeyPSO;
+    RefCntAutoPtr<IShaderResourceBinding> m_SortKeySRB;
+    RefCntAutoPtr<IBuffer>                m_SortKeyCB;
+    RefCntAutoPtr<IBuffer>                m_SortKeys;
+    RefCntAutoPtr<IBuffer>                m_InstanceOrder;
+
+    // Radix sort self-test against GPURadixSort::SortReference, run from the UI or with --radix_sort_test
+    struct RadixSortTestResult
+    {
+        Uint32 NumKeys = 0;
+        double GPUMs   = 0; // per sort, averaged over kRadixSortTestIters
+        double CPUMs   = 0; // std::sort of (key, index) pairs
+        bool   Passed  = false;
+    };
+    std::vector<RadixSortTestResult> m_RadixSortTestResults;
+    bool                             m_RunRadixSortTest = false;
 
     FirstPersonCamera m_Camera;
     float4x4          m_WorldViewProj;
 
-    float                  m_PathTime  = 0.0f;  // accumulated time
-    static constexpr float kRadius     = 6.0f;  // circle radius
-    static constexpr float kSpeed      = 0.75f;  // radians·s-¹
-    static constexpr float kBaseHeight = 0.0f;  // centre of vertical motion
-    static constexpr float kBobAmp     = 0.25f; // vertical amplitude
-    static constexpr float kBobFreq    = 0.80f; // Hz
+    // --- Multiple views --------------------------------------------------
+    // Up to kMaxViews views of the same swarm share the simulation, the upload, the
+    // sort and one cluster culling pass per frame. View 0 is the interactive camera,
+    // the others are fixed map cameras framed on the swarm. With geometry shaders and
+    // multiple viewports all views are drawn by one instanced draw (MULTI_VIEW), else
+    // by one draw per view.
+    static constexpr Uint32 kMaxViews       = 4;
+    static constexpr float  kOrbitViewSpeed = 0.1f; // rad/s, VIEW_CAMERA_ORBIT
+
+    enum VIEW_CAMERA : Uint32
+    {
+        VIEW_CAMERA_MAIN,     // m_Camera
+        VIEW_CAMERA_OVERHEAD, // orthographic map looking straight down
+        VIEW_CAMERA_SIDE,     // perspective from the -Z side
+        VIEW_CAMERA_ORBIT     // perspective slowly circling the swarm
+    };
+
+    struct ViewState
+    {
+        float4x4 ViewProj; // includes the surface pre-transform
+        float4x4 View;
+        float4x4 Proj;
+        float4   Rect; // normalized x, y, width, height of the viewport
+        float3   CamPos;
+    };
+
+    static float4   GetViewRect(Uint32 View, Uint32 NumViews);
+    static float4x4 MakeLookAt(const float3& Pos, const float3& Target, const float3& Up);
+    void            ComputeViews(); // m_Views from m_Camera and the bounds of the swarm
+    Viewport        GetViewport(Uint32 View, ITextureView* pRTV) const;
+
+    IShaderResourceBinding* GetMultiViewSRB(IPipelineState* pPSO, bool Analytic, bool Sorted);
+
+    int                                                  m_NumViews           = 1;
+    bool                                                 m_MultiViewDraw      = true;  // one draw for all views where supported
+    bool                                                 m_MultiViewSupported = false; // geometry shaders and multiple viewports
+    std::array<ViewState, kMaxViews>                     m_Views;
+    std::array<Uint32, kMaxViews>                        m_ViewClustersVisible = {};
+    RefCntAutoPtr<IShader>                               m_MultiViewGS;
+    RefCntAutoPtr<IBuffer>                               m_MultiViewCB;
+    std::array<RefCntAutoPtr<IShaderResourceBinding>, 3> m_MultiViewSRBs; // plain, analytic, sorted
+
+    // View, timing and swarm state Render consumes. Update publishes it through a
+    // seqlock once per frame and Render takes one consistent copy at its start, so Render
+    // reads neither the view members above nor m_Swarm. Together with the instance
+    // exchange below that covers the per-frame data only: ResizeSwarm still recreates
+    // m_InstanceBuffer and rebinds the SRBs from Update, and flocking keeps
+    // m_FlockCPUAgents and m_FlockReference shared, so Update and Render stay sequential.
+    struct FrameState
+    {
+        float4x4 ViewProj; // view 0, includes the surface pre-transform
+        float4x4 View;
+        float4x4 Proj;
+        float    NearZ     = 0;
+        float    FarZ      = 0;
+        float    PathTime  = 0;
+        float    FrameTime = 0;
+
+        Uint32                           NumViews = 1;
+        std::array<ViewState, kMaxViews> Views;
+
+        Uint32      NumInstances = 0;
+        Uint32      NumSpecies   = 1;
+        OrbitParams Orbit;
+        float       WingFactor = 0;
+        float       WingAmp    = 0;
+    };
+    SeqLock<FrameState> m_FrameState;
+    FrameState          m_RenderFrame; // Render's copy of m_FrameState
+    bool                m_RunStateExchangeTest = false;
+
+    float                  m_PathTime  = 0.0f; // accumulated time
+    static constexpr float kBaseHeight = 0.0f; // centre of vertical motion
+
+    // Radius, speed, bob and wing parameters plus the requested instance count
+    SwarmConfig m_Swarm;
+    std::string m_SwarmConfigPath = "swarm.cfg";
 
-    static constexpr float kWingFactor = 6.0f;  // flaps per bob
-    static constexpr float kWingAmp    = 0.60f; // radians
+    static constexpr float kMeshRadius       = 0.5f;  // conservative butterfly mesh extent
+    static constexpr float kClusterSize      = 8.0f;  // grid cell used to cluster orbit centres
+    static constexpr float kFullRateDistance = 25.0f; // clusters closer than this update every frame
+
+    static constexpr Uint32 kMaxClusterFragmentation = 4; // clusters per compact one before ResizeSwarm re-clusters
 
     std::vector<float4x4> m_InstanceWorlds;
-    Uint32                m_InstanceCount = 50;
+    Uint32                m_InstanceCount    = 0; // live count, follows m_Swarm.InstanceCount
+    Uint32                m_InstanceCapacity = 0; // instances the GPU buffers can hold
+    InstanceGenerator     m_InstanceGenerator; // spawn layout, seeded from m_Swarm.Seed
+    Uint32                m_NextSpawnIndex = 0; // spawn indices below this have been generated since the last reset
     std::vector<float3>   m_InstanceCenters;
     std::vector<float>    m_InstancePhases;
 
+    // --- Lazy instance updates -------------------------------------------
+    // Instances are sorted by cluster, so every cluster is a contiguous range
+    // of m_InstanceWorlds. Off-screen clusters are skipped, distant ones are
+    // refreshed every few frames, and only touched ranges are uploaded.
+    struct InstanceCluster
+    {
+        BoundBox CenterBounds;      // bounds of member orbit centres; orbit extent is added at cull time
+        Uint32   FirstInstance = 0;
+        Uint32   NumInstances  = 0;
+        bool     WasVisible    = false;
+        bool     IsValid       = false; // transforms have been evaluated at least once
+    };
+    std::vector<InstanceCluster> m_Clusters;
+    std::vector<Uint8>           m_ClusterViews; // bit per view that sees the cluster, see CullClusters()
+    Uint32                       m_NumCompactClusters = 0; // m_Clusters.size() after the last full clustering, see ResizeSwarm()
+
+    // --- Per-view draw culling ---------------------------------------------
+    // Every view draws only the instance ranges of the clusters it sees. Neighbouring
+    // visible clusters are merged into one draw, and so are ranges separated by fewer
+    // than kDrawRangeMergeGap instances, which are cheaper to draw than to skip.
+    // Slot kMaxViews holds the clusters seen by any view, for the MULTI_VIEW draw.
+    struct InstanceRange
+    {
+        Uint32 FirstInstance = 0;
+        Uint32 NumInstances  = 0;
+    };
+    struct InstanceDrawStats
+    {
+        Uint32 NumInstances = 0;
+        Uint32 NumDraws     = 0;
+    };
+    static constexpr Uint32 kDrawRangeMergeGap = 256;
+
+    static RefCntAutoPtr<IBuffer> CreateInstanceIndexBuffer(IRenderDevice* pDevice, const char* Name, Uint32 NumInstances);
+
+    bool                                                  m_CullDraws       = true;
+    bool                                                  m_DrawRangesValid = false; // cluster bounds hold in the current mode
+    std::array<std::vector<InstanceRange>, kMaxViews + 1> m_ViewDrawRanges; // Update's copy, see InstanceFrame
+    std::array<InstanceDrawStats, kMaxViews + 1>          m_ViewDrawStats = {}; // what the last frame drew
+
+    bool   m_LazyInstanceUpdates = true;
+    Uint32 m_FrameIndex          = 0;
+    Uint32 m_NumInstancesUpdated = 0;
+    Uint32 m_NumClustersVisible  = 0;
+
+    // --- Partial instance uploads ----------------------------------------
+    DirtyRangeTracker                      m_InstanceDirty;  // chunks of m_InstanceWorlds written this frame
+    DirtyRangeTracker                      m_InstancePending; // chunks published but not yet uploaded by Render
+
+    // --- Instance exchange -------------------------------------------------
+    // m_InstanceWorlds belongs to Update. PublishInstances hands Render a version with
+    // every range Render has not uploaded yet, plus the per-view draw ranges. Worlds holds
+    // only the transforms of those ranges, packed back to back in DirtyRanges order, so a
+    // version costs what is dirty rather than the whole swarm. Render reports the newest
+    // version it uploaded, after which Update stops resending its ranges.
+    struct InstanceFrame
+    {
+        std::vector<float4x4>                                 Worlds; // packed DirtyRanges
+        std::vector<InstanceRange>                            DirtyRanges;
+        std::array<std::vector<InstanceRange>, kMaxViews + 1> DrawRanges;
+        bool                                                  DrawRangesValid = false;
+    };
+    using InstanceExchange = EpochExchange<InstanceFrame>;
+
+    InstanceExchange                 m_InstanceFrames;
+    Uint32                           m_InstanceReader         = ~0u;     // Render's reader slot
+    const InstanceExchange::Version* m_pRenderInstances       = nullptr; // Render's version, valid during Render
+    Uint64                           m_InstanceEpochPublished = 0;       // Update only
+    std::atomic<Uint64>              m_InstanceEpochUploaded{0};         // written by Render
+
+    static constexpr Uint64 kStagedUploadThreshold = 64 << 10; // bytes; smaller ranges use UpdateBuffer
+
+    // --- Frame pipelining -------------------------------------------------
+    // At most m_FramesInFlight frames are queued on the GPU. BeginFrame waits for
+    // the frame that last used the current frame slot, so per-frame resources
+    // indexed by m_FrameSlot can be overwritten without further synchronization.
+    // One frame in flight gives the lowest latency; three let the CPU run furthest ahead.
+    static constexpr Uint32 kMaxFramesInFlight = 3;
+
+    void BeginFrame(); // start of Update
+    void EndFrame();   // end of Render
+
+    int                                                   m_FramesInFlight = 2;
+    Uint32                                                m_FrameSlot      = 0;
+    RefCntAutoPtr<IFence>                                 m_FrameFence;
+    Uint64                                                m_FrameFenceValue = 0; // value signaled by the last submitted frame
+    std::array<Uint64, kMaxFramesInFlight>                m_SlotFenceValues = {};
+    std::array<RefCntAutoPtr<IBuffer>, kMaxFramesInFlight> m_InstanceStaging; // per slot, see UploadDirtyInstances()
+
+    // GPU timestamps at the start and end of every frame's work, read back when the slot is reused
+    std::array<RefCntAutoPtr<IQuery>, kMaxFramesInFlight> m_FrameBeginQueries;
+    std::array<RefCntAutoPtr<IQuery>, kMaxFramesInFlight> m_FrameEndQueries;
+    std::array<bool, kMaxFramesInFlight>                  m_SlotHasTimestamps = {};
+    Uint64                                                m_LastGPUFrameEnd   = 0; // ticks; 0 - unknown
+
+    struct FramePacingStats
+    {
+        float CPUWaitMs  = 0; // BeginFrame blocked on the GPU
+        float GPUIdleMs  = 0; // between the end of one frame's GPU work and the start of the next
+        float GPUFrameMs = 0; // GPU time from the first to the last command of the frame
+    };
+    FramePacingStats m_FramePacing; // exponentially smoothed
+
+    // Transient data of the frame being recorded comes from its slot's arena, which
+    // is reset once BeginFrame has waited for the slot, so nothing allocated during
+    // a frame can be overwritten while that frame may still be in flight.
+    static constexpr size_t kFrameArenaSize = 1 << 20; // initial size; grows to the peak frame
+
+    LinearArena& GetFrameArena() { return m_FrameArenas[m_FrameSlot]; }
+
+    std::array<LinearArena, kMaxFramesInFlight> m_FrameArenas = {LinearArena{kFrameArenaSize}, LinearArena{kFrameArenaSize}, LinearArena{kFrameArenaSize}};
+
+    // Heap activity of the render thread, see AllocationTracker
+    static constexpr Uint32 kAllocWarmUpFrames = 300; // steady state is logged after this many frames
+
+    Uint64 m_FrameHeapAllocs     = 0; // heap allocations during the last full frame
+    Uint64 m_FrameHeapAllocsBase = 0; // thread total at the start of the current frame
+
+    // --zero_alloc_test: after kAllocWarmUpFrames, NumFrames frames in a row must not
+    // allocate on the render thread. Exits with the result.
+    struct ZeroAllocTest
+    {
+        Uint32 NumFrames       = 0; // 0 - disabled
+        Uint32 NumFailedFrames = 0;
+        Uint64 NumAllocations  = 0;
+
+        std::vector<std::pair<const AllocationTracker::ScopeStats*, Uint64>> ScopeBase; // counts at the start
+    };
+    ZeroAllocTest m_ZeroAllocTest;
+
+    struct InstanceUploadStats
+    {
+        Uint64 UpdateBufferBytes    = 0;
+        Uint64 StagedBytes          = 0;
+        Uint64 FullUploadBytes      = 0; // what a full re-upload would have cost
+        Uint32 NumUpdateBufferCalls = 0;
+        Uint32 NumStagedCopies      = 0;
+    };
+    InstanceUploadStats m_UploadStats;
+
+    enum SIMULATION_MODE : int
+    {
+        SIMULATION_MODE_ORBITS = 0,   // analytic orbits, evaluated on the CPU
+        SIMULATION_MODE_ANALYTIC_VS,  // same orbits evaluated in cube.vsh, no per-frame CPU work or upload
+        SIMULATION_MODE_PLAYBACK,     // recorded trajectory streamed from m_TrajectoryPath
+        SIMULATION_MODE_FLOCKING_GPU, // boids in Flocking.csh, CPU only dispatches
+    };
+    int   m_SimulationMode = SIMULATION_MODE_ORBITS;
+
+    // --- Trajectory playback ----------------------------------------------
+    // SwarmTrajectoryReader decodes frames on its own thread; UpdatePlayback swaps
+    // the latest one into m_InstanceWorlds and the regular staged upload
+    // copies it to the GPU. A frame that is not decoded in time is skipped.
+    static constexpr float kRecordFrameRate = 30.0f;
+    static constexpr float kRecordSeconds   = 10.0f;
+
+    SwarmTrajectoryReader m_Trajectory;
+    std::string           m_TrajectoryPath     = "swarm.swtr";
+    double                m_PlaybackTime       = 0;
+    Uint32                m_PlaybackFrame      = 0;
+    Uint32                m_PlaybackLateFrames = 0; // frames that kept showing a stale trajectory frame
+
+    // Record trajectory evaluates the orbits on a worker so that large swarms do not
+    // stall the frame; the UI shows m_RecordProgress and StopWorkers() cancels the job.
+    std::future<bool>   m_PendingRecord;
+    std::atomic<Uint32> m_RecordProgress{0}; // frames written so far
+    std::atomic<bool>   m_StopRecord{false};
+    Uint32              m_RecordNumFrames = 0;
+
+    // --- Simulation thread ------------------------------------------------
+    // With m_SimThreadEnabled, CPU orbits are evaluated by m_SimThread at a fixed
+    // tick rate instead of in Update, and Update only interpolates the latest two
+    // snapshots into m_InstanceWorlds. Lazy cluster updates do not apply.
+    SwarmSimThread m_SimThread;
+    bool           m_SimThreadEnabled = false;
+    int            m_SimTickRate      = 60;  // Hz
+    Uint32         m_SwarmVersion     = 0;   // bumped whenever instances are added, removed or reordered
+    Uint32         m_SimThreadVersion = ~0u; // m_SwarmVersion the thread was started with
+    float m_FrameTime      = 0.0f; // last frame's elapsed time
+
+    // --- GPU flocking ---------------------------------------------------
+    enum FLOCK_PASS : Uint32
+    {
+        FLOCK_PASS_CLEAR_CELLS = 0,
+        FLOCK_PASS_BIN_AGENTS,
+        FLOCK_PASS_SCAN_BLOCKS,
+        FLOCK_PASS_SCAN_BLOCK_SUMS,
+        FLOCK_PASS_ADD_BLOCK_OFFSETS,
+        FLOCK_PASS_SCATTER_AGENTS,
+        FLOCK_PASS_INTEGRATE,
+        FLOCK_PASS_COUNT
+    };
+    std::array<RefCntAutoPtr<IPipelineState>, FLOCK_PASS_COUNT>         m_FlockPSOs;
+    std::array<RefCntAutoPtr<IShaderResourceBinding>, FLOCK_PASS_COUNT> m_FlockSRBs;
+
+    RefCntAutoPtr<IBuffer> m_FlockCB;
+    RefCntAutoPtr<IBuffer> m_FlockAgents;
+    RefCntAutoPtr<IBuffer> m_FlockSortedAgents;
+    RefCntAutoPtr<IBuffer> m_FlockCellCounts;
+    RefCntAutoPtr<IBuffer> m_FlockCellStart;
+    RefCntAutoPtr<IBuffer> m_FlockBlockSums;
+    RefCntAutoPtr<IBuffer> m_FlockAgentCell;
+    RefCntAutoPtr<IBuffer> m_FlockReadback; // staging copy of m_FlockAgents for compare mode
+
+    FlockConstants          m_FlockConsts = {};
+    FlockingReference       m_FlockReference;
+    std::vector<FlockAgent> m_FlockCPUAgents;
+
+    // Compare mode: every frame the GPU restarts from the CPU reference state,
+    // both take one step, and the results are diffed.
+    bool  m_FlockCompare     = false;
+    float m_FlockMaxPosError = 0.0f;
+    float m_FlockMaxVelError = 0.0f;
+
+    static constexpr Uint32 kFlockGroupSize       = 64;  // FLOCK_GROUP_SIZE in Flocking.csh
+    static constexpr Uint32 kScanGroupSize        = 256; // SCAN_GROUP_SIZE in Flocking.csh
+    static constexpr Uint32 kScanBlockSize        = 2 * kScanGroupSize;
+    static constexpr Uint32 kFlockCompareSeed     = 1234;
+    static constexpr Uint32 kFlockCompareMaxCount = 1024;
+    static constexpr float  kFlockCompareTol      = 1e-3f;
 
     struct VSConstants
     {
-        float4x4 WorldViewProj;
+        float4x4 ViewProj;
         float    WingAngle;
-        float3   _Padding;
+
+        // Motion constants for ANALYTIC_MOTION
+        float Time;
+        float Radius;
+        float Speed;
+        float BobAmp;
+        float BobFreq;
+        float WingFactor;
+        float WingAmp;
+
+        float2 WingSinCos; // BRANCHLESS_WING: sin and cos of WingAngle
+        Uint32 NumSpecies; // wing texture slices in use, see cube.vsh GetInstanceSpecies()
+        float  Padding;
+    };
+
+    struct MultiViewConstants
+    {
+        float4x4 ViewProj[kMaxViews];
+        Uint32   NumViews;
+        Uint32   Padding[3];
     };
     static_assert(sizeof(VSConstants) % 16 == 0, "CB size must be 16-byte aligned");
 };
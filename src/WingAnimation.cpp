@@ -0,0 +1,92 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#include "WingAnimation.hpp"
+#include "butterfly_verts.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Diligent
+{
+
+float3 WingAnimation::Evaluate(const float3& Pos, float WingFlag, float t, float WingSpan, const WingAnimationDesc& Desc)
+{
+    const float Phase = t * 2.0f * PI_F;
+    float3      p     = Pos;
+
+    // 1) Wings rotate about the hinge like the original cube.vsh flap, but the
+    //    rotation grows and lags towards the tip so that the wing bends
+    if (std::abs(WingFlag) > 0.5f)
+    {
+        const float PivotX = kPivotX * WingFlag;
+        const float Span   = std::min(std::abs(p.x - PivotX) / WingSpan, 1.0f);
+        const float Angle  = Desc.FlapAmp * (1.0f + Desc.BendAmp * Span) * std::sin(Phase - Desc.BendLag * Span) * WingFlag;
+
+        const float s = std::sin(Angle);
+        const float c = std::cos(Angle);
+        const float x = p.x - PivotX;
+        p.x           = x * c - p.y * s + PivotX;
+        p.y           = x * s + p.y * c;
+    }
+
+    // 2) The body pitches and heaves a quarter cycle out of phase with the downstroke
+    const float Pitch = Desc.PitchAmp * std::cos(Phase);
+    const float s     = std::sin(Pitch);
+    const float c     = std::cos(Pitch);
+    const float y     = p.y;
+    p.y               = y * c - p.z * s - Desc.HeaveAmp * std::sin(Phase);
+    p.z               = y * s + p.z * c;
+    return p;
+}
+
+void WingAnimation::Bake(const WingAnimationDesc& Desc, std::vector<float4>& Offsets)
+{
+    using namespace Butterfly;
+
+    // Bend is parameterised by the distance from the hinge relative to the longest wing
+    float WingSpan = 1e-3f;
+    for (const Vertex& Vert : ButterflyVerts)
+    {
+        if (std::abs(Vert.Wing) > 0.5f)
+            WingSpan = std::max(WingSpan, std::abs(Vert.Pos.x - kPivotX * Vert.Wing));
+    }
+
+    Offsets.resize(size_t{Desc.NumFrames} * ButterflyVertexCount);
+    for (Uint32 Frame = 0; Frame < Desc.NumFrames; ++Frame)
+    {
+        const float t    = static_cast<float>(Frame) / static_cast<float>(Desc.NumFrames);
+        float4*     pRow = &Offsets[size_t{Frame} * ButterflyVertexCount];
+        for (Uint32 v = 0; v < ButterflyVertexCount; ++v)
+        {
+            const Vertex& Vert = ButterflyVerts[v];
+            pRow[v]            = float4{Evaluate(Vert.Pos, Vert.Wing, t, WingSpan, Desc) - Vert.Pos, 0.0f};
+        }
+    }
+}
+
+} // namespace Diligent
@@ -0,0 +1,63 @@
+﻿/*
+ *  Copyright 2019-2024 Diligent Graphics LLC
+ *  Copyright 2015-2019 Egor Yusov
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *  In no event and under no legal theory, whether in tort (including negligence),
+ *  contract, or otherwise, unless required by applicable law (such as deliberate
+ *  and grossly negligent acts) or agreed to in writing, shall any Contributor be
+ *  liable for any damages, including any direct, indirect, special, incidental,
+ *  or consequential damages of any character arising as a result of this License or
+ *  out of the use or inability to use the software (including but not limited to damages
+ *  for loss of goodwill, work stoppage, computer failure or malfunction, or any and
+ *  all other commercial damages or losses), even if such Contributor has been advised
+ *  of the possibility of such damages.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "BasicMath.hpp"
+
+namespace Diligent
+{
+
+// Parameters of the baked flap cycle. Angles are in radians, lengths in model units.
+struct WingAnimationDesc
+{
+    Uint32 NumFrames = 32;    // rows of the vertex animation texture; the cycle wraps
+    float  FlapAmp   = 0.60f; // wing rotation about the hinge
+    float  BendAmp   = 0.50f; // extra rotation at the wing tip, relative to FlapAmp
+    float  BendLag   = 0.80f; // phase lag of the wing tip behind the hinge
+    float  PitchAmp  = 0.12f; // body pitch about the lateral axis
+    float  HeaveAmp  = 0.01f; // body rise and fall
+};
+
+// Bakes one flap cycle of the butterfly mesh into per-frame vertex offsets.
+// cube.vsh (WING_VAT = 1) fetches the offsets of the two nearest frames by
+// SV_VertexID and interpolates, which costs the same for every vertex.
+class WingAnimation
+{
+public:
+    static constexpr float kPivotX = 0.02f; // PIVOT_X in cube.vsh
+
+    // Writes NumFrames rows of ButterflyVertexCount float4s (xyz - offset from the rest pose)
+    static void Bake(const WingAnimationDesc& Desc, std::vector<float4>& Offsets);
+
+    // Animated position of a single vertex at cycle phase t in [0, 1)
+    static float3 Evaluate(const float3& Pos, float WingFlag, float t, float WingSpan, const WingAnimationDesc& Desc);
+};
+
+} // namespace Diligent